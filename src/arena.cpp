@@ -0,0 +1,37 @@
+#include "arena.h"
+
+Arena::Arena(size_t block_size) : block_size_(block_size) {
+}
+
+uint8_t* Arena::allocate(size_t bytes, size_t alignment) {
+    std::lock_guard lock(mutex_);
+    size_t padding = (alignment - reinterpret_cast<uintptr_t>(alloc_ptr_) % alignment) % alignment;
+    if (bytes + padding <= alloc_remaining_) {
+        auto* result = alloc_ptr_ + padding;
+        alloc_ptr_ += bytes + padding;
+        alloc_remaining_ -= bytes + padding;
+        return result;
+    }
+    if (bytes > block_size_ / 4) {
+        // Large object gets its own block, so the rest of the current block is not wasted
+        return allocateBlock(bytes);
+    }
+    alloc_ptr_ = allocateBlock(block_size_); // new blocks are aligned for any type
+    auto* result = alloc_ptr_;
+    alloc_ptr_ += bytes;
+    alloc_remaining_ = block_size_ - bytes;
+    return result;
+}
+
+uint8_t* Arena::allocateBlock(size_t bytes) {
+    blocks_.push_back(std::make_unique_for_overwrite<uint8_t[]>(bytes));
+    memory_usage_.fetch_add(bytes + sizeof(blocks_.back()), std::memory_order_relaxed);
+    return blocks_.back().get();
+}
+
+void Arena::reset() noexcept {
+    blocks_.clear();
+    alloc_ptr_ = nullptr;
+    alloc_remaining_ = 0;
+    memory_usage_.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Bump allocator. Memory is handed out from large blocks and released all at once,
+// individual allocations are never freed. Allocation is thread safe.
+class Arena {
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    explicit Arena(size_t block_size = DEFAULT_BLOCK_SIZE);
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Alignment must be a power of two not greater than alignof(std::max_align_t)
+    uint8_t* allocate(size_t bytes, size_t alignment = 1);
+    // Bytes taken from the system, including unused tails of the blocks
+    size_t memoryUsage() const noexcept {
+        return memory_usage_.load(std::memory_order_relaxed);
+    }
+    // Releases all the blocks. Not thread safe, previously allocated memory must not be used.
+    void reset() noexcept;
+
+private:
+    uint8_t* allocateBlock(size_t bytes);
+
+    size_t block_size_;
+    std::mutex mutex_;
+    uint8_t* alloc_ptr_ = nullptr;
+    size_t alloc_remaining_ = 0;
+    std::vector<std::unique_ptr<uint8_t[]>> blocks_;
+    std::atomic<size_t> memory_usage_ = 0;
+};
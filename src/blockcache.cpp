@@ -0,0 +1,150 @@
+#include "blockcache.h"
+#include "constants.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <iterator>
+
+BlockCache::BlockCache(size_t capacity_bytes, size_t num_shards)
+    : shards_(std::max<size_t>(num_shards, 1)), capacity_(0) {
+    setCapacity(capacity_bytes);
+}
+
+BlockCache& BlockCache::instance() {
+    static BlockCache cache(sst::cache::DEFAULT_BLOCK_CACHE_SIZE);
+    return cache;
+}
+
+uint64_t BlockCache::newFileId() noexcept {
+    static std::atomic<uint64_t> next_id = 1;
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t BlockCache::KeyHash::operator()(const Key& key) const noexcept {
+    uint64_t data[2] = { key.file_id, key.offset };
+    return static_cast<size_t>(Utils::hash64(data, sizeof(data)));
+}
+
+BlockCache::Shard& BlockCache::shardFor(const Key& key) {
+    return shards_[KeyHash{}(key) % shards_.size()];
+}
+
+BlockCache::Block BlockCache::lookup(uint64_t file_id, uint64_t offset) {
+    Key key{ file_id, offset };
+    auto& shard = shardFor(key);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.map.find(key);
+    if (it == shard.map.end()) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return it->second->second;
+}
+
+void BlockCache::insert(uint64_t file_id, uint64_t offset, Block block) {
+    Key key{ file_id, offset };
+    auto& shard = shardFor(key);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.map.find(key);
+    if (it != shard.map.end()) {
+        shard.eraseLocked(it->second);
+    }
+    if (!block || block->size() > shard.capacity) {
+        return;
+    }
+    shard.usage += block->size();
+    shard.lru.emplace_front(key, std::move(block));
+    shard.map.emplace(key, shard.lru.begin());
+    shard.evict();
+}
+
+BlockCache::Block BlockCache::insertIfAbsent(uint64_t file_id, uint64_t offset, Block block) {
+    Key key{ file_id, offset };
+    auto& shard = shardFor(key);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.map.find(key);
+    if (it != shard.map.end()) {
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return it->second->second;
+    }
+    if (!block || block->size() > shard.capacity) {
+        return block;
+    }
+    shard.usage += block->size();
+    shard.lru.emplace_front(key, block);
+    shard.map.emplace(key, shard.lru.begin());
+    shard.evict();
+    return block;
+}
+
+void BlockCache::erase(uint64_t file_id, uint64_t offset) {
+    Key key{ file_id, offset };
+    auto& shard = shardFor(key);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.map.find(key);
+    if (it != shard.map.end()) {
+        shard.eraseLocked(it->second);
+    }
+}
+
+void BlockCache::eraseFile(uint64_t file_id) {
+    for (auto& shard : shards_) {
+        std::lock_guard lock(shard.mutex);
+        for (auto it = shard.lru.begin(); it != shard.lru.end();) {
+            auto next = std::next(it);
+            if (it->first.file_id == file_id) {
+                shard.eraseLocked(it);
+            }
+            it = next;
+        }
+    }
+}
+
+void BlockCache::setCapacity(size_t capacity_bytes) {
+    capacity_ = capacity_bytes;
+    for (auto& shard : shards_) {
+        std::lock_guard lock(shard.mutex);
+        shard.capacity = capacity_bytes / shards_.size();
+        shard.evict();
+    }
+}
+
+void BlockCache::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard lock(shard.mutex);
+        shard.map.clear();
+        shard.lru.clear();
+        shard.usage = 0;
+    }
+}
+
+BlockCache::Stats BlockCache::stats() const {
+    Stats stats;
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_relaxed);
+    stats.capacity_bytes = capacity_.load();
+    for (const auto& shard : shards_) {
+        std::lock_guard lock(shard.mutex);
+        stats.usage_bytes += shard.usage;
+    }
+    return stats;
+}
+
+void BlockCache::resetStats() noexcept {
+    hits_ = 0;
+    misses_ = 0;
+}
+
+void BlockCache::Shard::evict() {
+    while (usage > capacity && !lru.empty()) {
+        eraseLocked(std::prev(lru.end()));
+    }
+}
+
+void BlockCache::Shard::eraseLocked(LruList::iterator it) {
+    usage -= it->second->size();
+    map.erase(it->first);
+    lru.erase(it);
+}
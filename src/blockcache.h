@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Process-wide cache of SST DataBlocks, shared by all open SST files.
+// Blocks are keyed by (file id, block offset) and evicted in LRU order once the total size
+// of cached blocks exceeds the capacity. The key space is split into shards with their own
+// lock and LRU list, so concurrent readers rarely wait for each other.
+class BlockCache {
+public:
+    using Block = std::shared_ptr<const std::vector<uint8_t>>;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t usage_bytes = 0;
+        size_t capacity_bytes = 0;
+
+        double hitRatio() const noexcept {
+            return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(hits + misses);
+        }
+    };
+
+    static constexpr size_t DEFAULT_NUM_SHARDS = 16;
+
+    explicit BlockCache(size_t capacity_bytes, size_t num_shards = DEFAULT_NUM_SHARDS);
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    // Cache used by SSTFile
+    static BlockCache& instance();
+    // Unique id for a newly opened file, ids are never reused
+    static uint64_t newFileId() noexcept;
+
+    // Counts a hit or a miss
+    Block lookup(uint64_t file_id, uint64_t offset);
+    // Replaces the cached block if it is already there. Blocks larger than a shard are not cached.
+    void insert(uint64_t file_id, uint64_t offset, Block block);
+    // Keeps the cached block if it is already there and returns it, otherwise inserts the block and returns it
+    Block insertIfAbsent(uint64_t file_id, uint64_t offset, Block block);
+    void erase(uint64_t file_id, uint64_t offset);
+    // Drops all blocks of the file
+    void eraseFile(uint64_t file_id);
+    // Evicts blocks until the new capacity is respected, 0 disables caching
+    void setCapacity(size_t capacity_bytes);
+    void clear();
+    Stats stats() const;
+    void resetStats() noexcept;
+
+private:
+    struct Key {
+        uint64_t file_id;
+        uint64_t offset;
+        bool operator==(const Key&) const = default;
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const noexcept;
+    };
+    struct Shard {
+        using LruList = std::list<std::pair<Key, Block>>; // most recently used in front
+        mutable std::mutex mutex;
+        LruList lru;
+        std::unordered_map<Key, LruList::iterator, KeyHash> map;
+        size_t usage = 0;
+        size_t capacity = 0;
+
+        void evict();
+        void eraseLocked(LruList::iterator it);
+    };
+
+    Shard& shardFor(const Key& key);
+
+    std::vector<Shard> shards_;
+    std::atomic<size_t> capacity_;
+    std::atomic<uint64_t> hits_ = 0;
+    std::atomic<uint64_t> misses_ = 0;
+};
@@ -0,0 +1,77 @@
+#include "bloomfilter.h"
+#include "constants.h"
+#include "utils.h"
+
+#include <algorithm>
+
+namespace filter = sst::filter;
+
+namespace {
+    // Double hashing, k probes are derived from one 64 bit hash
+    struct Probe {
+        uint32_t h;
+        uint32_t delta;
+        explicit Probe(uint64_t hash) noexcept
+            : h(static_cast<uint32_t>(hash)), delta(static_cast<uint32_t>(hash >> 32) | 1) {}
+        uint32_t next() noexcept {
+            auto ret = h;
+            h += delta;
+            return ret;
+        }
+    };
+
+    uint64_t keyHash(std::string_view key) noexcept {
+        return Utils::hash64(key.data(), key.size());
+    }
+}
+
+BloomFilterBuilder::BloomFilterBuilder(uint32_t bits_per_key) : bits_per_key_(bits_per_key) {
+}
+
+void BloomFilterBuilder::addKey(std::string_view key) {
+    hashes_.push_back(keyHash(key));
+}
+
+std::vector<uint8_t> BloomFilterBuilder::build() {
+    // k = ln(2) * bits_per_key minimizes the false positive rate
+    auto num_probes = static_cast<filter::NumProbesFieldType>(
+        std::clamp<uint32_t>(bits_per_key_ * 69 / 100, 1, filter::MAX_NUM_PROBES));
+    // Small filters have high false positive rate, use at least 64 bits
+    uint64_t bits = std::max<uint64_t>(hashes_.size() * bits_per_key_, 64);
+    uint64_t bytes = (bits + 7) / 8;
+    bits = bytes * 8;
+
+    std::vector<uint8_t> data(bytes + filter::NUM_PROBES_SIZE, 0);
+    for (auto hash : hashes_) {
+        Probe probe(hash);
+        for (int i = 0; i < num_probes; ++i) {
+            auto bit = probe.next() % bits;
+            data[bit / 8] |= static_cast<uint8_t>(1 << (bit % 8));
+        }
+    }
+    data.back() = num_probes;
+    hashes_.clear();
+    return data;
+}
+
+BloomFilter::BloomFilter(std::vector<uint8_t> data) : data_(std::move(data)) {
+}
+
+bool BloomFilter::mayContain(std::string_view key) const noexcept {
+    if (data_.size() <= filter::NUM_PROBES_SIZE) {
+        return true;
+    }
+    auto num_probes = data_.back();
+    if (num_probes == 0 || num_probes > filter::MAX_NUM_PROBES) {
+        return true; // Unknown encoding, don't filter
+    }
+    uint64_t bits = (data_.size() - filter::NUM_PROBES_SIZE) * 8;
+    Probe probe(keyHash(key));
+    for (int i = 0; i < num_probes; ++i) {
+        auto bit = probe.next() % bits;
+        if ((data_[bit / 8] & (1 << (bit % 8))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Collects key hashes of an SST file and builds its filter block:
+// [Bits][NumProbes]
+class BloomFilterBuilder {
+public:
+    explicit BloomFilterBuilder(uint32_t bits_per_key);
+    void addKey(std::string_view key);
+    bool empty() const noexcept {
+        return hashes_.empty();
+    }
+    std::vector<uint8_t> build();
+
+private:
+    uint32_t bits_per_key_;
+    std::vector<uint64_t> hashes_;
+};
+
+// Read side of the filter block. May answer true for a key that is absent,
+// never answers false for a key that was added.
+class BloomFilter {
+public:
+    BloomFilter() = default; // empty filter passes every key
+    explicit BloomFilter(std::vector<uint8_t> data);
+    bool mayContain(std::string_view key) const noexcept;
+    size_t size() const noexcept {
+        return data_.size();
+    }
+
+private:
+    std::vector<uint8_t> data_;
+};
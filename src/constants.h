@@ -14,7 +14,15 @@ namespace sst {
         // Signature size in SST header (uint32_t)
         constexpr char SST_SIGNATURE[] = "VSSF";
         constexpr size_t SST_SIGNATURE_SIZE = sizeof(SST_SIGNATURE) - 1; // Exclude null terminator
-        constexpr uint8_t SST_VERSION = 1; 
+        // 1 - initial format, 2 - filter block after the index block
+        constexpr uint8_t SST_VERSION_V1 = 1;
+        constexpr uint8_t SST_VERSION_FILTER = 2;
+        constexpr uint8_t SST_VERSION_PREFIX = 3; // prefix-compressed keys in DataBlocks
+        constexpr uint8_t SST_VERSION_COMPACT = 4; // varint lengths, optional expiration
+        constexpr uint8_t SST_VERSION_PARTITIONED = 5; // index partitions loaded on demand
+        constexpr uint8_t SST_VERSION_FOOTER = 6; // properties block and fixed-size footer
+        constexpr uint8_t SST_VERSION_KEY_RANGE = 7; // min key in the properties block
+        constexpr uint8_t SST_VERSION = SST_VERSION_KEY_RANGE; // version of newly written files
         constexpr uint64_t SST_SEQUENCE_SIZE = sizeof(uint64_t); // Sequence number size in SST header (uint64_t)
         // Version in SST header (uint8_t)
         constexpr size_t SST_VERSION_SIZE = 1;
@@ -39,6 +47,26 @@ namespace sst {
         constexpr size_t DATABLOCK_COUNT_SIZE = sizeof(CountFieldType);
         constexpr size_t MIN_ENTRY_SIZE = KEY_LEN_SIZE + EXPIRATION_SIZE + VALUE_TYPE_SIZE;
         constexpr size_t MAX_KEY_LENGTH = 1024;
+        // Prefix-compressed blocks (since SST_VERSION_PREFIX)
+        using SharedLengthFieldType = KeyLengthFieldType;
+        constexpr size_t SHARED_LEN_SIZE = sizeof(SharedLengthFieldType);
+        constexpr uint32_t RESTART_INTERVAL = 16; // every 16th key is stored in full
+        constexpr ValueTypeFieldType REMOVED_FLAG = 0x80; // set on removal, the low bits keep the value type
+        constexpr ValueTypeFieldType VALUE_TYPE_MASK = 0x7F;
+        // Compact entries (since SST_VERSION_COMPACT)
+        constexpr ValueTypeFieldType EXPIRATION_FLAG = 0x40; // Expiration follows the type byte
+        constexpr ValueTypeFieldType COMPACT_VALUE_TYPE_MASK = 0x3F;
+        // Optional hash index of point lookups after the restart table (since SST_VERSION_COMPACT)
+        using HashBucketFieldType = uint16_t; // restart point of the keys hashed to the bucket
+        using NumBucketsFieldType = uint16_t;
+        constexpr size_t HASH_BUCKET_SIZE = sizeof(HashBucketFieldType);
+        constexpr size_t NUM_BUCKETS_SIZE = sizeof(NumBucketsFieldType);
+        constexpr CountFieldType HASH_INDEX_FLAG = 0x80000000; // set in Count if the block has a hash index
+        constexpr HashBucketFieldType HASH_BUCKET_EMPTY = 0xFFFF;
+        constexpr HashBucketFieldType HASH_BUCKET_COLLISION = 0xFFFE; // keys of several restart points
+        constexpr uint32_t MAX_HASH_INDEX_RESTARTS = HASH_BUCKET_COLLISION; // larger blocks are written without index
+        constexpr uint32_t MAX_HASH_BUCKETS = 0xFFFF;
+        constexpr size_t MIN_HASH_INDEX_SIZE = 2 * HASH_BUCKET_SIZE + NUM_BUCKETS_SIZE; // of a block with one entry
         // Expiration special values (for not set and for deleted)
         constexpr uint64_t EXPIRATION_NOT_SET = 0ull;
         constexpr uint64_t EXPIRATION_DELETED = 1ull;
@@ -50,5 +78,53 @@ namespace sst {
         constexpr size_t INDEX_KEY_LEN = sizeof(IndexKeyLengthFieldType);
         constexpr size_t BLOCK_OFFSET_SIZE = sizeof(OffsetFieldType);
         constexpr size_t INDEX_BLOCK_COUNT_SIZE = sizeof(CountFieldType);
+        // Index partitions and the top-level index (since SST_VERSION_PARTITIONED)
+        using EntryOffsetFieldType = uint32_t;
+        using IndexLevelsFieldType = uint8_t;
+        constexpr size_t ENTRY_OFFSET_SIZE = sizeof(EntryOffsetFieldType);
+        constexpr size_t END_OFFSET_SIZE = sizeof(OffsetFieldType);
+        constexpr size_t INDEX_LEVELS_SIZE = sizeof(IndexLevelsFieldType);
+        constexpr IndexLevelsFieldType SINGLE_LEVEL_INDEX = 1; // the index points at DataBlocks
+        constexpr IndexLevelsFieldType TWO_LEVEL_INDEX = 2;    // the index points at index partitions
+    }
+    namespace filter {
+        using FilterSizeFieldType = uint32_t;
+        using NumProbesFieldType = uint8_t;
+        constexpr size_t FILTER_SIZE_SIZE = sizeof(FilterSizeFieldType);
+        constexpr size_t NUM_PROBES_SIZE = sizeof(NumProbesFieldType);
+        constexpr uint32_t DEFAULT_BITS_PER_KEY = 10; // ~1% false positives
+        constexpr uint32_t MAX_BITS_PER_KEY = 32;
+        constexpr uint32_t MAX_NUM_PROBES = 30;
+    }
+    // Properties block and footer (since SST_VERSION_FOOTER)
+    namespace footer {
+        using BlockOffsetFieldType = uint64_t;
+        using BlockSizeFieldType = uint32_t;
+        using NumEntriesFieldType = uint64_t;
+        using NumBlocksFieldType = uint64_t;
+        constexpr size_t BLOCK_OFFSET_SIZE = sizeof(BlockOffsetFieldType);
+        constexpr size_t BLOCK_SIZE_SIZE = sizeof(BlockSizeFieldType);
+        constexpr size_t BLOCK_HANDLE_SIZE = BLOCK_OFFSET_SIZE + BLOCK_SIZE_SIZE;
+        // [Index handle][IndexLevels][Filter handle][Properties handle][Version][Signature]
+        constexpr size_t FOOTER_SIZE = BLOCK_HANDLE_SIZE + indexblock::INDEX_LEVELS_SIZE + 2 * BLOCK_HANDLE_SIZE +
+            header::SST_VERSION_SIZE + header::SST_SIGNATURE_SIZE;
+        // Opening a file reads this many bytes from its end, the index, the filter and the properties
+        // of small files are read at once with the footer
+        constexpr size_t TAIL_READ_SIZE = 16 * 1024;
+    }
+    namespace cache {
+        constexpr size_t DEFAULT_BLOCK_CACHE_SIZE = 64 * 1024 * 1024; // 64 MB
+        constexpr size_t MAX_SCAN_READAHEAD_BLOCKS = 16; // prefix scans read up to this many blocks at once
+        constexpr size_t DEFAULT_MAX_OPEN_FILES = 1000; // descriptors kept open by the table cache
+    }
+    namespace wal {
+        using ChecksumFieldType = uint32_t;
+        using LengthFieldType = uint32_t;
+        using CountFieldType = uint32_t;
+        constexpr size_t CHECKSUM_SIZE = sizeof(ChecksumFieldType);
+        constexpr size_t LENGTH_SIZE = sizeof(LengthFieldType);
+        constexpr size_t COUNT_SIZE = sizeof(CountFieldType);
+        // Checksum + Length precede every record payload
+        constexpr size_t RECORD_HEADER_SIZE = CHECKSUM_SIZE + LENGTH_SIZE;
     }
 }
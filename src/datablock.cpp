@@ -1,18 +1,82 @@
 #include "datablock.h"
 #include "utils.h"
+#include <algorithm>
+#include <limits>
 
 namespace dblock = sst::datablock;
 
-DataBlockBuilder::DataBlockBuilder(uint32_t max_block_size) : max_block_size_(max_block_size) {
+namespace {
+    // Bytes taken by a serialized value, blob-like values start with ValueLen (4 bytes or a varint)
+    size_t valueSize(ValueType type, const uint8_t* data, size_t available, bool varint_length) {
+        switch (type) {
+        case ValueType::UINT8:
+        case ValueType::INT8:
+            return sizeof(uint8_t);
+        case ValueType::UINT16:
+        case ValueType::INT16:
+            return sizeof(uint16_t);
+        case ValueType::UINT32:
+        case ValueType::INT32:
+        case ValueType::FLOAT:
+            return sizeof(uint32_t);
+        case ValueType::UINT64:
+        case ValueType::INT64:
+        case ValueType::DOUBLE:
+            return sizeof(uint64_t);
+        case ValueType::STRING:
+        case ValueType::U8STRING:
+        case ValueType::BLOB:
+            if (varint_length) {
+                uint64_t len = 0;
+                size_t len_size = Utils::deserializeVarint(data, available, len);
+                if (len_size == 0) {
+                    throw std::runtime_error("DataBlock corrupted: Value length exceeds data bounds.");
+                }
+                return len_size + len;
+            }
+            if (available < dblock::VALUE_LEN_SIZE) {
+                throw std::runtime_error("DataBlock corrupted: Value length exceeds data bounds.");
+            }
+            return dblock::VALUE_LEN_SIZE + Utils::deserializeLE<dblock::ValueLengthFieldType>(data);
+        default:
+            throw std::runtime_error("DataBlock corrupted: Unknown value type.");
+        }
+    }
+
+    size_t sharedPrefixLength(std::string_view a, std::string_view b) {
+        size_t n = std::min({ a.size(), b.size(), size_t(std::numeric_limits<dblock::SharedLengthFieldType>::max()) });
+        size_t i = 0;
+        while (i < n && a[i] == b[i]) {
+            ++i;
+        }
+        return i;
+    }
+
+    // Buckets are about 75% full with distinct keys
+    uint32_t numHashBuckets(uint32_t count) noexcept {
+        return std::min<uint32_t>(dblock::MAX_HASH_BUCKETS, count + count / 3 + 1);
+    }
+
+    uint64_t keyHash(std::string_view key) noexcept {
+        return Utils::hash64(key.data(), key.size());
+    }
+}
+
+DataBlockBuilder::DataBlockBuilder(uint32_t max_block_size, uint8_t version, bool hash_index)
+    : max_block_size_(max_block_size), version_(version),
+    hash_index_(hash_index && version >= sst::header::SST_VERSION_COMPACT) {
     raw_data_.reserve(max_block_size);
 }
 
 bool DataBlockBuilder::addEntry(const std::string& key, const Entry& entry, uint64_t expiration_ms) {
+    if (version_ >= sst::header::SST_VERSION_PREFIX) {
+        return addPrefixCompressed(key, entry, expiration_ms);
+    }
     uint32_t value_size = Utils::onDiskSize(entry.value);
     auto offset_table_size = offset_table_.size() * sizeof(decltype(offset_table_)::value_type);
 
     //Current block size + new record size + current offset table size + new offset entry + offset_table_size
-    uint64_t new_size = raw_data_.size() + Utils::onDiskEntrySize(key, entry.value) +
+    uint64_t new_size = raw_data_.size() + Utils::onDiskEntrySize(key, entry.value) - dblock::SHARED_LEN_SIZE +
         offset_table_size + dblock::DATABLOCK_COUNT_SIZE + sst::datablock::OFFSET_ENTRY_SIZE;
     if (new_size > max_block_size_) {
         return false;
@@ -26,39 +90,113 @@ bool DataBlockBuilder::addEntry(const std::string& key, const Entry& entry, uint
     Utils::serializeLE(expiration_ms, raw_data_);
     static_assert(sizeof(ValueType) == sizeof(uint8_t));
     Utils::serializeLE(static_cast<uint8_t>(entry.type), raw_data_);
-    std::visit([this](const auto& val) {
-        using T = std::decay_t<decltype(val)>;
-        if constexpr (SupportedInteger<T> || SupportedReal<T>) {
-            Utils::serializeLE(val, raw_data_);
-        }
-        else if constexpr (SupportedBlob<T>) {
-            dblock::ValueLengthFieldType value_len = val.size() * sizeof(typename T::value_type);
-            Utils::serializeLE(value_len, raw_data_);
-            raw_data_.insert(raw_data_.end(), val.begin(), val.end());
+    Utils::serializeValue(entry.value, raw_data_);
+    ++count_;
+    return true;
+}
+
+bool DataBlockBuilder::addPrefixCompressed(const std::string& key, const Entry& entry, uint64_t expiration_ms) {
+    bool compact = version_ >= sst::header::SST_VERSION_COMPACT;
+    bool restart = count_ % dblock::RESTART_INTERVAL == 0;
+    size_t shared = restart ? 0 : sharedPrefixLength(last_key_, key);
+    size_t unshared = key.size() - shared;
+    bool removed = entry.type == ValueType::REMOVED;
+    bool has_expiration = !compact || expiration_ms != dblock::EXPIRATION_NOT_SET;
+    size_t value_size = removed ? 0 : (compact ? Utils::onDiskSizeVarint(entry.value) : Utils::onDiskSize(entry.value));
+    size_t lengths_size = compact ? Utils::varintSize(shared) + Utils::varintSize(unshared)
+        : dblock::SHARED_LEN_SIZE + dblock::KEY_LEN_SIZE;
+    size_t entry_size = lengths_size + unshared + (has_expiration ? dblock::EXPIRATION_SIZE : 0) +
+        dblock::VALUE_TYPE_SIZE + value_size;
+    size_t num_restarts = offset_table_.size() + (restart ? 1 : 0);
+    uint64_t new_size = raw_data_.size() + entry_size + num_restarts * dblock::OFFSET_ENTRY_SIZE +
+        dblock::DATABLOCK_COUNT_SIZE + hashIndexSize(count_ + 1);
+    if (new_size > max_block_size_) {
+        return false;
+    }
+
+    if (restart) {
+        offset_table_.push_back(static_cast<uint32_t>(raw_data_.size()));
+    }
+    if (compact) {
+        Utils::serializeVarint(shared, raw_data_);
+        Utils::serializeVarint(unshared, raw_data_);
+    }
+    else {
+        Utils::serializeLE(static_cast<dblock::SharedLengthFieldType>(shared), raw_data_);
+        Utils::serializeLE(static_cast<dblock::KeyLengthFieldType>(unshared), raw_data_);
+    }
+    raw_data_.insert(raw_data_.end(), key.begin() + shared, key.end());
+    if (compact) {
+        // [Type|Flags][Expiration, only if set]
+        auto type = removed ? static_cast<uint8_t>(dblock::REMOVED_FLAG | dblock::COMPACT_VALUE_TYPE_MASK)
+            : static_cast<uint8_t>(entry.type);
+        if (has_expiration) {
+            type |= dblock::EXPIRATION_FLAG;
         }
-        else {
-            static_assert(always_false<T>::value, "Unsupported type for serialization in DataBlockBuilder");
+        Utils::serializeLE(type, raw_data_);
+        if (has_expiration) {
+            Utils::serializeLE(expiration_ms, raw_data_);
         }
-        }, entry.value);
+    }
+    else {
+        Utils::serializeLE(expiration_ms, raw_data_);
+        Utils::serializeLE(static_cast<uint8_t>(entry.type), raw_data_); // REMOVED has all bits set, no value follows
+    }
+    if (!removed) {
+        Utils::serializeValue(entry.value, raw_data_, compact);
+    }
+    if (hash_index_) {
+        key_hashes_.push_back(keyHash(key));
+    }
+    last_key_ = key;
     ++count_;
     return true;
 }
 
+uint64_t DataBlockBuilder::hashIndexSize(uint32_t count) const noexcept {
+    if (!hash_index_) {
+        return 0;
+    }
+    return static_cast<uint64_t>(numHashBuckets(count)) * dblock::HASH_BUCKET_SIZE + dblock::NUM_BUCKETS_SIZE;
+}
+
 bool DataBlockBuilder::empty() const noexcept {
     return count_ == 0;
 }
 
 uint64_t DataBlockBuilder::size() const noexcept {
     return raw_data_.size() + offset_table_.size() * sizeof(decltype(offset_table_)::value_type)
-        +sizeof(count_);
+        +sizeof(count_) + (count_ > 0 ? hashIndexSize(count_) : 0);
 }
 
 std::vector<uint8_t> DataBlockBuilder::build() {
     for (const auto& offset : offset_table_) {
         Utils::serializeLE(offset, raw_data_);
     }
-    Utils::serializeLE(count_, raw_data_);
+    auto count = count_;
+    if (hash_index_ && offset_table_.size() <= dblock::MAX_HASH_INDEX_RESTARTS) {
+        // [Buckets][NumBuckets][Count | HASH_INDEX_FLAG]
+        std::vector<dblock::HashBucketFieldType> buckets(numHashBuckets(count_), dblock::HASH_BUCKET_EMPTY);
+        for (uint32_t i = 0; i < count_; ++i) {
+            auto& bucket = buckets[key_hashes_[i] % buckets.size()];
+            auto restart = static_cast<dblock::HashBucketFieldType>(i / dblock::RESTART_INTERVAL);
+            if (bucket == dblock::HASH_BUCKET_EMPTY) {
+                bucket = restart;
+            }
+            else if (bucket != restart) {
+                bucket = dblock::HASH_BUCKET_COLLISION;
+            }
+        }
+        for (auto bucket : buckets) {
+            Utils::serializeLE(bucket, raw_data_);
+        }
+        Utils::serializeLE(static_cast<dblock::NumBucketsFieldType>(buckets.size()), raw_data_);
+        count |= dblock::HASH_INDEX_FLAG;
+    }
+    Utils::serializeLE(count, raw_data_);
     offset_table_.clear();
+    key_hashes_.clear();
+    last_key_.clear();
     count_ = 0;
     std::vector<uint8_t> ret;
     ret.swap(raw_data_);
@@ -66,66 +204,104 @@ std::vector<uint8_t> DataBlockBuilder::build() {
 }
 
 
-DataBlock::DataBlock(std::vector<uint8_t> data) : data_(std::move(data)) {
-    if (data_.size() < sizeof(count_)) {
+DataBlock::DataBlock(std::vector<uint8_t> data, uint8_t version)
+    : DataBlock(std::make_shared<const std::vector<uint8_t>>(std::move(data)), version) {
+}
+
+DataBlock::DataBlock(Buffer data, uint8_t version) : version_(version) {
+    if (!data) {
+        throw std::runtime_error("DataBlock corrupted: No data.");
+    }
+    size_ = data->size();
+    data_ = std::shared_ptr<const uint8_t>(data, data->data()); // shares ownership of the vector
+    parseLayout();
+}
+
+DataBlock::DataBlock(std::shared_ptr<const uint8_t> data, size_t size, uint8_t version)
+    : data_(std::move(data)), size_(size), version_(version) {
+    if (!data_) {
+        throw std::runtime_error("DataBlock corrupted: No data.");
+    }
+    parseLayout();
+}
+
+void DataBlock::parseLayout() {
+    auto data = this->data();
+    if (data.size() < sizeof(count_)) {
         throw std::runtime_error("DataBlock corrupted: Data size is too small to contain a valid block.");
     }
-    count_ = Utils::deserializeLE<dblock::CountFieldType>(data_.data() + data_.size() - sizeof(count_));
+    count_ = Utils::deserializeLE<dblock::CountFieldType>(data.data() + data.size() - sizeof(count_));
+    uint64_t trailer_size = sizeof(count_);
+    num_buckets_ = 0;
+    if (compact() && (count_ & dblock::HASH_INDEX_FLAG)) {
+        count_ &= ~dblock::HASH_INDEX_FLAG;
+        if (data.size() < trailer_size + dblock::NUM_BUCKETS_SIZE) {
+            throw std::runtime_error("DataBlock corrupted: Data size is too small to contain a valid hash index.");
+        }
+        num_buckets_ = Utils::deserializeLE<dblock::NumBucketsFieldType>(data.data() + data.size() - trailer_size - dblock::NUM_BUCKETS_SIZE);
+        trailer_size += dblock::NUM_BUCKETS_SIZE + static_cast<uint64_t>(num_buckets_) * dblock::HASH_BUCKET_SIZE;
+        if (num_buckets_ == 0 || data.size() < trailer_size) {
+            throw std::runtime_error("DataBlock corrupted: Data size is too small to contain a valid hash index.");
+        }
+        hash_buckets_pos_ = static_cast<uint32_t>(data.size() - trailer_size);
+    }
     if (count_ == 0) {
         throw std::runtime_error("DataBlock corrupted: Block contains no entries.");
     }
-    auto offset_table_size = count_ * sizeof(dblock::OffsetEntryFieldType);
-    if (data_.size() < sizeof(count_) + offset_table_size) {
+    restart_interval_ = prefixCompressed() ? dblock::RESTART_INTERVAL : 1;
+    num_restarts_ = (count_ + restart_interval_ - 1) / restart_interval_;
+    auto offset_table_size = static_cast<uint64_t>(num_restarts_) * sizeof(dblock::OffsetEntryFieldType);
+    if (data.size() < trailer_size + offset_table_size) {
         throw std::runtime_error("DataBlock corrupted: Data size is too small to contain a valid offset table.");
     }
-    offset_table_pos_ = static_cast<sst::datablock::OffsetEntryFieldType>(data_.size() - sizeof(count_) - offset_table_size);
-    max_entry_ptr_ = static_cast<uint32_t>(data_.size() - sizeof(count_) - offset_table_size);
+    offset_table_pos_ = static_cast<sst::datablock::OffsetEntryFieldType>(data.size() - trailer_size - offset_table_size);
+    max_entry_ptr_ = offset_table_pos_;
 }
 
-std::optional<Entry> DataBlock::get(const std::string& key) const {
-    auto offset = lowerBoundOffset(key);
-    if (offset >= count_) {
+std::optional<Entry> DataBlock::get(std::string_view key) const {
+    auto cursor = find(key);
+    if (cursor.index >= count_) {
         return std::nullopt;
     }
-    auto cursor = posByOffset(offset);
-    std::string entry_key = parseKey(cursor);
-    if (entry_key != key) {
-        return std::nullopt;
-    }
-    ValueType type = parseValueType(cursor, key.size());
+    ValueType type = effectiveType(cursor);
     if (type == ValueType::REMOVED) {
         return Entry{ type, {} };
     }
-    return Entry{ type, parseValue(cursor, key.size(), type) };
+    return Entry{ type, parseValue(cursor) };
+}
+
+std::string DataBlock::keyAt(sst::datablock::CountFieldType offsetIdx) const
+{
+    return std::string(seek(offsetIdx).key());
+}
+
+void DataBlock::forEachKey(const std::function<void(std::string_view)>& callback) const {
+    for (auto cursor = seekRestart(0); cursor.index < count_; next(cursor)) {
+        callback(cursor.key());
+    }
 }
 
 std::pair<std::string, DataBlock::DataBlockEntry> DataBlock::get(sst::datablock::CountFieldType offsetIdx) const
 {
-    auto cursor = posByOffset(offsetIdx);
-    auto key = parseKey(cursor);
-    ValueType type = parseValueType(cursor, key.size());
-    uint64_t expiration_pos = cursor + key.size() + dblock::KEY_LEN_SIZE;
-    auto expiration_ms = Utils::deserializeLE<dblock::ExpirationFieldType>(&data_[expiration_pos]);
+    auto cursor = seek(offsetIdx);
+    std::string key(cursor.key());
+    ValueType type = effectiveType(cursor);
     if (type == ValueType::REMOVED) {
-        return { key, DataBlockEntry{{ type, {}}, expiration_ms } };
+        return { key, DataBlockEntry{{ type, {}}, cursor.expiration_ms } };
     }
-    return { key, DataBlockEntry{{ type, parseValue(cursor, key.size(), type) }, expiration_ms} };
+    return { key, DataBlockEntry{{ type, parseValue(cursor) }, cursor.expiration_ms} };
 }
 
-std::vector<std::string> DataBlock::keysWithPrefix(const std::string& prefix, unsigned int max_results) const {
+std::vector<std::string> DataBlock::keysWithPrefix(std::string_view prefix, unsigned int max_results) const {
     std::vector<std::string> result;
     if (count_ == 0) return result;
     result.reserve(std::min(static_cast<uint32_t>(max_results), count_));
-    auto offset_idx = lowerBoundOffset(prefix);
-    for (sst::datablock::CountFieldType i = offset_idx; i < count_ && result.size() < static_cast<size_t>(max_results); ++i) {
-        uint64_t pos = posByOffset(i);
-        std::string entry_key = parseKey(pos);
-        if (entry_key.compare(0, prefix.size(), prefix) == 0) {
-            ValueType type = parseValueType(pos, entry_key.size());
-            if (type == ValueType::REMOVED) {
+    for (auto cursor = lowerBound(prefix); cursor.index < count_ && result.size() < static_cast<size_t>(max_results); next(cursor)) {
+        if (cursor.key().starts_with(prefix)) {
+            if (effectiveType(cursor) == ValueType::REMOVED) {
                 continue;
             }
-            result.push_back(entry_key);
+            result.emplace_back(cursor.key());
         }
         else {
             break;
@@ -134,19 +310,15 @@ std::vector<std::string> DataBlock::keysWithPrefix(const std::string& prefix, un
     return result;
 }
 
-bool DataBlock::forEachKeyWithPrefix(const std::string& prefix,
+bool DataBlock::forEachKeyWithPrefix(std::string_view prefix,
     const std::function<bool(const std::string&)>& callback) const {
     if (count_ == 0) return true; // No entries to iterate over
-    auto offset_idx = lowerBoundOffset(prefix);
-    for (sst::datablock::CountFieldType i = offset_idx; i < count_; ++i) {
-        uint64_t pos = posByOffset(i);
-        std::string entry_key = parseKey(pos);
-        if (entry_key.compare(0, prefix.size(), prefix) == 0) {
-            ValueType type = parseValueType(pos, entry_key.size());
-            if (type == ValueType::REMOVED) {
+    for (auto cursor = lowerBound(prefix); cursor.index < count_; next(cursor)) {
+        if (cursor.key().starts_with(prefix)) {
+            if (effectiveType(cursor) == ValueType::REMOVED) {
                 continue;
             }
-            if (!callback(entry_key)) {
+            if (!callback(std::string(cursor.key()))) {
                 return false; // Stop iteration if callback returns false
             }
         }
@@ -158,147 +330,271 @@ bool DataBlock::forEachKeyWithPrefix(const std::string& prefix,
     
 }
 
-bool DataBlock::remove(const std::string& key) {
-    auto offset = lowerBoundOffset(key);
-    if (offset >= count_) {
-        return false;
-    }
-    auto pos = posByOffset(offset);
-    std::string entry_key = parseKey(pos);
-    if (entry_key != key) {
+bool DataBlock::remove(std::string_view key) {
+    auto cursor = find(key);
+    if (cursor.index >= count_) {
         return false;
     }
-    ValueType type = parseValueType(pos, key.size());
-    if (type == ValueType::REMOVED) {
+    if (effectiveType(cursor) == ValueType::REMOVED) {
         return true;
     }
     // don't need to serialize one byte
     static_assert(sizeof(ValueType) == sizeof(uint8_t));
-    data_[pos + key.size() + dblock::KEY_LEN_SIZE + dblock::EXPIRATION_SIZE] = static_cast<uint8_t>(ValueType::REMOVED);
+    auto data = std::make_shared<std::vector<uint8_t>>(bytes(), bytes() + size_);
+    if (prefixCompressed()) {
+        (*data)[cursor.type_pos] |= dblock::REMOVED_FLAG; // the value type is kept, later entries are still found
+    }
+    else {
+        (*data)[cursor.type_pos] = static_cast<uint8_t>(ValueType::REMOVED);
+    }
+    data_ = std::shared_ptr<const uint8_t>(data, data->data());
     return true;  
 }
 
-EntryStatus DataBlock::status(const std::string& key) const {
-    auto offset = lowerBoundOffset(key);
-    if (offset >= count_) {
+EntryStatus DataBlock::status(std::string_view key) const {
+    auto cursor = find(key);
+    if (cursor.index >= count_) {
         return EntryStatus::NOT_FOUND; // Key not found
     }
-    auto pos = posByOffset(offset);
-    std::string entry_key = parseKey(pos);
-    if (entry_key != key) {
+    if (effectiveType(cursor) == ValueType::REMOVED) {
+        return EntryStatus::REMOVED;
+    }
+    return EntryStatus::EXISTS;
+}
+
+EntryStatus DataBlock::getRaw(std::string_view key, const RawValueCallback& callback) const {
+    auto cursor = find(key);
+    if (cursor.index >= count_) {
         return EntryStatus::NOT_FOUND;
     }
-    ValueType type = parseValueType(pos, key.size());
+    ValueType type = effectiveType(cursor);
     if (type == ValueType::REMOVED) {
         return EntryStatus::REMOVED;
     }
+    if (cursor.value_pos > max_entry_ptr_) {
+        throw std::runtime_error("DataBlock corrupted: Value exceeds data bounds.");
+    }
+    callback(RawValue{ type, bytes() + cursor.value_pos, max_entry_ptr_ - cursor.value_pos, compact(), cursor.expiration_ms });
     return EntryStatus::EXISTS;
 }
 
-uint64_t DataBlock::posByOffset(sst::datablock::CountFieldType offsetIdx) const
+uint64_t DataBlock::restartPos(uint32_t restart) const
 {
-    auto offset_table_ptr_ = reinterpret_cast<const dblock::OffsetEntryFieldType*>(&data_[offset_table_pos_]);
-    return Utils::deserializeLE<dblock::OffsetEntryFieldType>(reinterpret_cast<const uint8_t*>(&offset_table_ptr_[offsetIdx]));
+    auto offset_table_ptr_ = reinterpret_cast<const dblock::OffsetEntryFieldType*>(bytes() + offset_table_pos_);
+    return Utils::deserializeLE<dblock::OffsetEntryFieldType>(reinterpret_cast<const uint8_t*>(&offset_table_ptr_[restart]));
 }
 
-ValueType DataBlock::parseValueType(uint64_t pos, sst::datablock::KeyLengthFieldType key_size) const {
-    uint64_t cursor = pos + key_size + dblock::KEY_LEN_SIZE;
-    if (cursor + dblock::EXPIRATION_SIZE + dblock::VALUE_TYPE_SIZE > max_entry_ptr_) {
-        throw std::runtime_error("DataBlock corrupted: Offset points outside of data bounds.");
-    }
-    auto expiration_ms = Utils::deserializeLE<dblock::ExpirationFieldType>(&data_[cursor]);
-    if (Utils::isExpired(expiration_ms)) {
-        return ValueType::REMOVED;
+std::string_view DataBlock::restartKey(uint32_t restart) const
+{
+    uint64_t pos = restartPos(restart);
+    size_t shared = 0;
+    auto key = parseStoredKey(pos, shared);
+    if (shared != 0) {
+        throw std::runtime_error("DataBlock corrupted: Restart point with a shared key prefix.");
     }
-    cursor += sizeof(expiration_ms);
-    return static_cast<ValueType>(Utils::deserializeLE<dblock::ValueTypeFieldType>(&data_[cursor]));
+    return key; // in place, no allocation
 }
 
-std::string DataBlock::parseKey(uint64_t pos) const
+uint64_t DataBlock::parseLength(uint64_t& pos, size_t fixed_size) const
 {
-    if (pos + dblock::KEY_LEN_SIZE > max_entry_ptr_) {
+    if (pos >= max_entry_ptr_) {
         throw std::runtime_error("DataBlock corrupted: Offset points outside of data bounds.");
     }
-    auto key_len = Utils::deserializeLE<dblock::KeyLengthFieldType>(&data_[pos]);
-    if (key_len > dblock::MAX_KEY_LENGTH || pos + key_len > max_entry_ptr_) {
-        throw std::runtime_error("DataBlock corrupted: Key length is invalid or exceeds maximum allowed length.");
+    if (compact()) {
+        uint64_t value = 0;
+        size_t size = Utils::deserializeVarint(bytes() + pos, max_entry_ptr_ - pos, value);
+        if (size == 0) {
+            throw std::runtime_error("DataBlock corrupted: Offset points outside of data bounds.");
+        }
+        pos += size;
+        return value;
+    }
+    if (pos + fixed_size > max_entry_ptr_) {
+        throw std::runtime_error("DataBlock corrupted: Offset points outside of data bounds.");
     }
-    return Utils::deserializeLE<std::string>(&data_[pos + dblock::KEY_LEN_SIZE], key_len);
+    static_assert(sizeof(dblock::SharedLengthFieldType) == sizeof(dblock::KeyLengthFieldType));
+    auto value = Utils::deserializeLE<dblock::KeyLengthFieldType>(bytes() + pos);
+    pos += fixed_size;
+    return value;
 }
 
-Value DataBlock::parseValue(uint64_t entry_start_pos, sst::datablock::KeyLengthFieldType key_size, ValueType type) const
+std::string_view DataBlock::parseStoredKey(uint64_t& pos, size_t& shared) const
 {
-    uint64_t cursor = entry_start_pos + key_size + dblock::KEY_LEN_SIZE + dblock::EXPIRATION_SIZE + dblock::VALUE_TYPE_SIZE;
-    dblock::ValueLengthFieldType value_len;
-    if (type == ValueType::BLOB || type == ValueType::STRING || type == ValueType::U8STRING) {
-        value_len = Utils::deserializeLE<sst::datablock::ValueLengthFieldType>(&data_[cursor]);
-        if (cursor + value_len > max_entry_ptr_) {
-            throw std::runtime_error("DataBlock corrupted: Value length exceeds data bounds.");
-        }
-        if (value_len == 0) {
-            throw std::runtime_error("DataBlock corrupted: Value length is zero.");
-        }
-        cursor += sizeof(value_len);
-    }
-    switch (type) {
-    case ValueType::UINT8: {
-        return Utils::deserializeLE<uint8_t>(&data_[cursor]);
-    }
-    case ValueType::INT8: {
-        return  Utils::deserializeLE<int8_t>(&data_[cursor]);
-    }
-    case ValueType::UINT16: {
-        return Utils::deserializeLE<uint16_t>(&data_[cursor]);
-    }
-    case ValueType::INT16: {
-        return Utils::deserializeLE<int16_t>(&data_[cursor]);
+    shared = prefixCompressed() ? static_cast<size_t>(parseLength(pos, dblock::SHARED_LEN_SIZE)) : 0;
+    auto key_len = parseLength(pos, dblock::KEY_LEN_SIZE);
+    if (shared + key_len > dblock::MAX_KEY_LENGTH || pos + key_len > max_entry_ptr_) {
+        throw std::runtime_error("DataBlock corrupted: Key length is invalid or exceeds maximum allowed length.");
     }
-    case ValueType::UINT32: {
-        return Utils::deserializeLE<uint32_t>(&data_[cursor]);
+    std::string_view key(reinterpret_cast<const char*>(bytes() + pos), static_cast<size_t>(key_len));
+    pos += key_len;
+    return key;
+}
+
+void DataBlock::decode(Cursor& cursor, uint64_t pos) const
+{
+    size_t shared = 0;
+    auto stored = parseStoredKey(pos, shared);
+    if (shared > cursor.key().size()) {
+        throw std::runtime_error("DataBlock corrupted: Key length is invalid or exceeds maximum allowed length.");
     }
-    case ValueType::INT32: {
-        return  Utils::deserializeLE<int32_t>(&data_[cursor]);
+    if (shared == 0) {
+        cursor.key_view = stored; // no copy for full keys
+        cursor.key_in_buf = false;
     }
-    case ValueType::UINT64: {
-        return  Utils::deserializeLE<uint64_t>(&data_[cursor]);
+    else {
+        if (!cursor.key_in_buf) {
+            cursor.key_buf.assign(cursor.key_view.substr(0, shared));
+            cursor.key_in_buf = true;
+        }
+        else {
+            cursor.key_buf.resize(shared);
+        }
+        cursor.key_buf.append(stored);
     }
-    case ValueType::INT64: {
-        return Utils::deserializeLE<int64_t>(&data_[cursor]);
+    if (compact()) {
+        if (pos + dblock::VALUE_TYPE_SIZE > max_entry_ptr_) {
+            throw std::runtime_error("DataBlock corrupted: Offset points outside of data bounds.");
+        }
+        cursor.type_pos = pos;
+        auto type = Utils::deserializeLE<dblock::ValueTypeFieldType>(bytes() + pos);
+        pos += dblock::VALUE_TYPE_SIZE;
+        cursor.expiration_ms = dblock::EXPIRATION_NOT_SET;
+        if (type & dblock::EXPIRATION_FLAG) {
+            if (pos + dblock::EXPIRATION_SIZE > max_entry_ptr_) {
+                throw std::runtime_error("DataBlock corrupted: Offset points outside of data bounds.");
+            }
+            cursor.expiration_ms = Utils::deserializeLE<dblock::ExpirationFieldType>(bytes() + pos);
+            pos += dblock::EXPIRATION_SIZE;
+        }
+        auto base_type = static_cast<dblock::ValueTypeFieldType>(type & dblock::COMPACT_VALUE_TYPE_MASK);
+        cursor.removed = (type & dblock::REMOVED_FLAG) != 0;
+        cursor.type = cursor.removed ? ValueType::REMOVED : static_cast<ValueType>(base_type);
+        cursor.value_pos = pos;
+        cursor.end_pos = pos + (base_type == dblock::COMPACT_VALUE_TYPE_MASK ? 0 // written as removed, no value
+            : valueSize(static_cast<ValueType>(base_type), bytes() + pos, max_entry_ptr_ - pos, true));
+        return;
+    }
+    if (pos + dblock::EXPIRATION_SIZE + dblock::VALUE_TYPE_SIZE > max_entry_ptr_) {
+        throw std::runtime_error("DataBlock corrupted: Offset points outside of data bounds.");
     }
-    case ValueType::FLOAT: {
-        return Utils::deserializeLE<float>(&data_[cursor]);
+    cursor.expiration_ms = Utils::deserializeLE<dblock::ExpirationFieldType>(bytes() + pos);
+    pos += dblock::EXPIRATION_SIZE;
+    cursor.type_pos = pos;
+    auto type = Utils::deserializeLE<dblock::ValueTypeFieldType>(bytes() + pos);
+    pos += dblock::VALUE_TYPE_SIZE;
+    cursor.value_pos = pos;
+    if (prefixCompressed()) {
+        auto base_type = static_cast<dblock::ValueTypeFieldType>(type & dblock::VALUE_TYPE_MASK);
+        cursor.removed = (type & dblock::REMOVED_FLAG) != 0;
+        cursor.type = cursor.removed ? ValueType::REMOVED : static_cast<ValueType>(type);
+        cursor.end_pos = pos + (base_type == dblock::VALUE_TYPE_MASK ? 0 // written as removed, no value
+            : valueSize(static_cast<ValueType>(base_type), bytes() + pos, max_entry_ptr_ - pos, false));
+    }
+    else {
+        cursor.type = static_cast<ValueType>(type);
+        cursor.removed = cursor.type == ValueType::REMOVED;
+        cursor.end_pos = 0; // entries are found through the offset table
     }
-    case ValueType::DOUBLE: {
-        return Utils::deserializeLE<double>(&data_[cursor]);
+}
+
+DataBlock::Cursor DataBlock::seekRestart(uint32_t restart) const
+{
+    Cursor cursor;
+    cursor.index = static_cast<sst::datablock::CountFieldType>(restart * restart_interval_);
+    if (cursor.index < count_) {
+        decode(cursor, restartPos(restart));
     }
-    case ValueType::STRING: {
-        return Utils::deserializeLE<std::string>(&data_[cursor], value_len);
+    return cursor;
+}
+
+void DataBlock::next(Cursor& cursor) const
+{
+    ++cursor.index;
+    if (cursor.index >= count_) {
+        return;
     }
-    case ValueType::U8STRING: {
-        return Utils::deserializeLE<std::u8string>(&data_[cursor], value_len);
+    if (!prefixCompressed()) {
+        decode(cursor, restartPos(cursor.index));
+        return;
     }
-    case ValueType::BLOB: {
-        return Utils::deserializeLE<std::vector<uint8_t>>(&data_[cursor], value_len);
+    decode(cursor, cursor.end_pos);
+}
+
+DataBlock::Cursor DataBlock::seek(sst::datablock::CountFieldType offsetIdx) const
+{
+    auto cursor = seekRestart(offsetIdx / restart_interval_);
+    while (cursor.index < offsetIdx) {
+        next(cursor);
     }
-    default: {
-        throw std::runtime_error("DataBlock corrupted: Unsupported value type.");
+    return cursor;
+}
+
+ValueType DataBlock::effectiveType(const Cursor& cursor) const {
+    if (cursor.removed || Utils::isExpired(cursor.expiration_ms)) {
+        return ValueType::REMOVED;
     }
+    return cursor.type;
+}
+
+Value DataBlock::parseValue(const Cursor& cursor) const
+{
+    uint64_t pos = cursor.value_pos;
+    if (pos > max_entry_ptr_) {
+        throw std::runtime_error("DataBlock corrupted: Value exceeds data bounds.");
     }
+    // Empty strings and blobs are valid values, as in the MemTable and in getRaw
+    size_t consumed = 0;
+    return Utils::deserializeValue(cursor.type, bytes() + pos, max_entry_ptr_ - pos, consumed, compact());
 }
 
-sst::datablock::CountFieldType DataBlock::lowerBoundOffset(const std::string& key) const {
-    int left = 0;
-    int right = static_cast<int>(count_);
+DataBlock::Cursor DataBlock::lowerBound(std::string_view key) const {
+    // Binary search over the full keys of restart points, no allocation
+    uint32_t left = 0;
+    uint32_t right = num_restarts_;
     while (left < right) {
-        int mid = left + (right - left) / 2;
-        uint64_t pos = posByOffset(static_cast<sst::datablock::CountFieldType>(mid));
-        std::string entry_key = parseKey(pos);
-        if (key.compare(entry_key) <= 0) {
+        uint32_t mid = left + (right - left) / 2;
+        if (key <= restartKey(mid)) {
             right = mid;
         }
         else {
             left = mid + 1;
         }
     }
-    return static_cast<sst::datablock::CountFieldType>(left);
+    if (left == 0 || restart_interval_ == 1) {
+        return seekRestart(left);
+    }
+    // The key is after the previous restart point and not after this one
+    auto cursor = seekRestart(left - 1);
+    while (cursor.index < count_ && cursor.key() < key) {
+        next(cursor);
+    }
+    return cursor;
+}
+
+DataBlock::Cursor DataBlock::find(std::string_view key) const {
+    Cursor not_found;
+    not_found.index = count_;
+    auto bucket = dblock::HASH_BUCKET_COLLISION;
+    if (num_buckets_ != 0) {
+        auto pos = hash_buckets_pos_ + (keyHash(key) % num_buckets_) * dblock::HASH_BUCKET_SIZE;
+        bucket = Utils::deserializeLE<dblock::HashBucketFieldType>(bytes() + pos);
+    }
+    if (bucket == dblock::HASH_BUCKET_EMPTY) {
+        return not_found;
+    }
+    if (bucket == dblock::HASH_BUCKET_COLLISION) {
+        auto cursor = lowerBound(key);
+        return cursor.index < count_ && cursor.key() == key ? cursor : not_found;
+    }
+    if (bucket >= num_restarts_) {
+        throw std::runtime_error("DataBlock corrupted: Hash bucket points outside of the restart table.");
+    }
+    // Only the entries of one restart interval are decoded
+    auto end = std::min<uint64_t>(count_, (static_cast<uint64_t>(bucket) + 1) * restart_interval_);
+    for (auto cursor = seekRestart(bucket); cursor.index < end; next(cursor)) {
+        if (cursor.key() >= key) {
+            return cursor.key() == key ? cursor : not_found;
+        }
+    }
+    return not_found;
 }
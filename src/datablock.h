@@ -2,9 +2,14 @@
 #include "types.h"
 #include <vector>
 #include <string>
+#include <string_view>
 #include <optional>
 #include <functional>
+#include <memory>
+#include <span>
 
+// Sorted entries of an SST file. `version` is the SST version of the file, it selects the
+// entry encoding: full keys with an offset per entry, or prefix-compressed keys with restart points.
 class DataBlock {
 public:
     struct DataBlockEntry {
@@ -12,47 +17,123 @@ public:
         uint64_t expiration_ms;
     };
 
+    // Immutable block bytes, shared with the block cache and other readers
+    using Buffer = std::shared_ptr<const std::vector<uint8_t>>;
+
     DataBlock() = default;
-    DataBlock(std::vector<uint8_t> data);
-    std::optional<Entry> get(const std::string& key) const;
+    DataBlock(std::vector<uint8_t> data, uint8_t version = sst::header::SST_VERSION);
+    // Wraps the buffer without copying it
+    DataBlock(Buffer data, uint8_t version = sst::header::SST_VERSION);
+    // Wraps memory kept alive by the pointer owner, e.g. a file mapping
+    DataBlock(std::shared_ptr<const uint8_t> data, size_t size, uint8_t version = sst::header::SST_VERSION);
+    std::optional<Entry> get(std::string_view key) const;
     std::pair<std::string, DataBlockEntry> get(sst::datablock::CountFieldType offsetIdx) const;
-    std::vector<std::string> keysWithPrefix(const std::string& prefix, unsigned int max_results) const;
-    bool forEachKeyWithPrefix(const std::string& prefix,
+    std::string keyAt(sst::datablock::CountFieldType offsetIdx) const;
+    // All keys in order, including removed ones. The view is valid during the call only.
+    void forEachKey(const std::function<void(std::string_view)>& callback) const;
+    std::vector<std::string> keysWithPrefix(std::string_view prefix, unsigned int max_results) const;
+    bool forEachKeyWithPrefix(std::string_view prefix,
         const std::function<bool(const std::string&)>& callback) const;
-    bool remove(const std::string& key);
-    EntryStatus status(const std::string& key) const;
+    // Copies the bytes before changing them, holders of the old bytes are not affected.
+    // Bytes of a file mapping are the exception once the copy is written back to the file,
+    // the mapping shows the file's page cache.
+    bool remove(std::string_view key);
+    EntryStatus status(std::string_view key) const;
+    EntryStatus getRaw(std::string_view key, const RawValueCallback& callback) const;
 
     sst::datablock::CountFieldType count() const noexcept {
         return count_;
     }
-    
-    const std::vector<uint8_t>& data() const noexcept {
-        return data_;
+    uint8_t version() const noexcept {
+        return version_;
+    }
+    bool hasHashIndex() const noexcept {
+        return num_buckets_ != 0;
+    }
+
+    std::span<const uint8_t> data() const noexcept {
+        return { data_.get(), size_ };
     }
 private:
-    uint64_t posByOffset(sst::datablock::CountFieldType offsetIdx) const;
-    ValueType parseValueType(uint64_t entry_start_pos, sst::datablock::KeyLengthFieldType key_size) const;
-    std::string parseKey(uint64_t entry_start_pos) const;
-    Value parseValue(uint64_t entry_start_pos, sst::datablock::KeyLengthFieldType key_size, ValueType type) const;
-    sst::datablock::CountFieldType lowerBoundOffset(const std::string& key) const;
+    // Decoded entry, moved forward entry by entry from a restart point
+    struct Cursor {
+        sst::datablock::CountFieldType index = 0;
+        uint64_t type_pos = 0;
+        uint64_t value_pos = 0;
+        uint64_t end_pos = 0; // start of the next entry
+        uint64_t expiration_ms = 0;
+        ValueType type = ValueType::REMOVED; // as stored, expiration is not applied
+        bool removed = false;
+        std::string_view key_view; // full key in the block bytes
+        std::string key_buf;       // prefix-compressed key restored from the previous one
+        bool key_in_buf = false;
+
+        // Valid until the cursor moves
+        std::string_view key() const noexcept {
+            return key_in_buf ? std::string_view(key_buf) : key_view;
+        }
+    };
 
-    std::vector<uint8_t> data_;
+    bool prefixCompressed() const noexcept {
+        return version_ >= sst::header::SST_VERSION_PREFIX;
+    }
+    bool compact() const noexcept {
+        return version_ >= sst::header::SST_VERSION_COMPACT;
+    }
+    // Reads SharedLen (if any) and the stored key bytes of the entry, moves pos past them
+    std::string_view parseStoredKey(uint64_t& pos, size_t& shared) const;
+    uint64_t parseLength(uint64_t& pos, size_t fixed_size) const;
+    uint64_t restartPos(uint32_t restart) const;
+    // Key bytes in place, no allocation
+    std::string_view restartKey(uint32_t restart) const;
+    void decode(Cursor& cursor, uint64_t pos) const;
+    Cursor seekRestart(uint32_t restart) const;
+    void next(Cursor& cursor) const;
+    Cursor seek(sst::datablock::CountFieldType offsetIdx) const;
+    // First entry not less than the key, index is count_ if there is none
+    Cursor lowerBound(std::string_view key) const;
+    // Entry with the key, index is count_ if there is none. Uses the hash index if the block has one.
+    Cursor find(std::string_view key) const;
+    ValueType effectiveType(const Cursor& cursor) const;
+    Value parseValue(const Cursor& cursor) const;
+
+    const uint8_t* bytes() const noexcept {
+        return data_.get();
+    }
+    void parseLayout();
+
+    std::shared_ptr<const uint8_t> data_;
+    size_t size_ = 0;
+    uint8_t version_ = sst::header::SST_VERSION;
     sst::datablock::CountFieldType count_ = 0;  // Number of entries in the block
-    sst::datablock::OffsetEntryFieldType offset_table_pos_ = 0;  // Position of the offset table in the data
+    uint32_t restart_interval_ = 1; // every entry is a restart point in blocks without prefix compression
+    uint32_t num_restarts_ = 0;
+    sst::datablock::OffsetEntryFieldType offset_table_pos_ = 0;  // Position of the offset (restart) table in the data
     uint32_t max_entry_ptr_ = 0;
+    uint32_t hash_buckets_pos_ = 0;
+    uint32_t num_buckets_ = 0; // 0 - no hash index
 };
 
 class DataBlockBuilder {
 public:
-    DataBlockBuilder(uint32_t max_block_size);
+    // The hash index is written in blocks of SST_VERSION_COMPACT or newer only
+    DataBlockBuilder(uint32_t max_block_size, uint8_t version = sst::header::SST_VERSION, bool hash_index = false);
     bool addEntry(const std::string& key, const Entry& entry, uint64_t ttl);
     bool empty() const noexcept;
     uint64_t size() const noexcept;
     std::vector<uint8_t> build();
 
 private:
+    bool addPrefixCompressed(const std::string& key, const Entry& entry, uint64_t expiration_ms);
+    // Bytes of the hash index of a block with `count` entries, 0 without index
+    uint64_t hashIndexSize(uint32_t count) const noexcept;
+
     uint32_t max_block_size_;
-    std::vector<uint32_t> offset_table_;
+    uint8_t version_;
+    bool hash_index_;
+    std::vector<uint64_t> key_hashes_; // of all entries, for the hash index
+    std::vector<uint32_t> offset_table_; // offsets of all entries or of restart points only
     std::vector<uint8_t> raw_data_;
+    std::string last_key_;
     uint32_t count_ = 0;  // Number of entries in the block
 };
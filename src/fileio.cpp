@@ -0,0 +1,232 @@
+#include "fileio.h"
+#include "iouring.h"
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <cerrno>
+#endif
+
+namespace {
+#ifdef _WIN32
+    int openFile(const std::filesystem::path& path, int flags) {
+        int fd = -1;
+        _wsopen_s(&fd, path.c_str(), flags | _O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE);
+        return fd;
+    }
+    void closeFile(int fd) {
+        _close(fd);
+    }
+    bool syncFd(int fd) {
+        return _commit(fd) == 0;
+    }
+#else
+    int openFile(const std::filesystem::path& path, int flags) {
+        return ::open(path.c_str(), flags | O_CLOEXEC, 0644);
+    }
+    void closeFile(int fd) {
+        ::close(fd);
+    }
+    bool syncFd(int fd) {
+#if defined(__APPLE__)
+        return ::fsync(fd) == 0;
+#else
+        return ::fdatasync(fd) == 0;
+#endif
+    }
+#endif
+}
+
+AppendableFile::AppendableFile(const std::filesystem::path& path) : path_(path) {
+#ifdef _WIN32
+    fd_ = openFile(path_, _O_WRONLY | _O_CREAT | _O_APPEND);
+#else
+    fd_ = openFile(path_, O_WRONLY | O_CREAT | O_APPEND);
+#endif
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to open file for appending: " + path_.string());
+    }
+    size_ = std::filesystem::file_size(path_);
+}
+
+AppendableFile::~AppendableFile() {
+    if (fd_ >= 0) {
+        closeFile(fd_);
+    }
+}
+
+void AppendableFile::append(const uint8_t* data, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+#ifdef _WIN32
+        auto res = _write(fd_, data + written, static_cast<unsigned int>(size - written));
+#else
+        auto res = ::write(fd_, data + written, size - written);
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+#endif
+        if (res <= 0) {
+            throw std::runtime_error("Failed to append to file: " + path_.string());
+        }
+        written += static_cast<size_t>(res);
+    }
+    size_ += size;
+}
+
+void AppendableFile::sync() {
+    if (!syncFd(fd_)) {
+        throw std::runtime_error("Failed to sync file: " + path_.string());
+    }
+}
+
+void AppendableFile::truncate(uint64_t size) {
+#ifdef _WIN32
+    bool ok = _chsize_s(fd_, static_cast<__int64>(size)) == 0;
+#else
+    bool ok = ::ftruncate(fd_, static_cast<off_t>(size)) == 0;
+#endif
+    if (!ok) {
+        throw std::runtime_error("Failed to truncate file: " + path_.string());
+    }
+    size_ = size;
+}
+
+RandomAccessFile::RandomAccessFile(const std::filesystem::path& path) : path_(path) {
+#ifdef _WIN32
+    fd_ = openFile(path_, _O_RDONLY);
+#else
+    fd_ = openFile(path_, O_RDONLY);
+#endif
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to open file for reading: " + path_.string());
+    }
+}
+
+RandomAccessFile::~RandomAccessFile() {
+    if (fd_ >= 0) {
+        closeFile(fd_);
+    }
+}
+
+size_t RandomAccessFile::read(uint64_t offset, uint8_t* data, size_t size) const {
+    size_t done = 0;
+    while (done < size) {
+#ifdef _WIN32
+        // Overlapped offset makes ReadFile positional, the file pointer is not shared
+        OVERLAPPED overlapped{};
+        uint64_t pos = offset + done;
+        overlapped.Offset = static_cast<DWORD>(pos);
+        overlapped.OffsetHigh = static_cast<DWORD>(pos >> 32);
+        DWORD res = 0;
+        auto handle = reinterpret_cast<HANDLE>(_get_osfhandle(fd_));
+        if (!ReadFile(handle, data + done, static_cast<DWORD>(size - done), &res, &overlapped)) {
+            if (GetLastError() == ERROR_HANDLE_EOF) {
+                break;
+            }
+            throw std::runtime_error("Failed to read file: " + path_.string());
+        }
+#else
+        auto res = ::pread(fd_, data + done, size - done, static_cast<off_t>(offset + done));
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Failed to read file: " + path_.string());
+        }
+#endif
+        if (res == 0) {
+            break; // end of file
+        }
+        done += static_cast<size_t>(res);
+    }
+    return done;
+}
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+    size_ = std::filesystem::file_size(path);
+    if (size_ == 0) {
+        return; // empty files can't be mapped
+    }
+#ifdef _WIN32
+    // Share delete lets the file be renamed or removed while it is mapped
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open file for mapping: " + path.string());
+    }
+    mapping_ = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file); // the mapping keeps the file open
+    if (!mapping_) {
+        throw std::runtime_error("Failed to map file: " + path.string());
+    }
+    data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (!data_) {
+        CloseHandle(mapping_);
+        throw std::runtime_error("Failed to map file: " + path.string());
+    }
+#else
+    int fd = openFile(path, O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file for mapping: " + path.string());
+    }
+    void* addr = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    closeFile(fd); // the mapping keeps the file open
+    if (addr == MAP_FAILED) {
+        throw std::runtime_error("Failed to map file: " + path.string());
+    }
+    data_ = static_cast<const uint8_t*>(addr);
+#endif
+}
+
+MappedFile::~MappedFile() {
+    if (!data_) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+#else
+    ::munmap(const_cast<uint8_t*>(data_), size_);
+#endif
+}
+
+void FileIO::syncFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+    int fd = openFile(path, _O_RDWR);
+#else
+    int fd = openFile(path, O_RDONLY);
+#endif
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file for sync: " + path.string());
+    }
+    bool ok = syncFd(fd);
+    closeFile(fd);
+    if (!ok) {
+        throw std::runtime_error("Failed to sync file: " + path.string());
+    }
+}
+
+void FileIO::readBatch(std::span<ReadRequest> requests, bool use_io_uring) {
+    for (auto& request : requests) {
+        request.bytes_read = 0;
+    }
+    if (use_io_uring && requests.size() > 1) {
+        IoUring::readBatch(requests);
+    }
+    // Fallback, and the rest of short or failed io_uring reads
+    for (auto& request : requests) {
+        if (request.bytes_read < request.size) {
+            request.bytes_read += request.file->read(request.offset + request.bytes_read,
+                request.data + request.bytes_read, request.size - request.bytes_read);
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+// Thin wrappers over OS file descriptors for the places where std::fstream
+// does not give enough control (explicit data sync, truncation, positional reads).
+class AppendableFile {
+public:
+    explicit AppendableFile(const std::filesystem::path& path);
+    ~AppendableFile();
+    AppendableFile(const AppendableFile&) = delete;
+    AppendableFile& operator=(const AppendableFile&) = delete;
+    AppendableFile(AppendableFile&&) = delete;
+    AppendableFile& operator=(AppendableFile&&) = delete;
+
+    void append(const uint8_t* data, size_t size);
+    // Flushes file data to the storage device (fdatasync).
+    void sync();
+    void truncate(uint64_t size);
+    uint64_t size() const noexcept {
+        return size_;
+    }
+    const std::filesystem::path& path() const noexcept {
+        return path_;
+    }
+
+private:
+    std::filesystem::path path_;
+    int fd_ = -1;
+    uint64_t size_ = 0;
+};
+
+// Read-only file with positional reads. read() does not move a shared file position,
+// so any number of threads may read the same file at the same time.
+class RandomAccessFile {
+public:
+    explicit RandomAccessFile(const std::filesystem::path& path);
+    ~RandomAccessFile();
+    RandomAccessFile(const RandomAccessFile&) = delete;
+    RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+    RandomAccessFile(RandomAccessFile&&) = delete;
+    RandomAccessFile& operator=(RandomAccessFile&&) = delete;
+
+    // Returns number of bytes read, less than size only at the end of the file
+    size_t read(uint64_t offset, uint8_t* data, size_t size) const;
+    const std::filesystem::path& path() const noexcept {
+        return path_;
+    }
+    int fd() const noexcept {
+        return fd_;
+    }
+
+private:
+    std::filesystem::path path_;
+    int fd_ = -1;
+};
+
+// One read of a batch, see FileIO::readBatch
+struct ReadRequest {
+    const RandomAccessFile* file = nullptr;
+    uint64_t offset = 0;
+    uint8_t* data = nullptr;
+    size_t size = 0;
+    size_t bytes_read = 0; // less than size only at the end of the file
+};
+
+// Whole file mapped read-only into memory. On POSIX the mapping stays valid after
+// the file is renamed or removed, the data is released on unmap.
+class MappedFile {
+public:
+    explicit MappedFile(const std::filesystem::path& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+
+    const uint8_t* data() const noexcept {
+        return data_;
+    }
+    size_t size() const noexcept {
+        return size_;
+    }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* mapping_ = nullptr;
+#endif
+};
+
+namespace FileIO {
+    // Flushes data of an already written file to the storage device.
+    void syncFile(const std::filesystem::path& path);
+    // Performs all reads. With use_io_uring they are submitted to the kernel at once
+    // and served in parallel, otherwise (or if io_uring is unavailable) they are pread one by one.
+    void readBatch(std::span<ReadRequest> requests, bool use_io_uring);
+}
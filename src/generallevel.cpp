@@ -14,47 +14,27 @@ namespace {
 
         return 0;
     }
-
-    template<typename Map, typename LRU, typename LruIt>
-    static LruIt findSSTImpl(Map& sst_file_map, LRU& lru_sst_files, const std::string& key, LruIt lru_end) {
-        if (sst_file_map.empty()) {
-            return lru_end;
-        }
-        auto it = sst_file_map.upper_bound(key);
-        if (it == sst_file_map.begin() || (it != sst_file_map.end() && (*it->second)->maxKey() < key)) {
-            return lru_end;
-        }
-
-        if (it != sst_file_map.end() && it->first == key) {
-            return it->second; // Found exact match
-        }
-
-        --it;
-        lru_sst_files.splice(lru_end, lru_sst_files, it->second); // Move to the end of the list
-        return it->second;
-    }
 }
 
-
-
-auto GeneralLevel::findSST(const std::string& key) -> decltype(lru_sst_files_)::iterator {
-    return findSSTImpl(sst_file_map_, lru_sst_files_, key, lru_sst_files_.end());
-}
-
-auto GeneralLevel::findSST(const std::string& key) const -> decltype(lru_sst_files_)::const_iterator {
-    return findSSTImpl(sst_file_map_, lru_sst_files_, key, lru_sst_files_.end());
+SSTFile* GeneralLevel::findSST(const std::string& key) const {
+    auto it = sst_file_map_.upper_bound(key);
+    if (it == sst_file_map_.begin()) {
+        return nullptr;
+    }
+    const auto& sst = *std::prev(it)->second;
+    return sst->maxKey() < key ? nullptr : sst.get();
 }
 
-
-GeneralLevel::GeneralLevel(const std::filesystem::path& path, size_t max_file_size, size_t max_num_files, bool is_last) :
-    path_(path), max_file_size_(max_file_size), max_num_files_(max_num_files), is_last_(is_last){
+GeneralLevel::GeneralLevel(const std::filesystem::path& path, size_t max_file_size, size_t max_num_files, bool is_last,
+    const SSTOptions& options) :
+    path_(path), max_file_size_(max_file_size), max_num_files_(max_num_files), is_last_(is_last), options_(options) {
     if (!std::filesystem::exists(path_)) {
         std::filesystem::create_directories(path_);
     }
     std::vector<std::unique_ptr<SSTFile>>  sst_files;
     for (const auto& entry : std::filesystem::directory_iterator(path_)) {
         if (entry.is_regular_file() && entry.path().extension() == ".vsst") {
-            auto sst = SSTFile::readAndCreate(entry.path());
+            auto sst = SSTFile::readAndCreate(entry.path(), options_);
             sst_files.push_back(std::move(sst));
             max_file_index_ = std::max(max_file_index_, extractSecondNumber(entry.path().filename().string()));
         }
@@ -64,27 +44,54 @@ GeneralLevel::GeneralLevel(const std::filesystem::path& path, size_t max_file_si
 
 
 std::optional<Entry> GeneralLevel::get(const std::string& key) const {
-    auto it = findSST(key);
-    if (it == lru_sst_files_.end()) {
+    auto* sst = findSST(key);
+    if (!sst) {
         return std::nullopt;
     }
-    return (*it)->get(key);
+    return sst->get(key);
+}
+
+void GeneralLevel::multiGet(std::span<const std::string* const> keys, std::span<std::optional<Entry>> results) const {
+    // Keys are sorted, so keys of one file follow each other
+    size_t i = 0;
+    while (i < keys.size()) {
+        auto* sst = findSST(*keys[i]);
+        if (!sst) {
+            ++i;
+            continue;
+        }
+        auto max_key = sst->maxKey();
+        size_t end = i + 1;
+        while (end < keys.size() && *keys[end] <= max_key) {
+            ++end;
+        }
+        sst->multiGet(keys.subspan(i, end - i), results.subspan(i, end - i));
+        i = end;
+    }
 }
 
 bool GeneralLevel::remove(const std::string& key, uint64_t max_seq_num) {
-    auto it = findSST(key);
-    if (it == lru_sst_files_.end()) {
+    auto* sst = findSST(key);
+    if (!sst) {
         return false;
     }
-    return (*it)->remove(key);
+    return sst->remove(key);
 }
 
 EntryStatus GeneralLevel::status(const std::string& key) const {
-    auto it = findSST(key);
-    if (it == lru_sst_files_.end()) {
+    auto* sst = findSST(key);
+    if (!sst) {
+        return EntryStatus::NOT_FOUND;
+    }
+    return sst->status(key);
+}
+
+EntryStatus GeneralLevel::getRaw(const std::string& key, const RawValueCallback& callback) const {
+    auto* sst = findSST(key);
+    if (!sst) {
         return EntryStatus::NOT_FOUND;
     }
-    return (*it)->status(key);
+    return sst->getRaw(key, callback);
 }
 
 std::vector<std::string> GeneralLevel::keysWithPrefix(const std::string& prefix, unsigned int max_results) const {
@@ -129,9 +136,9 @@ std::vector<std::filesystem::path> GeneralLevel::filelistToMerge(uint64_t max_se
 }
 
 // Merge a single SST file into this level
-IFileLevel::MergeResult GeneralLevel::mergeToTmp(const std::filesystem::path& sst_path, size_t datablock_size) const {
+IFileLevel::MergeResult GeneralLevel::mergeToTmp(const std::filesystem::path& sst_path, size_t datablock_size, const SSTOptions& options) const {
     MergeResult result;
-    auto new_sst_file = SSTFile::readAndCreate(sst_path);
+    auto new_sst_file = SSTFile::readAndCreate(sst_path, options);
     auto it_upper = sst_file_map_.upper_bound(new_sst_file->minKey());
 
     // Check the case if first file is overlaped
@@ -154,7 +161,8 @@ IFileLevel::MergeResult GeneralLevel::mergeToTmp(const std::filesystem::path& ss
         path_,
         max_file_size_,
         datablock_size,
-        !is_last_
+        !is_last_,
+        options
     );
     // Remove paths from files_to_remove that exist in new_files
     return result;
@@ -168,37 +176,42 @@ void GeneralLevel::addSST(std::vector<std::unique_ptr<SSTFile>>  ssts) {
         fpath = path_ / fname;
 
         sst->rename(fpath);
-        lru_sst_files_.push_back(std::move(sst));
-        auto it = std::prev(lru_sst_files_.end());
-        sst_file_map_[(*it)->minKey()] = it;
-        seq_num_map_[(*it)->seqNum()] = it;
-        file_path_map_[(*it)->path().string()] = it;
+        insertSST(std::move(sst));
         ++max_file_index_;
     }
 }
 
+void GeneralLevel::insertSST(std::shared_ptr<SSTFile> sst) {
+    sst_files_.push_back(std::move(sst));
+    auto it = std::prev(sst_files_.end());
+    sst_file_map_[(*it)->minKey()] = it;
+    seq_num_map_[(*it)->seqNum()] = it;
+    file_path_map_[(*it)->path().string()] = it;
+}
+
 void GeneralLevel::removeSSTs(const std::vector<std::filesystem::path>& sst_paths) {
     for (const auto& sst_path : sst_paths) {
         auto it = file_path_map_.find(sst_path.string());
         if (it != file_path_map_.end()) {
             sst_file_map_.erase((*it->second)->minKey());
             seq_num_map_.erase((*it->second)->seqNum());
-            lru_sst_files_.erase(it->second);
+            (*it->second)->markObsolete();
+            sst_files_.erase(it->second);
             file_path_map_.erase(it);
         }
     }
 }
 
 void GeneralLevel::clearCache() noexcept {
-    for (auto& sst : lru_sst_files_) {
+    for (auto& sst : sst_files_) {
         sst->clearCache();
     }
 }
 
-IFileLevel::MergeResult GeneralLevel::shrink(uint32_t datablock_size) {
+IFileLevel::MergeResult GeneralLevel::shrink(uint32_t datablock_size, const SSTOptions& options) const {
     MergeResult result;
-    for (const auto& file : lru_sst_files_) {
-        auto new_file = file->shrink(datablock_size);
+    for (const auto& file : sst_files_) {
+        auto new_file = file->shrink(datablock_size, options);
         if (new_file) {
             result.new_files.push_back(std::move(new_file));
         }
@@ -210,3 +223,15 @@ IFileLevel::MergeResult GeneralLevel::shrink(uint32_t datablock_size) {
 size_t GeneralLevel::count() const{
     return file_path_map_.size();
 }
+
+GeneralLevel::GeneralLevel(const GeneralLevel& other) :
+    path_(other.path_), max_file_size_(other.max_file_size_), max_file_index_(other.max_file_index_),
+    max_num_files_(other.max_num_files_), is_last_(other.is_last_), options_(other.options_) {
+    for (const auto& sst : other.sst_files_) {
+        insertSST(sst);
+    }
+}
+
+std::unique_ptr<IFileLevel> GeneralLevel::clone() const {
+    return std::unique_ptr<IFileLevel>(new GeneralLevel(*this));
+}
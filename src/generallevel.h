@@ -10,15 +10,18 @@
 // Implementation for Level 1 and higher. Key ranges do not overlap.
 class GeneralLevel : public IFileLevel {
 public:
-    GeneralLevel(const std::filesystem::path& path, size_t max_file_size, size_t max_num_files, bool is_last);
+    GeneralLevel(const std::filesystem::path& path, size_t max_file_size, size_t max_num_files, bool is_last,
+        const SSTOptions& options = {});
     ~GeneralLevel() override = default;
     std::optional<Entry> get(const std::string& key) const override;
     bool remove(const std::string& key, uint64_t max_seq_num) override;
     EntryStatus status(const std::string& key) const override;
+    EntryStatus getRaw(const std::string& key, const RawValueCallback& callback) const override;
+    void multiGet(std::span<const std::string* const> keys, std::span<std::optional<Entry>> results) const override;
     std::vector<std::string> keysWithPrefix(const std::string& prefix, unsigned int max_results) const override;
     bool forEachKeyWithPrefix(const std::string& prefix, const std::function<bool(const std::string&)>& callback) const override;
 
-    MergeResult mergeToTmp(const std::filesystem::path&, size_t datablock_size) const override;
+    MergeResult mergeToTmp(const std::filesystem::path&, size_t datablock_size, const SSTOptions& options = {}) const override;
     std::vector<std::filesystem::path> filelistToMerge(uint64_t max_seq_num) const override;
     void addSST(std::vector<std::unique_ptr<SSTFile>>  sst) override;
     void removeSSTs(const std::vector<std::filesystem::path>& sst_paths) override;
@@ -26,24 +29,28 @@ public:
     uint64_t maxSeqNum() const override {
         return seq_num_map_.empty() ? 0 : (*seq_num_map_.rbegin()->second)->seqNum();
     }
-    MergeResult shrink(uint32_t datablock_size);
+    MergeResult shrink(uint32_t datablock_size, const SSTOptions& options = {}) const;
     size_t count() const override;
+    std::unique_ptr<IFileLevel> clone() const override;
 
 private:
+    GeneralLevel(const GeneralLevel& other);
+    void insertSST(std::shared_ptr<SSTFile> sst);
 
     std::filesystem::path path_;
     size_t max_file_size_;
     uint64_t max_file_index_ = 0; // Used to generate unique file names
     size_t max_num_files_; // Maximum number of SST files allowed in this level
     bool is_last_;
+    SSTOptions options_; // used to open existing files
 
-    mutable std::list<std::unique_ptr<SSTFile>> lru_sst_files_; // Least Recently Used cache for SST files
-    std::map<std::string, decltype(lru_sst_files_)::iterator> sst_file_map_; // Maps keys to SST files
-    std::map<uint64_t, decltype(lru_sst_files_)::iterator> seq_num_map_; // Maps sequence numbers to SST files
-    std::unordered_map<std::string, decltype(lru_sst_files_)::iterator> file_path_map_; // Maps by filepath
+    // Open files are tracked by the table cache, the list only owns the files of the level
+    std::list<std::shared_ptr<SSTFile>> sst_files_;
+    std::map<std::string, decltype(sst_files_)::iterator> sst_file_map_; // Maps keys to SST files
+    std::map<uint64_t, decltype(sst_files_)::iterator> seq_num_map_; // Maps sequence numbers to SST files
+    std::unordered_map<std::string, decltype(sst_files_)::iterator> file_path_map_; // Maps by filepath
 
-
-    auto findSST(const std::string& key) -> decltype(lru_sst_files_)::iterator;
-    auto findSST(const std::string& key) const -> decltype(lru_sst_files_)::const_iterator;
+    // File whose key range may hold the key, nullptr if there is none
+    SSTFile* findSST(const std::string& key) const;
 
 };
@@ -4,6 +4,7 @@
 #include <vector>
 #include <memory>
 #include <optional>
+#include <span>
 #include "types.h"
 #include "sstfile.h"
 
@@ -13,9 +14,18 @@ public:
     virtual ~ILevel() = default;
     virtual std::optional<Entry> get(const std::string& key) const = 0;
     virtual EntryStatus status(const std::string& key) const = 0;
+    // Passes the serialized value of an existing key to the callback without building an Entry
+    virtual EntryStatus getRaw(const std::string& key, const RawValueCallback& callback) const = 0;
     virtual std::vector<std::string> keysWithPrefix(const std::string& prefix, unsigned int max_results) const = 0;
     virtual bool forEachKeyWithPrefix(const std::string& prefix, const std::function<bool(const std::string&)>& callback) const = 0;
-
+    // Looks up sorted keys which have no result yet, results are parallel to keys
+    virtual void multiGet(std::span<const std::string* const> keys, std::span<std::optional<Entry>> results) const {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (!results[i]) {
+                results[i] = get(*keys[i]);
+            }
+        }
+    }
 };
 
 class IFileLevel: public ILevel {
@@ -27,9 +37,12 @@ public:
     virtual ~IFileLevel() = default;
     virtual bool remove(const std::string& key, uint64_t max_seq_num) = 0;
     virtual std::vector<std::filesystem::path> filelistToMerge(uint64_t max_seq_num) const = 0;
-    virtual MergeResult mergeToTmp(const std::filesystem::path&, size_t datablock_size) const = 0;
+    virtual MergeResult mergeToTmp(const std::filesystem::path&, size_t datablock_size, const SSTOptions& options = {}) const = 0;
     virtual void addSST(std::vector<std::unique_ptr<SSTFile>>  sst) = 0;
+    // Removed files are deleted from the disk once no copy of the level uses them
     virtual void removeSSTs(const std::vector<std::filesystem::path>& sst_paths) = 0;
+    // Copy sharing the SST files, changed and published in place of this level while readers use this one
+    virtual std::unique_ptr<IFileLevel> clone() const = 0;
     virtual uint64_t maxSeqNum() const = 0;
     virtual void clearCache() noexcept = 0;
     virtual size_t count() const = 0;
@@ -0,0 +1,109 @@
+#include "indexpartition.h"
+#include "utils.h"
+#include <stdexcept>
+
+namespace iblock = sst::indexblock;
+
+// [Entries][OffsetTable][EndOffset][Count], entry: [KeyLen][Key][Offset]
+void IndexPartitionBuilder::addKey(std::string_view key, iblock::OffsetFieldType offset) {
+    entry_offsets_.push_back(static_cast<iblock::EntryOffsetFieldType>(raw_data_.size()));
+    Utils::serializeLE(static_cast<iblock::IndexKeyLengthFieldType>(key.size()), raw_data_);
+    raw_data_.insert(raw_data_.end(), key.begin(), key.end());
+    Utils::serializeLE(offset, raw_data_);
+}
+
+uint64_t IndexPartitionBuilder::size() const noexcept {
+    return raw_data_.size() + entry_offsets_.size() * iblock::ENTRY_OFFSET_SIZE +
+        iblock::END_OFFSET_SIZE + iblock::INDEX_BLOCK_COUNT_SIZE;
+}
+
+std::vector<uint8_t> IndexPartitionBuilder::build(iblock::OffsetFieldType end_offset) {
+    for (auto offset : entry_offsets_) {
+        Utils::serializeLE(offset, raw_data_);
+    }
+    Utils::serializeLE(end_offset, raw_data_);
+    Utils::serializeLE(static_cast<iblock::CountFieldType>(entry_offsets_.size()), raw_data_);
+    entry_offsets_.clear();
+    std::vector<uint8_t> ret;
+    ret.swap(raw_data_);
+    return ret;
+}
+
+IndexPartition::IndexPartition(std::vector<uint8_t> data) {
+    auto buffer = std::make_shared<const std::vector<uint8_t>>(std::move(data));
+    size_ = buffer->size();
+    data_ = std::shared_ptr<const uint8_t>(buffer, buffer->data());
+    parseLayout();
+}
+
+IndexPartition::IndexPartition(std::shared_ptr<const uint8_t> data, size_t size)
+    : data_(std::move(data)), size_(size) {
+    if (!data_) {
+        throw std::runtime_error("Index partition corrupted: No data.");
+    }
+    parseLayout();
+}
+
+void IndexPartition::parseLayout() {
+    constexpr size_t trailer_size = iblock::END_OFFSET_SIZE + iblock::INDEX_BLOCK_COUNT_SIZE;
+    if (size_ < trailer_size) {
+        throw std::runtime_error("Index partition corrupted: Data size is too small to contain a valid partition.");
+    }
+    count_ = Utils::deserializeLE<iblock::CountFieldType>(data_.get() + size_ - iblock::INDEX_BLOCK_COUNT_SIZE);
+    end_offset_ = Utils::deserializeLE<iblock::OffsetFieldType>(data_.get() + size_ - trailer_size);
+    auto offset_table_size = static_cast<uint64_t>(count_) * iblock::ENTRY_OFFSET_SIZE;
+    if (count_ == 0 || size_ < trailer_size + offset_table_size) {
+        throw std::runtime_error("Index partition corrupted: Data size is too small to contain a valid offset table.");
+    }
+    offset_table_pos_ = size_ - trailer_size - offset_table_size;
+}
+
+uint64_t IndexPartition::entryPos(iblock::CountFieldType idx) const {
+    if (idx >= count_) {
+        throw std::out_of_range("Index partition entry out of range");
+    }
+    uint64_t pos = Utils::deserializeLE<iblock::EntryOffsetFieldType>(data_.get() + offset_table_pos_ + idx * iblock::ENTRY_OFFSET_SIZE);
+    if (pos + iblock::INDEX_KEY_LEN > offset_table_pos_) {
+        throw std::runtime_error("Index partition corrupted: Offset points outside of data bounds.");
+    }
+    return pos + iblock::INDEX_KEY_LEN;
+}
+
+std::string_view IndexPartition::key(iblock::CountFieldType idx) const {
+    auto pos = entryPos(idx);
+    auto key_len = Utils::deserializeLE<iblock::IndexKeyLengthFieldType>(data_.get() + pos - iblock::INDEX_KEY_LEN);
+    if (pos + key_len + iblock::BLOCK_OFFSET_SIZE > offset_table_pos_) {
+        throw std::runtime_error("Index partition corrupted: Key length exceeds data bounds.");
+    }
+    return { reinterpret_cast<const char*>(data_.get() + pos), key_len };
+}
+
+iblock::OffsetFieldType IndexPartition::offset(iblock::CountFieldType idx) const {
+    auto key = this->key(idx);
+    return Utils::deserializeLE<iblock::OffsetFieldType>(reinterpret_cast<const uint8_t*>(key.data() + key.size()));
+}
+
+iblock::OffsetFieldType IndexPartition::blockSize(iblock::CountFieldType idx) const {
+    auto end = idx + 1 < count_ ? offset(idx + 1) : end_offset_;
+    auto start = offset(idx);
+    if (end < start) {
+        throw std::runtime_error("Index partition corrupted: Block offsets are not ascending.");
+    }
+    return end - start;
+}
+
+iblock::CountFieldType IndexPartition::find(std::string_view key) const {
+    // First entry greater than the key, no allocation
+    iblock::CountFieldType left = 0;
+    iblock::CountFieldType right = count_;
+    while (left < right) {
+        auto mid = left + (right - left) / 2;
+        if (key < this->key(mid)) {
+            right = mid;
+        }
+        else {
+            left = mid + 1;
+        }
+    }
+    return left == 0 ? count_ : left - 1;
+}
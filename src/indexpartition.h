@@ -0,0 +1,60 @@
+#pragma once
+#include "constants.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Sorted (min key, offset) entries of blocks, searched in place. Since SST_VERSION_PARTITIONED the
+// index partitions (pointing at DataBlocks) and the top-level index (pointing at the partitions) have this layout.
+class IndexPartition {
+public:
+    IndexPartition() = default;
+    explicit IndexPartition(std::vector<uint8_t> data);
+    // Wraps memory kept alive by the pointer owner: a cached block or a file mapping
+    IndexPartition(std::shared_ptr<const uint8_t> data, size_t size);
+
+    sst::indexblock::CountFieldType count() const noexcept {
+        return count_;
+    }
+    bool empty() const noexcept {
+        return count_ == 0;
+    }
+    size_t size() const noexcept {
+        return size_;
+    }
+    std::string_view key(sst::indexblock::CountFieldType idx) const;
+    sst::indexblock::OffsetFieldType offset(sst::indexblock::CountFieldType idx) const;
+    // Blocks end where the next one starts, the last one at the end offset of the partition
+    sst::indexblock::OffsetFieldType blockSize(sst::indexblock::CountFieldType idx) const;
+    // Last entry whose min key is not greater than the key, count() if the key is before the first one
+    sst::indexblock::CountFieldType find(std::string_view key) const;
+
+private:
+    void parseLayout();
+    // Position of the entry, after its KeyLen
+    uint64_t entryPos(sst::indexblock::CountFieldType idx) const;
+
+    std::shared_ptr<const uint8_t> data_;
+    size_t size_ = 0;
+    sst::indexblock::CountFieldType count_ = 0;
+    uint64_t offset_table_pos_ = 0;
+    sst::indexblock::OffsetFieldType end_offset_ = 0;
+};
+
+class IndexPartitionBuilder {
+public:
+    void addKey(std::string_view key, sst::indexblock::OffsetFieldType offset);
+    bool empty() const noexcept {
+        return entry_offsets_.empty();
+    }
+    // Size of the built partition
+    uint64_t size() const noexcept;
+    // end_offset - where the last block ends
+    std::vector<uint8_t> build(sst::indexblock::OffsetFieldType end_offset);
+
+private:
+    std::vector<uint8_t> raw_data_;
+    std::vector<sst::indexblock::EntryOffsetFieldType> entry_offsets_;
+};
@@ -0,0 +1,244 @@
+#include "iouring.h"
+#include "fileio.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define SIMPLESTORAGE_IO_URING 1
+#endif
+
+#ifdef SIMPLESTORAGE_IO_URING
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+    constexpr unsigned QUEUE_DEPTH = 64;
+
+    int setup(unsigned entries, io_uring_params* params) {
+        return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    unsigned loadAcquire(const unsigned* p) {
+        return std::atomic_ref<const unsigned>(*p).load(std::memory_order_acquire);
+    }
+
+    void storeRelease(unsigned* p, unsigned value) {
+        std::atomic_ref<unsigned>(*p).store(value, std::memory_order_release);
+    }
+
+    // Submission and completion rings of one thread
+    class Ring {
+    public:
+        // nullptr if io_uring can't be set up
+        static std::unique_ptr<Ring> create() {
+            auto ring = std::unique_ptr<Ring>(new Ring());
+            return ring->init() ? std::move(ring) : nullptr;
+        }
+
+        ~Ring() {
+            if (sqes_) {
+                ::munmap(sqes_, sqes_size_);
+            }
+            if (cq_ptr_ && cq_ptr_ != sq_ptr_) {
+                ::munmap(cq_ptr_, cq_size_);
+            }
+            if (sq_ptr_) {
+                ::munmap(sq_ptr_, sq_size_);
+            }
+            if (fd_ >= 0) {
+                ::close(fd_);
+            }
+        }
+
+        // False if the ring failed and must not be used again. Returns only after every submitted
+        // read completed, requests not read are left for the synchronous path.
+        bool read(std::span<ReadRequest> requests) {
+            for (size_t start = 0; start < requests.size(); start += sq_entries_) {
+                auto chunk = requests.subspan(start, std::min<size_t>(sq_entries_, requests.size() - start));
+                size_t submitted = submit(chunk);
+                bool waited = wait(chunk, submitted);
+                if (submitted < chunk.size() || !waited) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        Ring() = default;
+
+        bool init() {
+            io_uring_params params{};
+            fd_ = setup(QUEUE_DEPTH, &params);
+            if (fd_ < 0) {
+                return false;
+            }
+            sq_entries_ = params.sq_entries;
+            sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single_mmap) {
+                sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+            }
+            sq_ptr_ = mapRing(sq_size_, IORING_OFF_SQ_RING);
+            if (!sq_ptr_) {
+                return false;
+            }
+            cq_ptr_ = single_mmap ? sq_ptr_ : mapRing(cq_size_, IORING_OFF_CQ_RING);
+            if (!cq_ptr_) {
+                return false;
+            }
+            sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+            sqes_ = static_cast<io_uring_sqe*>(mapRing(sqes_size_, IORING_OFF_SQES));
+            if (!sqes_) {
+                return false;
+            }
+            auto* sq = static_cast<uint8_t*>(sq_ptr_);
+            sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+            sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            auto* cq = static_cast<uint8_t*>(cq_ptr_);
+            cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+            return true;
+        }
+
+        void* mapRing(size_t size, off_t offset) {
+            void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+            return p == MAP_FAILED ? nullptr : p;
+        }
+
+        // Returns the number of requests taken by the kernel, less than requested if submission failed
+        size_t submit(std::span<ReadRequest> requests) {
+            unsigned tail = *sq_tail_; // only this thread writes the tail
+            for (size_t i = 0; i < requests.size(); ++i) {
+                auto& request = requests[i];
+                unsigned idx = tail & sq_mask_;
+                auto* sqe = &sqes_[idx];
+                std::memset(sqe, 0, sizeof(*sqe));
+                sqe->opcode = IORING_OP_READ;
+                sqe->fd = request.file->fd();
+                sqe->off = request.offset;
+                sqe->addr = reinterpret_cast<uint64_t>(request.data);
+                sqe->len = static_cast<uint32_t>(request.size);
+                sqe->user_data = i;
+                sq_array_[idx] = idx;
+                ++tail;
+            }
+            storeRelease(sq_tail_, tail);
+            unsigned to_submit = static_cast<unsigned>(requests.size());
+            while (to_submit > 0) {
+                int res = enter(fd_, to_submit, 0, 0);
+                if (res < 0) {
+                    if (errno == EINTR || errno == EAGAIN) {
+                        continue;
+                    }
+                    // Withdraw the entries the kernel did not take, they must not go out with the next batch.
+                    // The kernel reads the submission ring only inside io_uring_enter.
+                    storeRelease(sq_tail_, loadAcquire(sq_head_));
+                    break;
+                }
+                to_submit -= static_cast<unsigned>(res);
+            }
+            return requests.size() - to_submit;
+        }
+
+        // Consumes the completions of the first `submitted` requests. False if waiting failed, the
+        // completions are then polled without the kernel's help, their buffers may not be released earlier.
+        bool wait(std::span<ReadRequest> requests, size_t submitted) {
+            bool ok = true;
+            size_t completed = 0;
+            while (completed < submitted) {
+                unsigned head = *cq_head_;
+                unsigned tail = loadAcquire(cq_tail_);
+                if (head == tail) {
+                    if (!ok) {
+                        std::this_thread::yield();
+                    }
+                    else if (enter(fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != EAGAIN) {
+                        ok = false;
+                    }
+                    continue;
+                }
+                for (; head != tail; ++head, ++completed) {
+                    const auto& cqe = cqes_[head & cq_mask_];
+                    auto& request = requests[cqe.user_data];
+                    // Errors (e.g. old kernel without IORING_OP_READ) are left to the synchronous path
+                    request.bytes_read = cqe.res > 0 ? static_cast<size_t>(cqe.res) : 0;
+                }
+                storeRelease(cq_head_, head);
+            }
+            return ok;
+        }
+
+        int fd_ = -1;
+        unsigned sq_entries_ = 0;
+        void* sq_ptr_ = nullptr;
+        void* cq_ptr_ = nullptr;
+        size_t sq_size_ = 0;
+        size_t cq_size_ = 0;
+        io_uring_sqe* sqes_ = nullptr;
+        size_t sqes_size_ = 0;
+        unsigned* sq_head_ = nullptr;
+        unsigned* sq_tail_ = nullptr;
+        unsigned sq_mask_ = 0;
+        unsigned* sq_array_ = nullptr;
+        unsigned* cq_head_ = nullptr;
+        unsigned* cq_tail_ = nullptr;
+        unsigned cq_mask_ = 0;
+        io_uring_cqe* cqes_ = nullptr;
+    };
+
+    std::atomic<bool> unavailable = false;
+
+    std::unique_ptr<Ring>& threadRing() {
+        thread_local std::unique_ptr<Ring> ring;
+        if (!ring && !unavailable.load(std::memory_order_relaxed)) {
+            ring = Ring::create();
+            if (!ring) {
+                unavailable = true; // e.g. blocked by seccomp, don't try again
+            }
+        }
+        return ring;
+    }
+}
+
+bool IoUring::available() {
+    return threadRing() != nullptr;
+}
+
+bool IoUring::readBatch(std::span<ReadRequest> requests) {
+    auto& ring = threadRing();
+    if (!ring) {
+        return false;
+    }
+    if (!ring->read(requests)) {
+        ring.reset(); // nothing is in flight, the next batch of the thread starts with a new ring
+    }
+    return true;
+}
+
+#else
+
+bool IoUring::available() {
+    return false;
+}
+
+bool IoUring::readBatch(std::span<ReadRequest>) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+#include <span>
+
+struct ReadRequest;
+
+// Batched positional reads through io_uring (Linux), without liburing.
+// Every thread gets its own ring on the first use.
+namespace IoUring {
+    // False if the kernel or the platform does not support io_uring
+    bool available();
+    // Submits all requests at once and waits for them. Sets bytes_read of each request,
+    // a failed, short or not submitted read is left for the caller to finish. Never returns
+    // while a read is still in flight. Returns false if io_uring is not available and nothing was read.
+    bool readBatch(std::span<ReadRequest> requests);
+}
@@ -1,28 +1,72 @@
 #include "levelzero.h"
+#include <algorithm>
+#include <numeric>
 #include <unordered_set>
 namespace {
     constexpr auto file_extension = ".vsst";
     constexpr auto file_prefix = "L0_";
 }
 
-LevelZero::LevelZero(const std::filesystem::path& path, size_t max_num_files) : path_(path), max_num_files_(max_num_files) {
+LevelZero::LevelZero(const std::filesystem::path& path, size_t max_num_files, const SSTOptions& options) :
+    path_(path), max_num_files_(max_num_files), options_(options) {
     if (!std::filesystem::exists(path_)) {
         std::filesystem::create_directories(path_);
     }
     for (const auto& entry : std::filesystem::directory_iterator(path_)) {
         if (entry.is_regular_file() && entry.path().extension() == ".vsst") {
-            sst_files_.push_back(SSTFile::readAndCreate(entry.path()));
+            sst_files_.push_back(SSTFile::readAndCreate(entry.path(), options_));
         }
     }
     std::sort(sst_files_.begin(), sst_files_.end(),
         [](const auto& a, const auto& b) {
             return a->seqNum() < b->seqNum();
         }); 
+    updateRanges();
+}
+
+void LevelZero::updateRanges() {
+    ranges_.clear();
+    ranges_.reserve(sst_files_.size());
+    for (const auto& sst : sst_files_) {
+        ranges_.push_back({ sst->minKey(), sst->maxKey() });
+    }
+    by_min_key_.resize(sst_files_.size());
+    std::iota(by_min_key_.begin(), by_min_key_.end(), 0);
+    std::sort(by_min_key_.begin(), by_min_key_.end(), [this](size_t a, size_t b) {
+        return ranges_[a].min_key < ranges_[b].min_key;
+        });
+    max_reach_.resize(by_min_key_.size());
+    for (size_t i = 0; i < by_min_key_.size(); ++i) {
+        max_reach_[i] = by_min_key_[i];
+        if (i > 0 && ranges_[max_reach_[i]].max_key < ranges_[max_reach_[i - 1]].max_key) {
+            max_reach_[i] = max_reach_[i - 1];
+        }
+    }
+}
+
+std::vector<size_t> LevelZero::coveringFiles(const std::string& key) const {
+    std::vector<size_t> ret;
+    // Files starting after the key are skipped by the search, the scan back stops once no earlier file reaches the key
+    auto end = std::upper_bound(by_min_key_.begin(), by_min_key_.end(), key, [this](const std::string& k, size_t file) {
+        return k < ranges_[file].min_key;
+        });
+    for (auto i = static_cast<size_t>(end - by_min_key_.begin()); i > 0 && !(ranges_[max_reach_[i - 1]].max_key < key); --i) {
+        if (!(ranges_[by_min_key_[i - 1]].max_key < key)) {
+            ret.push_back(by_min_key_[i - 1]);
+        }
+    }
+    std::sort(ret.begin(), ret.end(), std::greater<>());
+    return ret;
+}
+
+bool LevelZero::mayContainPrefix(size_t file, const std::string& prefix) const {
+    const auto& range = ranges_[file];
+    return !(range.max_key < prefix) && (range.min_key < prefix || range.min_key.starts_with(prefix));
 }
 
 std::optional<Entry> LevelZero::get(const std::string& key) const {
-    for (auto it = sst_files_.rbegin(); it != sst_files_.rend(); ++it) {
-        auto val = (*it)->get(key);
+    for (auto file : coveringFiles(key)) {
+        auto val = sst_files_[file]->get(key);
         if (val.has_value()) {
             return val;
         }
@@ -30,12 +74,30 @@ std::optional<Entry> LevelZero::get(const std::string& key) const {
     return std::nullopt;
 }
 
+void LevelZero::multiGet(std::span<const std::string* const> keys, std::span<std::optional<Entry>> results) const {
+    // Newer files first, a key found in a file is skipped by the older ones
+    auto less = [](const std::string* a, const std::string& b) { return *a < b; };
+    for (size_t file = sst_files_.size(); file-- > 0;) {
+        // Keys are sorted, only the ones in the range of the file are passed to it
+        const auto& range = ranges_[file];
+        auto first = std::lower_bound(keys.begin(), keys.end(), range.min_key, less);
+        auto last = std::upper_bound(first, keys.end(), range.max_key,
+            [](const std::string& a, const std::string* b) { return a < *b; });
+        if (first == last) {
+            continue;
+        }
+        auto offset = static_cast<size_t>(first - keys.begin());
+        auto count = static_cast<size_t>(last - first);
+        sst_files_[file]->multiGet(keys.subspan(offset, count), results.subspan(offset, count));
+    }
+}
+
 bool LevelZero::remove(const std::string& key, uint64_t max_seq_num) {
-    for (auto it = sst_files_.rbegin(); it != sst_files_.rend(); ++it) {
-        if ((*it)->seqNum() > max_seq_num) {
+    for (auto file : coveringFiles(key)) {
+        if (sst_files_[file]->seqNum() > max_seq_num) {
             continue; // Skip SST files with higher sequence numbers
         }
-        if ((*it)->remove(key)) {
+        if (sst_files_[file]->remove(key)) {
             return true;
         }
     }
@@ -43,8 +105,18 @@ bool LevelZero::remove(const std::string& key, uint64_t max_seq_num) {
 }
 
 EntryStatus LevelZero::status(const std::string& key) const {
-    for (auto it = sst_files_.rbegin(); it != sst_files_.rend(); ++it) {
-        EntryStatus st = (*it)->status(key);
+    for (auto file : coveringFiles(key)) {
+        EntryStatus st = sst_files_[file]->status(key);
+        if (st != EntryStatus::NOT_FOUND) {
+            return st;
+        }
+    }
+    return EntryStatus::NOT_FOUND;
+}
+
+EntryStatus LevelZero::getRaw(const std::string& key, const RawValueCallback& callback) const {
+    for (auto file : coveringFiles(key)) {
+        EntryStatus st = sst_files_[file]->getRaw(key, callback);
         if (st != EntryStatus::NOT_FOUND) {
             return st;
         }
@@ -54,8 +126,11 @@ EntryStatus LevelZero::status(const std::string& key) const {
 
 std::vector<std::string> LevelZero::keysWithPrefix(const std::string& prefix, unsigned int max_results) const {
     std::vector<std::string> result;
-    for (auto it = sst_files_.rbegin(); it != sst_files_.rend() && result.size() < max_results; ++it) {
-        auto keys = (*it)->keysWithPrefix(prefix, max_results - result.size());
+    for (size_t file = sst_files_.size(); file-- > 0 && result.size() < max_results;) {
+        if (!mayContainPrefix(file, prefix)) {
+            continue;
+        }
+        auto keys = sst_files_[file]->keysWithPrefix(prefix, max_results - result.size());
         result.insert(result.end(),
             std::make_move_iterator(keys.begin()),
             std::make_move_iterator(keys.end()));
@@ -67,8 +142,11 @@ std::vector<std::string> LevelZero::keysWithPrefix(const std::string& prefix, un
 
 bool LevelZero::forEachKeyWithPrefix(const std::string& prefix, const std::function<bool(const std::string&)>& callback) const {
     std::unordered_set<std::string> seen;
-    for (auto it = sst_files_.rbegin(); it != sst_files_.rend(); ++it) {
-        if (!(*it)->forEachKeyWithPrefix(prefix, [&](const std::string& k) {
+    for (size_t file = sst_files_.size(); file-- > 0;) {
+        if (!mayContainPrefix(file, prefix)) {
+            continue;
+        }
+        if (!sst_files_[file]->forEachKeyWithPrefix(prefix, [&](const std::string& k) {
             if (seen.insert(k).second) {
                 return callback(k);
             }
@@ -93,7 +171,7 @@ std::vector<std::filesystem::path> LevelZero::filelistToMerge(uint64_t max_seq_n
     return ret;
 }
 
-IFileLevel::MergeResult LevelZero::mergeToTmp(const std::filesystem::path&, size_t) const {
+IFileLevel::MergeResult LevelZero::mergeToTmp(const std::filesystem::path&, size_t, const SSTOptions&) const {
     throw std::logic_error("Level 0 does not support merging to temporary files. Use Level 1 or higher for merging.");
 }
 
@@ -103,16 +181,19 @@ void LevelZero::addSST(std::vector<std::unique_ptr<SSTFile>>  ssts) {
         sst->rename(path_ / fname);
         sst_files_.push_back(std::move(sst));
     }
+    updateRanges();
 }
 
 void LevelZero::removeSSTs(const std::vector<std::filesystem::path>& sst_paths) {
     for (const auto& path : sst_paths) {
-        auto it = std::remove_if(sst_files_.begin(), sst_files_.end(),
-            [&path](const std::unique_ptr<SSTFile>& sst) { return sst->path() == path; });
-        if (it != sst_files_.end()) {
-            sst_files_.erase(it, sst_files_.end());
+        auto it = std::stable_partition(sst_files_.begin(), sst_files_.end(),
+            [&path](const std::shared_ptr<SSTFile>& sst) { return sst->path() != path; });
+        for (auto removed = it; removed != sst_files_.end(); ++removed) {
+            (*removed)->markObsolete();
         }
+        sst_files_.erase(it, sst_files_.end());
     }
+    updateRanges();
 }
 
 void LevelZero::clearCache() noexcept {
@@ -124,3 +205,7 @@ void LevelZero::clearCache() noexcept {
 size_t LevelZero::count() const {
     return sst_files_.size();
 }
+
+std::unique_ptr<IFileLevel> LevelZero::clone() const {
+    return std::make_unique<LevelZero>(*this);
+}
@@ -7,16 +7,18 @@
 // Implementation of Level 0. Key ranges may overlap.
 class LevelZero : public IFileLevel {
 public:
-    LevelZero(const std::filesystem::path& path, size_t max_num_files);
+    LevelZero(const std::filesystem::path& path, size_t max_num_files, const SSTOptions& options = {});
     ~LevelZero() override = default;
     std::optional<Entry> get(const std::string& key) const override;
     bool remove(const std::string& key, uint64_t max_seq_num) override;
     EntryStatus status(const std::string& key) const override;
+    EntryStatus getRaw(const std::string& key, const RawValueCallback& callback) const override;
+    void multiGet(std::span<const std::string* const> keys, std::span<std::optional<Entry>> results) const override;
     std::vector<std::string> keysWithPrefix(const std::string& prefix, unsigned int max_results) const override;
     bool forEachKeyWithPrefix(const std::string& prefix, const std::function<bool(const std::string&)>& callback) const override;
 
     std::vector<std::filesystem::path> filelistToMerge(uint64_t max_seq_num) const override;
-    MergeResult mergeToTmp(const std::filesystem::path&, size_t datablock_size) const override;
+    MergeResult mergeToTmp(const std::filesystem::path&, size_t datablock_size, const SSTOptions& options = {}) const override;
     void addSST(std::vector<std::unique_ptr<SSTFile>>  sst) override;
     void removeSSTs(const std::vector<std::filesystem::path>& sst_paths) override;
     void clearCache() noexcept override;
@@ -24,9 +26,27 @@ public:
         return sst_files_.empty() ? 0 : sst_files_.back()->seqNum();
     }
     size_t count() const override;
+    std::unique_ptr<IFileLevel> clone() const override;
 
 private:
+    struct KeyRange {
+        std::string min_key;
+        std::string max_key;
+    };
+    // Rebuilds the interval index after the file list changes. Uses the stored key ranges of the files,
+    // their indexes stay unloaded (except files older than SST_VERSION_KEY_RANGE).
+    void updateRanges();
+    // Indices of the files whose key range covers the key, newest first
+    std::vector<size_t> coveringFiles(const std::string& key) const;
+    bool mayContainPrefix(size_t file, const std::string& prefix) const;
+
     std::filesystem::path path_;
     size_t max_num_files_;
-    std::vector<std::unique_ptr<SSTFile>>  sst_files_;
+    SSTOptions options_; // used to open existing files
+    std::vector<std::shared_ptr<SSTFile>>  sst_files_;
+    // Interval index of the file key ranges: ranges_[i] belongs to sst_files_[i], by_min_key_ orders
+    // the files by min key and max_reach_[i] is the file with the greatest max key among by_min_key_[0..i]
+    std::vector<KeyRange> ranges_;
+    std::vector<size_t> by_min_key_;
+    std::vector<size_t> max_reach_;
 };
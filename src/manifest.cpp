@@ -43,6 +43,9 @@ Manifest::Manifest(const std::filesystem::path& path, const Config& config):
         if (j.contains("shrink_timer_minutes") && j["shrink_timer_minutes"].is_number_unsigned()) {
             config_.shrink_timer_minutes = j["shrink_timer_minutes"].get<uint32_t>();
         }
+        if (j.contains("bloom_bits_per_key") && j["bloom_bits_per_key"].is_number_unsigned()) {
+            config_.bloom_bits_per_key = j["bloom_bits_per_key"].get<uint32_t>();
+        }
 
     }
     else {
@@ -54,6 +57,7 @@ Manifest::Manifest(const std::filesystem::path& path, const Config& config):
         j["l0_max_files"] = config_.l0_max_files;
         j["block_size"] = config_.block_size;
         j["shrink_timer_minutes"] = config_.shrink_timer_minutes;
+        j["bloom_bits_per_key"] = config_.bloom_bits_per_key;
 
         std::ofstream out(manifest_path);
         if (!out.is_open()) {
@@ -84,4 +88,8 @@ void Manifest::validateConfig(const Config& config) const {
         throw std::invalid_argument("Invalid block size: " + std::to_string(config.block_size) +
             ". Must be between " + std::to_string(sst::MIN_BLOCK_SIZE) + " and " + std::to_string(sst::MAX_BLOCK_SIZE));
     }
+    if (config.bloom_bits_per_key > sst::filter::MAX_BITS_PER_KEY) {
+        throw std::invalid_argument("Invalid bloom bits per key: " + std::to_string(config.bloom_bits_per_key) +
+            ". Must not be greater than " + std::to_string(sst::filter::MAX_BITS_PER_KEY));
+    }
 }
@@ -1,65 +1,249 @@
 #include "memtable.h"
 #include "constants.h"
 #include "utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <random>
+#include <thread>
+
 MemTable::MemTable(size_t max_size_bytes)
     : max_size_bytes_(max_size_bytes) {
-    //aproximate initial size, to know exact size we need to know datablock size, but we don't want MemTable to manage it.
-    current_size_bytes_ = sst::header::SST_HEADER_SIZE + sst::indexblock::BLOCK_OFFSET_SIZE + sst::indexblock::INDEX_KEY_LEN;
+    head_ = newNode({}, MAX_HEIGHT);
+}
+
+MemTable::~MemTable() = default; // Everything is in the arena, nodes are trivially destructible
+
+MemTable::Node* MemTable::newNode(std::string_view key, int height) {
+    // Node is allocated with room for its tower of next pointers, key follows it
+    size_t node_size = sizeof(Node) + sizeof(std::atomic<Node*>) * (height - 1);
+    auto* mem = arena_.allocate(node_size + key.size(), alignof(Node));
+    auto* key_data = reinterpret_cast<char*>(mem + node_size);
+    std::memcpy(key_data, key.data(), key.size());
+    auto* node = new (mem) Node(key_data, static_cast<uint32_t>(key.size()), height);
+    for (int i = 1; i < height; ++i) {
+        new (&node->next_[i]) std::atomic<Node*>(nullptr);
+    }
+    return node;
+}
+
+MemTable::Version* MemTable::newVersion(const Entry& entry, uint64_t expiration_ms, uint64_t seq_num) {
+    thread_local std::vector<uint8_t> buffer;
+    buffer.clear();
+    if (entry.type != ValueType::REMOVED) {
+        Utils::serializeValue(entry.value, buffer);
+    }
+    auto* mem = arena_.allocate(sizeof(Version) + buffer.size(), alignof(Version));
+    auto* value = mem + sizeof(Version);
+    if (!buffer.empty()) {
+        std::memcpy(value, buffer.data(), buffer.size());
+    }
+    return new (mem) Version{ seq_num, expiration_ms, value, static_cast<uint32_t>(buffer.size()), entry.type, nullptr };
+}
+
+MemEntry MemTable::Version::toMemEntry() const {
+    MemEntry result{ Entry{ type, {} }, expiration_ms };
+    if (type != ValueType::REMOVED) {
+        size_t consumed = 0;
+        result.entry.value = Utils::deserializeValue(type, value, value_size, consumed);
+    }
+    return result;
+}
+
+int MemTable::randomHeight() {
+    thread_local std::minstd_rand rng(static_cast<unsigned>(std::hash<std::thread::id>{}(std::this_thread::get_id())));
+    int height = 1;
+    while (height < MAX_HEIGHT && rng() % BRANCHING == 0) {
+        ++height;
+    }
+    return height;
+}
+
+void MemTable::addVersion(Node* node, Version* version) {
+    auto* current = node->version.load(std::memory_order_acquire);
+    while (current->seq_num <= version->seq_num) {
+        // Older versions stay in the arena until clear()
+        version->prev = current;
+        if (node->version.compare_exchange_weak(current, version, std::memory_order_release, std::memory_order_acquire)) {
+            return;
+        }
+    }
+    // A newer write of this key is already here
+}
+
+void MemTable::findSplice(const std::string& key, Node** preds, Node** succs) const {
+    Node* x = head_;
+    for (int level = MAX_HEIGHT - 1; level >= 0; --level) {
+        Node* next = x->next(level).load(std::memory_order_acquire);
+        while (next && next->key() < key) {
+            x = next;
+            next = x->next(level).load(std::memory_order_acquire);
+        }
+        preds[level] = x;
+        succs[level] = next;
+    }
+}
+
+const MemTable::Node* MemTable::findGreaterOrEqual(const std::string& key) const {
+    const Node* x = head_;
+    const Node* next = nullptr;
+    for (int level = MAX_HEIGHT - 1; level >= 0; --level) {
+        next = x->next(level).load(std::memory_order_acquire);
+        while (next && next->key() < key) {
+            x = next;
+            next = x->next(level).load(std::memory_order_acquire);
+        }
+    }
+    return next;
+}
+
+const MemTable::Version* MemTable::findVersion(const std::string& key, uint64_t read_seq_num) const {
+    auto* node = findGreaterOrEqual(key);
+    if (!node || node->key() != key) {
+        return nullptr;
+    }
+    return visibleVersion(node, read_seq_num);
+}
+
+uint64_t MemTable::readSeqNum() const noexcept {
+    // The limit is lowered before a batch raises last_seq_num_, and lifted after all of it is inserted.
+    // Versions written after the read started are skipped as well.
+    auto last = last_seq_num_.load(std::memory_order_acquire);
+    return std::min(last, visible_seq_num_.load(std::memory_order_acquire));
+}
+
+const MemTable::Version* MemTable::visibleVersion(const Node* node, uint64_t read_seq_num) noexcept {
+    auto* version = node->version.load(std::memory_order_acquire);
+    while (version && version->seq_num > read_seq_num) {
+        version = version->prev;
+    }
+    return version;
+}
+
+void MemTable::insert(const std::string& key, Version* version) {
+    Node* preds[MAX_HEIGHT];
+    Node* succs[MAX_HEIGHT];
+    findSplice(key, preds, succs);
+    if (succs[0] && succs[0]->key() == key) {
+        addVersion(succs[0], version);
+        return;
+    }
+    int height = randomHeight();
+    Node* node = newNode(key, height);
+    node->version.store(version, std::memory_order_relaxed);
+    // Link bottom-up, the node becomes visible once it is linked on level 0
+    for (int level = 0; level < height; ++level) {
+        while (true) {
+            node->next(level).store(succs[level], std::memory_order_relaxed);
+            if (preds[level]->next(level).compare_exchange_strong(succs[level], node,
+                std::memory_order_release, std::memory_order_acquire)) {
+                break;
+            }
+            // Somebody linked a node after preds[level], search again from there
+            Node* x = preds[level];
+            Node* next = x->next(level).load(std::memory_order_acquire);
+            while (next && next->key() < key) {
+                x = next;
+                next = x->next(level).load(std::memory_order_acquire);
+            }
+            if (level == 0 && next && next->key() == key) {
+                // The same key was inserted concurrently, our node was never published
+                addVersion(next, version);
+                return;
+            }
+            preds[level] = x;
+            succs[level] = next;
+        }
+    }
+    ++count_;
 }
 
 void MemTable::put(const std::string& key, const Entry& entry, uint64_t expiration_ms) {
-    auto [_, inserted] = data_.insert_or_assign(key, MemEntry{entry, expiration_ms});
-    if (inserted) {
-        //KeyLengh + key + Expiration + ValueType + ValueLength (optional) + value + offset
-        current_size_bytes_ += Utils::onDiskEntrySize(key, entry.value);
+    put(key, entry, expiration_ms, last_seq_num_.load() + 1);
+}
+
+void MemTable::put(const std::string& key, const Entry& entry, uint64_t expiration_ms, uint64_t seq_num) {
+    auto last = last_seq_num_.load();
+    while (last < seq_num && !last_seq_num_.compare_exchange_weak(last, seq_num)) {
     }
+    insert(key, newVersion(entry, expiration_ms, seq_num));
 }
 
 std::optional<Entry> MemTable::get(const std::string& key) const {
-    auto it = data_.find(key);
-    if (it == data_.end())
+    auto* version = findVersion(key, readSeqNum());
+    if (!version)
         return std::nullopt;
-    if (isExpired(it->second)) {
+    if (isExpired(*version)) {
         return Entry{ ValueType::REMOVED, {} };
     }
-    return it->second.entry;
+    return version->toMemEntry().entry;
 }
 
 EntryStatus MemTable::status(const std::string& key) const {
-    auto it = data_.find(key);
-    if (it == data_.end())
+    auto* version = findVersion(key, readSeqNum());
+    if (!version)
         return EntryStatus::NOT_FOUND;
-    if (isExpired(it->second)) {
+    if (isExpired(*version)) {
         return EntryStatus::REMOVED;
     }
     return EntryStatus::EXISTS;
 }
 
+EntryStatus MemTable::getRaw(const std::string& key, const RawValueCallback& callback) const {
+    auto* version = findVersion(key, readSeqNum());
+    if (!version)
+        return EntryStatus::NOT_FOUND;
+    if (isExpired(*version) || version->type == ValueType::REMOVED) {
+        return EntryStatus::REMOVED;
+    }
+    callback(RawValue{ version->type, version->value, version->value_size, false, version->expiration_ms });
+    return EntryStatus::EXISTS;
+}
+
+void MemTable::multiGet(std::span<const std::string* const> keys, std::span<std::optional<Entry>> results) const {
+    auto read_seq_num = readSeqNum();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (results[i]) {
+            continue;
+        }
+        auto* version = findVersion(*keys[i], read_seq_num);
+        if (!version) {
+            continue;
+        }
+        results[i] = isExpired(*version) ? Entry{ ValueType::REMOVED, {} } : version->toMemEntry().entry;
+    }
+}
+
 std::vector<std::string> MemTable::keysWithPrefix(const std::string& prefix, unsigned int max_results) const {
+    auto read_seq_num = readSeqNum();
     std::vector<std::string> result;
-    result.reserve(std::min(static_cast<size_t>(max_results), data_.size()));
+    result.reserve(std::min(static_cast<size_t>(max_results), count()));
 
-    for (auto it = data_.lower_bound(prefix);
-        it != data_.end() && result.size() < static_cast<size_t>(max_results); ++it) {
-        const auto& key = it->first;
-        if (key.compare(0, prefix.size(), prefix) != 0) {
+    for (auto* node = findGreaterOrEqual(prefix);
+        node && result.size() < static_cast<size_t>(max_results); node = node->next(0).load(std::memory_order_acquire)) {
+        auto key = node->key();
+        if (!key.starts_with(prefix)) {
             break;
         }
-        if (!isExpired(it->second) && it->second.entry.type != ValueType::REMOVED) {
-            result.push_back(key);
+        auto* version = visibleVersion(node, read_seq_num);
+        if (version && !isExpired(*version) && version->type != ValueType::REMOVED) {
+            result.emplace_back(key);
         }
     }
     return result;
 }
 
 bool MemTable::forEachKeyWithPrefix(const std::string& prefix, const std::function<bool(const std::string&)>& callback) const {
-    for (auto it = data_.lower_bound(prefix); it != data_.end(); ++it) {
-        const auto& key = it->first;
-        if (key.compare(0, prefix.size(), prefix) != 0) {
-            return true; 
+    auto read_seq_num = readSeqNum();
+    for (auto* node = findGreaterOrEqual(prefix); node; node = node->next(0).load(std::memory_order_acquire)) {
+        auto key = node->key();
+        if (!key.starts_with(prefix)) {
+            return true;
         }
-        if (!isExpired(it->second) && it->second.entry.type != ValueType::REMOVED) {
-            if (!callback(key)) {
+        auto* version = visibleVersion(node, read_seq_num);
+        if (version && !isExpired(*version) && version->type != ValueType::REMOVED) {
+            if (!callback(std::string(key))) {
                 return false; // Stop iterating if callback returns false
             }
         }
@@ -68,29 +252,49 @@ bool MemTable::forEachKeyWithPrefix(const std::string& prefix, const std::functi
 }
 
 bool MemTable::remove(const std::string& key) {
-    auto it = data_.find(key);
-    if (it != data_.end()) {
-        it->second.expiration_ms = sst::datablock::EXPIRATION_DELETED;
-        it->second.entry.type = ValueType::REMOVED;
-        return true;
+    return remove(key, last_seq_num_.load() + 1);
+}
+
+bool MemTable::remove(const std::string& key, uint64_t seq_num) {
+    auto* node = const_cast<Node*>(findGreaterOrEqual(key));
+    if (!node || node->key() != key) {
+        return false;
+    }
+    auto last = last_seq_num_.load();
+    while (last < seq_num && !last_seq_num_.compare_exchange_weak(last, seq_num)) {
     }
-    return false;
+    addVersion(node, newVersion(Entry{ ValueType::REMOVED, {} }, sst::datablock::EXPIRATION_DELETED, seq_num));
+    return true;
+}
+
+MemTable::iterator MemTable::begin() const noexcept {
+    return iterator(head_->next(0).load(std::memory_order_acquire));
+}
+
+MemTable::iterator::value_type MemTable::iterator::operator*() const {
+    return value_type{ std::string(node_->key()), node_->version.load(std::memory_order_acquire)->toMemEntry() };
 }
 
+MemTable::iterator& MemTable::iterator::operator++() {
+    node_ = node_->next(0).load(std::memory_order_acquire);
+    return *this;
+}
 
 bool MemTable::full() const noexcept {
-    return current_size_bytes_ >= max_size_bytes_;
+    return arena_.memoryUsage() >= max_size_bytes_;
 }
 
-size_t MemTable::count() const noexcept(noexcept(data_.size())) {
-    return data_.size();
+size_t MemTable::count() const noexcept {
+    return count_;
 }
 
-void MemTable::clear() noexcept(noexcept(data_.clear()))  {
-    data_.clear();
-    current_size_bytes_ = 0;
+void MemTable::clear() {
+    arena_.reset();
+    count_ = 0;
+    last_seq_num_ = 0;
+    head_ = newNode({}, MAX_HEIGHT);
 }
 
-bool MemTable::isExpired(const MemEntry& entry) const {
-    return Utils::isExpired(entry.expiration_ms);
+bool MemTable::isExpired(const Version& version) const {
+    return Utils::isExpired(version.expiration_ms);
 }
@@ -1,42 +1,144 @@
 #pragma once
-#include <map>
+#include <atomic>
 #include <string>
 #include <optional>
 #include <functional>
 #include <chrono>
+#include <iterator>
+#include <string_view>
 #include "types.h"
 #include "ilevel.h"
+#include "arena.h"
 
 struct MemEntry {
     Entry entry;
     uint64_t expiration_ms = std::numeric_limits<uint64_t>::max();
 };
 
+// Concurrent skiplist. Any number of threads may put/remove and read at the same time,
+// reads never block. Nodes are never unlinked, so a node pointer stays valid until clear().
+// Nodes, keys and serialized values live in the arena owned by the MemTable, size of the
+// MemTable is the memory taken by the arena.
+// Every update of a key adds a new version to its node, the version with the highest sequence
+// number is visible. Sequence number lets the caller order concurrent writes of the same key
+// the same way as they are ordered in the write-ahead log. Older versions stay reachable, so
+// versions above the visible sequence number can be hidden from readers while a batch is inserted.
 class MemTable : public ILevel {
+    struct Version;
+    struct Node;
 public:
+    class iterator {
+    public:
+        struct value_type {
+            std::string first;
+            MemEntry second;
+        };
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using reference = value_type;
+
+        iterator() noexcept = default;
+        explicit iterator(const Node* node) noexcept : node_(node) {}
+
+        value_type operator*() const;
+        iterator& operator++();
+        void operator++(int) {
+            ++*this;
+        }
+        bool operator==(const iterator& other) const noexcept {
+            return node_ == other.node_;
+        }
+
+    private:
+        const Node* node_ = nullptr;
+    };
+
     explicit MemTable(size_t max_size_bytes);
+    ~MemTable() override;
+    MemTable(const MemTable&) = delete;
+    MemTable& operator=(const MemTable&) = delete;
 
+    // Writes without sequence number are ordered by the call order
     void put(const std::string& key, const Entry& entry, uint64_t expiration_ms);
+    void put(const std::string& key, const Entry& entry, uint64_t expiration_ms, uint64_t seq_num);
     std::optional<Entry> get(const std::string& key) const override;
     bool remove(const std::string& key);
+    bool remove(const std::string& key, uint64_t seq_num);
     EntryStatus status(const std::string& key) const override;
+    EntryStatus getRaw(const std::string& key, const RawValueCallback& callback) const override;
+    void multiGet(std::span<const std::string* const> keys, std::span<std::optional<Entry>> results) const override;
     std::vector<std::string> keysWithPrefix(const std::string& prefix, unsigned int max_results) const override;
     bool forEachKeyWithPrefix(const std::string& prefix, const std::function<bool(const std::string&)>& callback) const override;
 
-    auto begin() const noexcept(noexcept(data_.begin())) {
-        return data_.begin();
+    iterator begin() const noexcept;
+    iterator end() const noexcept {
+        return iterator();
     }
-    auto end() const noexcept(noexcept(data_.end())) {
-        return data_.end();
+    // Readers see versions with sequence numbers up to seq_num only (all by default).
+    // Writes of a batch are inserted under a limit and become visible at once when it is lifted.
+    void setVisibleSeqNum(uint64_t seq_num) noexcept {
+        visible_seq_num_.store(seq_num, std::memory_order_release);
     }
+    // Full when the arena took max_size_bytes from the system
     bool full() const noexcept;
-    size_t count() const noexcept(noexcept(data_.size()));
-    void clear() noexcept(noexcept(data_.clear()));
+    size_t count() const noexcept;
+    // Releases the arena in one shot. Not thread safe, nobody else may access the MemTable.
+    void clear();
 
 private:
+    static constexpr int MAX_HEIGHT = 12;
+    static constexpr unsigned BRANCHING = 4;
+
+    struct Version {
+        uint64_t seq_num;
+        uint64_t expiration_ms;
+        const uint8_t* value; // serialized as in DataBlock
+        uint32_t value_size;
+        ValueType type;
+        const Version* prev; // replaced version of the key
+
+        MemEntry toMemEntry() const;
+    };
+
+    struct Node {
+        const char* key_data;
+        uint32_t key_size;
+        int height;
+        std::atomic<const Version*> version;
+        std::atomic<Node*> next_[1]; // Actual size is height
+
+        Node(const char* k, uint32_t size, int h) : key_data(k), key_size(size), height(h) {}
+        std::string_view key() const noexcept {
+            return { key_data, key_size };
+        }
+        std::atomic<Node*>& next(int level) noexcept {
+            return next_[level];
+        }
+        const std::atomic<Node*>& next(int level) const noexcept {
+            return next_[level];
+        }
+    };
+
+    Node* newNode(std::string_view key, int height);
+    Version* newVersion(const Entry& entry, uint64_t expiration_ms, uint64_t seq_num);
+    static int randomHeight();
+    static void addVersion(Node* node, Version* version);
+    // Sequence number limit of one read, taken once per call so that a read sees all of a batch or none of it
+    uint64_t readSeqNum() const noexcept;
+    // Newest version not above the read limit, nullptr if there is none
+    static const Version* visibleVersion(const Node* node, uint64_t read_seq_num) noexcept;
+    // For each level: last node with key < given key and the node after it
+    void findSplice(const std::string& key, Node** preds, Node** succs) const;
+    const Node* findGreaterOrEqual(const std::string& key) const;
+    const Version* findVersion(const std::string& key, uint64_t read_seq_num) const;
+    void insert(const std::string& key, Version* version);
+
     size_t max_size_bytes_;
-    size_t current_size_bytes_ = 0;
-    std::map<std::string, MemEntry> data_;
+    Arena arena_;
+    std::atomic<size_t> count_ = 0;
+    std::atomic<uint64_t> last_seq_num_ = 0;
+    std::atomic<uint64_t> visible_seq_num_ = std::numeric_limits<uint64_t>::max();
+    Node* head_;
 
-    bool isExpired(const MemEntry& entry) const;
+    bool isExpired(const Version& version) const;
 };
@@ -75,6 +75,17 @@ void MergeLog::removeFiles() {
 
 }
 
+void MergeLog::complete() {
+    files_to_register_.clear();
+    std::erase_if(files_to_remove_, [](const auto& path) { return !std::filesystem::exists(path); });
+    if (files_to_remove_.empty()) {
+        std::filesystem::remove(path_);
+    }
+    else {
+        commit();
+    }
+}
+
 const std::vector<std::filesystem::path>& MergeLog::filesToRemove() const {
     return files_to_remove_;
 }
@@ -13,6 +13,9 @@ public:
     void addToRegister(int levelId, const std::filesystem::path& file);
     void commit() const;
     void removeFiles();
+    // Called once the merge is published. Registered files are forgotten, files to remove stay
+    // in the log until their last reader deletes them, the next start removes the leftovers.
+    void complete();
     bool empty() const noexcept {
         return files_to_remove_.empty() && files_to_register_.empty();
     }
@@ -0,0 +1,108 @@
+#include "rowcache.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <iterator>
+
+RowCache::RowCache(size_t capacity_bytes, size_t num_shards)
+    : shards_(std::max<size_t>(num_shards, 1)), capacity_(capacity_bytes) {
+    for (auto& shard : shards_) {
+        shard.capacity = capacity_bytes / shards_.size();
+    }
+}
+
+RowCache::Shard& RowCache::shardFor(std::string_view key) {
+    return shards_[Utils::hash64(key.data(), key.size()) % shards_.size()];
+}
+
+RowCache::RowPtr RowCache::lookup(const std::string& key) {
+    auto& shard = shardFor(key);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.map.find(key);
+    if (it == shard.map.end()) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    if (Utils::isExpired(it->second->second->expiration_ms)) {
+        shard.eraseLocked(it->second);
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return it->second->second;
+}
+
+uint64_t RowCache::epoch(const std::string& key) {
+    auto& shard = shardFor(key);
+    std::lock_guard lock(shard.mutex);
+    return shard.epoch;
+}
+
+void RowCache::insert(const std::string& key, RowPtr row, uint64_t epoch) {
+    auto& shard = shardFor(key);
+    std::lock_guard lock(shard.mutex);
+    if (shard.epoch != epoch) {
+        return; // the row may be older than a concurrent write
+    }
+    auto it = shard.map.find(key);
+    if (it != shard.map.end()) {
+        shard.eraseLocked(it->second);
+    }
+    if (!row || charge(key, *row) > shard.capacity) {
+        return;
+    }
+    shard.usage += charge(key, *row);
+    shard.lru.emplace_front(key, std::move(row));
+    shard.map.emplace(shard.lru.front().first, shard.lru.begin());
+    shard.evict();
+}
+
+void RowCache::invalidate(const std::string& key) {
+    auto& shard = shardFor(key);
+    std::lock_guard lock(shard.mutex);
+    ++shard.epoch;
+    auto it = shard.map.find(key);
+    if (it != shard.map.end()) {
+        shard.eraseLocked(it->second);
+    }
+}
+
+void RowCache::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard lock(shard.mutex);
+        ++shard.epoch;
+        shard.map.clear();
+        shard.lru.clear();
+        shard.usage = 0;
+    }
+}
+
+RowCache::Stats RowCache::stats() const {
+    Stats stats;
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_relaxed);
+    stats.capacity_bytes = capacity_;
+    for (const auto& shard : shards_) {
+        std::lock_guard lock(shard.mutex);
+        stats.usage_bytes += shard.usage;
+    }
+    return stats;
+}
+
+void RowCache::resetStats() noexcept {
+    hits_ = 0;
+    misses_ = 0;
+}
+
+void RowCache::Shard::evict() {
+    while (usage > capacity && !lru.empty()) {
+        eraseLocked(std::prev(lru.end()));
+    }
+}
+
+void RowCache::Shard::eraseLocked(LruList::iterator it) {
+    usage -= charge(it->first, *it->second);
+    map.erase(it->first);
+    lru.erase(it);
+}
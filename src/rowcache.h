@@ -0,0 +1,87 @@
+#pragma once
+#include "types.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Cache of point lookup results of one storage, keyed by user key. A row holds the serialized
+// value of the key or marks it as missing, rows are evicted in LRU order once their total size
+// exceeds the capacity. Writers invalidate a key after the change is visible to readers, a row read
+// from the levels is inserted only if its shard was not invalidated since the read started.
+class RowCache {
+public:
+    struct Row {
+        ValueType type = ValueType::REMOVED; // REMOVED - the key does not exist
+        std::vector<uint8_t> value;          // as stored in the level it was read from
+        bool varint_length = false;
+        uint64_t expiration_ms = sst::datablock::EXPIRATION_NOT_SET;
+
+        RawValue raw() const noexcept {
+            return { type, value.data(), value.size(), varint_length, expiration_ms };
+        }
+    };
+    using RowPtr = std::shared_ptr<const Row>;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t usage_bytes = 0;
+        size_t capacity_bytes = 0;
+
+        double hitRatio() const noexcept {
+            return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(hits + misses);
+        }
+    };
+
+    static constexpr size_t DEFAULT_NUM_SHARDS = 16;
+    // Charged per row in addition to the key and value bytes
+    static constexpr size_t ROW_OVERHEAD = sizeof(Row) + 64;
+
+    explicit RowCache(size_t capacity_bytes, size_t num_shards = DEFAULT_NUM_SHARDS);
+    RowCache(const RowCache&) = delete;
+    RowCache& operator=(const RowCache&) = delete;
+
+    // Counts a hit or a miss, an expired row is dropped and counted as a miss
+    RowPtr lookup(const std::string& key);
+    // Taken before the key is read from the levels, passed to insert() with the result
+    uint64_t epoch(const std::string& key);
+    // Replaces the cached row. Skipped if the shard of the key was invalidated after `epoch`
+    // or the row is larger than a shard.
+    void insert(const std::string& key, RowPtr row, uint64_t epoch);
+    void invalidate(const std::string& key);
+    void clear();
+    Stats stats() const;
+    void resetStats() noexcept;
+
+private:
+    struct Shard {
+        using LruList = std::list<std::pair<std::string, RowPtr>>; // most recently used in front
+        mutable std::mutex mutex;
+        LruList lru;
+        std::unordered_map<std::string_view, LruList::iterator> map; // views of the keys in lru
+        size_t usage = 0;
+        size_t capacity = 0;
+        uint64_t epoch = 0; // incremented by every invalidation
+
+        void evict();
+        void eraseLocked(LruList::iterator it);
+    };
+
+    static size_t charge(const std::string& key, const Row& row) noexcept {
+        return key.size() + row.value.size() + ROW_OVERHEAD;
+    }
+    Shard& shardFor(std::string_view key);
+
+    std::vector<Shard> shards_;
+    size_t capacity_;
+    std::atomic<uint64_t> hits_ = 0;
+    std::atomic<uint64_t> misses_ = 0;
+};
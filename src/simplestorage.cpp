@@ -5,11 +5,14 @@
 #include "sstfile.h"
 #include "memtable.h"
 #include "mergelog.h"
+#include "fileio.h"
 
 #include <format>
 #include <unordered_set>
 #include <unordered_map>
 #include <algorithm>
+#include <numeric>
+#include <limits>
 #include <filesystem>
 namespace {
     constexpr std::string_view level0_name = "level0";
@@ -46,10 +49,32 @@ namespace {
 }
 uint64_t SimpleStorage::sst_sequence_number = 0;
 
+namespace {
+    std::mutex open_storages_mutex;
+    size_t open_storages = 0;
+}
+
+SimpleStorage::OpenStorage::OpenStorage(const Config& config) {
+    std::lock_guard lock(open_storages_mutex);
+    if (open_storages++ == 0) {
+        BlockCache::instance().setCapacity(config.block_cache_size_bytes);
+        TableCache::instance().setCapacity(config.max_open_files);
+    }
+}
+
+SimpleStorage::OpenStorage::~OpenStorage() {
+    std::lock_guard lock(open_storages_mutex);
+    --open_storages;
+}
+
 SimpleStorage::SimpleStorage(const std::filesystem::path& data_dir, const Config& config)
-    : manifest_(data_dir, config), data_dir_(data_dir),
-    worker_thread_([this](std::stop_token st) { workerLoop(st); }), lock_file_(data_dir / lock_file_name) {
+    : manifest_(data_dir, config), open_storage_(manifest_.getConfig()), data_dir_(data_dir),
+    worker_thread_([this](std::stop_token st) { workerLoop(st); }), lock_file_(data_dir / lock_file_name),
+    wal_(data_dir, manifest_.getConfig().wal_sync_mode, manifest_.getConfig().wal_sync_interval_ms) {
     const auto& real_config = manifest_.getConfig();
+    if (real_config.row_cache_size_bytes > 0) {
+        row_cache_ = std::make_unique<RowCache>(real_config.row_cache_size_bytes);
+    }
     MergeLog merge_log(data_dir_ / merge_log_name);
     for (const auto& path : merge_log.filesToRemove()) {
         std::filesystem::remove(path);
@@ -61,27 +86,35 @@ SimpleStorage::SimpleStorage(const std::filesystem::path& data_dir, const Config
             sst_sequence_number = std::max(sst_sequence_number, sst->seqNum());
         }
     }
-    levels_.push_back(std::make_unique<MemTable>(real_config.memtable_size_bytes)); // First level is MemTable
-    levels_.push_back(std::make_unique<LevelZero>(data_dir / level0_name, real_config.l0_max_files)); // Level 0 of the storage
+    auto version = std::make_shared<LevelsVersion>();
+    version->levels.push_back(std::make_shared<MemTable>(real_config.memtable_size_bytes)); // First level is MemTable
+    version->levels.push_back(std::make_shared<LevelZero>(data_dir / level0_name, real_config.l0_max_files, sstOptions())); // Level 0 of the storage
     auto nonzero_level_config = generateLevelConfigs(real_config.memtable_size_bytes, real_config.l0_max_files);
     int i = 1;
     for (const auto& lc : nonzero_level_config) {
-        levels_.push_back(std::make_unique<GeneralLevel>(data_dir / (levelN_prefix.data() + std::to_string(i++)),
-            lc.max_file_size, lc.max_num_files, lc.is_last)); // Level 1+
+        version->levels.push_back(std::make_shared<GeneralLevel>(data_dir / (levelN_prefix.data() + std::to_string(i++)),
+            lc.max_file_size, lc.max_num_files, lc.is_last, sstOptions())); // Level 1+
     }
+    version_.store(std::move(version));
+    wal_.replay([this](uint64_t lsn, const std::string& key, const Entry& entry, uint64_t expiration_ms) {
+        memTable()->put(key, entry, expiration_ms, lsn);
+        });
     completeMerge();
     removeAllTemporaryFiles();
+    flush_thread_ = std::jthread([this](std::stop_token st) { flushLoop(st); });
+    if (memTable()->full()) {
+        flush();
+    }
     if (real_config.shrink_timer_minutes > 0) {
         shrink_timer_thread_ = std::jthread([this](std::stop_token st) { this->shrinkTimerLoop(st); });
     }
 }
 
 SimpleStorage::~SimpleStorage() {
-    try {
-        flush();
-    }
-    catch (...) {
-        // ignore other errors
+    // MemTable content is kept in the WAL and replayed on the next start, no need to flush it
+    flush_thread_.request_stop();
+    if (flush_thread_.joinable()) {
+        flush_thread_.join();
     }
     worker_thread_.request_stop();
     shrink_timer_thread_.request_stop();
@@ -89,33 +122,145 @@ SimpleStorage::~SimpleStorage() {
     queue_cv_.notify_all();
 }
 
+IFileLevel& SimpleStorage::LevelsVersion::editFileLevel(size_t level) {
+    std::shared_ptr<IFileLevel> copy = static_cast<const IFileLevel&>(*levels[level]).clone();
+    levels[level] = copy;
+    return *copy;
+}
+
+template <typename Func>
+void SimpleStorage::publishVersion(Func&& func) {
+    auto next = std::make_shared<LevelsVersion>(*currentVersion());
+    func(*next);
+    version_.store(std::move(next), std::memory_order_release);
+}
+
+template <typename Func>
+bool SimpleStorage::forEachLevel(const LevelsVersion& version, Func&& func) {
+    // MemTable, immutable MemTable (if any), then file levels
+    if (!func(*version.levels[0])) {
+        return false;
+    }
+    if (version.immutable_memtable && !func(*version.immutable_memtable)) {
+        return false;
+    }
+    for (size_t i = 1; i < version.levels.size(); ++i) {
+        if (!func(*version.levels[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
 std::optional<Entry> SimpleStorage::get(const std::string& key) const {
-    std::shared_lock lock(readwrite_mutex_);
-    for (const auto& level : levels_) {
-        std::optional<Entry> entry = level->get(key);
-        if (entry.has_value()) {
-            if (entry.value().type != ValueType::REMOVED) {
-                return entry;
-            }
-            else {
-                return std::nullopt;
-            }
+    if (row_cache_) {
+        std::optional<Entry> result;
+        getRaw(key, [&](const RawValue& raw) {
+            size_t consumed = 0;
+            result = Entry{ raw.type, Utils::deserializeValue(raw.type, raw.data, raw.size, consumed, raw.varint_length) };
+            });
+        return result;
+    }
+    auto version = currentVersion();
+    std::optional<Entry> result;
+    forEachLevel(*version, [&](const ILevel& level) {
+        result = level.get(key);
+        return !result.has_value();
+        });
+    if (result.has_value() && result->type == ValueType::REMOVED) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+bool SimpleStorage::getRaw(const std::string& key, const RawValueCallback& callback) const {
+    if (!row_cache_) {
+        return readRaw(key, callback);
+    }
+    auto row = row_cache_->lookup(key);
+    if (!row) {
+        // A write of the key during the read keeps the row out of the cache
+        auto epoch = row_cache_->epoch(key);
+        auto new_row = std::make_shared<RowCache::Row>();
+        readRaw(key, [&](const RawValue& raw) {
+            new_row->type = raw.type;
+            new_row->value.assign(raw.data, raw.data + Utils::serializedValueSize(raw));
+            new_row->varint_length = raw.varint_length;
+            new_row->expiration_ms = raw.expiration_ms;
+            });
+        row = new_row;
+        row_cache_->insert(key, row, epoch);
+    }
+    if (row->type == ValueType::REMOVED) {
+        return false;
+    }
+    callback(row->raw());
+    return true;
+}
+
+bool SimpleStorage::readRaw(const std::string& key, const RawValueCallback& callback) const {
+    auto version = currentVersion();
+    auto status = EntryStatus::NOT_FOUND;
+    forEachLevel(*version, [&](const ILevel& level) {
+        status = level.getRaw(key, callback);
+        return status == EntryStatus::NOT_FOUND;
+        });
+    return status == EntryStatus::EXISTS;
+}
+
+std::vector<std::optional<Entry>> SimpleStorage::multiGet(std::span<const std::string> keys) const {
+    std::vector<size_t> order(keys.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+    std::vector<const std::string*> sorted_keys;
+    sorted_keys.reserve(keys.size());
+    for (auto idx : order) {
+        sorted_keys.push_back(&keys[idx]);
+    }
+    std::vector<std::optional<Entry>> sorted_results(keys.size());
+    auto version = currentVersion();
+    forEachLevel(*version, [&](const ILevel& level) {
+        level.multiGet(sorted_keys, sorted_results);
+        return std::any_of(sorted_results.begin(), sorted_results.end(), [](const auto& r) { return !r.has_value(); });
+        });
+    std::vector<std::optional<Entry>> results(keys.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        auto& result = sorted_results[i];
+        if (result.has_value() && result->type != ValueType::REMOVED) {
+            results[order[i]] = std::move(result);
         }
     }
-    return std::nullopt;
+    return results;
 }
 
 bool SimpleStorage::removeAsync(const std::string& key) {
     bool success;
-    uint64_t seq_num;
+    bool in_immutable = false;
+    uint64_t seq_num = 0;
+    uint64_t lsn = 0;
     {
-        std::lock_guard lock(readwrite_mutex_);
-        success = memTable()->remove(key);
+        std::shared_lock lock(readwrite_mutex_);
+        success = memTable()->status(key) != EntryStatus::NOT_FOUND;
         if (success) {
-            return true;
+            lsn = wal_.append(key, Entry{ ValueType::REMOVED, {} }, sst::datablock::EXPIRATION_DELETED);
+            memTable()->remove(key, lsn);
+            invalidateRow(key);
+        }
+        else if (auto version = currentVersion();
+            version->immutable_memtable && version->immutable_memtable->status(key) != EntryStatus::NOT_FOUND) {
+            // Level 0 file for it does not exist yet, the only way is to shadow it by remove record
+            in_immutable = true;
         }
         seq_num = sst_sequence_number; // Get the current sequence number for MemTable
     }
+    if (success) {
+        wal_.sync(lsn);
+        return true;
+    }
+    if (in_immutable) {
+        remove(key);
+        return true;
+    }
     //failed to delete in memtable make async remove in Level 0 and higher
     std::lock_guard lock(queue_mutex_);
     task_queue_.push(RemoveSSTTask{ key, seq_num });
@@ -130,27 +275,21 @@ void SimpleStorage::remove(const std::string& key) {
 
 
 bool SimpleStorage::exists(const std::string& key) const {
-    std::shared_lock lock(readwrite_mutex_);
-    for (const auto& level : levels_) {
-        auto status = level->status(key);
-        switch (status) {
-        case EntryStatus::EXISTS:
-            return true;
-        case EntryStatus::REMOVED:
-            return false;
-        case EntryStatus::NOT_FOUND:
-            continue;
-        }
-    }
-    return false;
+    auto version = currentVersion();
+    auto status = EntryStatus::NOT_FOUND;
+    forEachLevel(*version, [&](const ILevel& level) {
+        status = level.status(key);
+        return status == EntryStatus::NOT_FOUND;
+        });
+    return status == EntryStatus::EXISTS;
 }
 
 std::vector<std::string> SimpleStorage::keysWithPrefix(const std::string& prefix, unsigned int max_results) const {
-    std::shared_lock lock(readwrite_mutex_);
+    auto version = currentVersion();
     std::vector<std::string> ret;
     std::unordered_set<std::string> seen;
-    for (const auto& level : levels_) {
-        auto keys = level->keysWithPrefix(prefix, max_results - ret.size());
+    forEachLevel(*version, [&](const ILevel& level) {
+        auto keys = level.keysWithPrefix(prefix, max_results - ret.size());
         ret.reserve(ret.size() + keys.size());
         for (auto& key : keys) {
             if (seen.insert(key).second) {
@@ -159,70 +298,295 @@ std::vector<std::string> SimpleStorage::keysWithPrefix(const std::string& prefix
                     break;
             }
         }
-    }
+        return ret.size() < max_results;
+        });
     return ret;
 }
 
 void SimpleStorage::forEachKeyWithPrefix(const std::string& prefix, const std::function<bool(const std::string&)>& callback) const {
-    std::shared_lock lock(readwrite_mutex_);
+    auto version = currentVersion();
     std::unordered_set<std::string> seen;
-    for (const auto& level : levels_) {
-        if (!level->forEachKeyWithPrefix(prefix, [&](const std::string& k) {
+    forEachLevel(*version, [&](const ILevel& level) {
+        return level.forEachKeyWithPrefix(prefix, [&](const std::string& k) {
             if (seen.insert(k).second) {
                 return callback(k);
             }
-            return true;})) {
-            return;
-        }
-    }
+            return true;});
+        });
 }
 
 
 void SimpleStorage::clearCache() {
-    for (size_t i = 1; i < levels_.size(); ++i) {
-        static_cast<IFileLevel*>(levels_[i].get())->clearCache();
+    if (row_cache_) {
+        row_cache_->clear();
+    }
+    auto version = currentVersion();
+    for (size_t i = 1; i < version->levels.size(); ++i) {
+        static_cast<IFileLevel*>(version->levels[i].get())->clearCache();
     }
 }
 
+BlockCache::Stats SimpleStorage::blockCacheStats() const {
+    return BlockCache::instance().stats();
+}
+
+TableCache::Stats SimpleStorage::tableCacheStats() const {
+    return TableCache::instance().stats();
+}
+
+RowCache::Stats SimpleStorage::rowCacheStats() const {
+    return row_cache_ ? row_cache_->stats() : RowCache::Stats{};
+}
+
 void SimpleStorage::flush() {
-    std::lock_guard readwrite_lock(readwrite_mutex_);
+    std::unique_lock lock(readwrite_mutex_);
     if (memTable()->count() != 0) {
-        flushImpl();
+        switchMemTable(lock);
+    }
+    else if (currentVersion()->immutable_memtable && flush_error_) {
+        // Retry the failed flush
+        flush_error_ = nullptr;
+        flush_requested_ = true;
+        flush_cv_.notify_one();
+    }
+    flush_done_cv_.wait(lock, [this] { return !currentVersion()->immutable_memtable || flush_error_; });
+    if (flush_error_) {
+        std::rethrow_exception(flush_error_);
     }
 }
 
 void SimpleStorage::putImpl(const std::string& key, const Entry& entry, uint64_t expiration_ms) {
-    std::lock_guard lock(readwrite_mutex_);
-    auto* memtable = memTable();
-    memtable->put(key, entry, expiration_ms);
-    if (memtable->full()) {
-        flushImpl();
+    Writer writer;
+    writer.key = &key;
+    writer.entry = &entry;
+    writer.expiration_ms = expiration_ms;
+    writeImpl(writer);
+}
+
+void SimpleStorage::checkEntrySize(uint64_t entry_size) const {
+    const auto& config = manifest_.getConfig();
+    size_t block_overhead = sst::datablock::DATABLOCK_COUNT_SIZE +
+        (config.datablock_hash_index ? sst::datablock::MIN_HASH_INDEX_SIZE : 0);
+    if (entry_size + block_overhead > config.block_size) {
+        throw std::invalid_argument("Entry size exceeds maximum allowed size");
     }
 }
 
-void SimpleStorage::flushImpl() {
-    std::vector<std::unique_ptr<SSTFile>>  ssts;
-    ssts.push_back(SSTFile::writeAndCreate(data_dir_ / std::filesystem::path(memtable_name),
-        manifest_.getConfig().block_size,
-        ++sst_sequence_number, true,
-        memTable()->begin(), memTable()->end()));
-    auto* l = static_cast<IFileLevel*>(levels_[1].get());
-    l->addSST(std::move(ssts));
-    memTable()->clear();
-    mergeAsync(1, l->maxSeqNum()); // Merge the MemTable into Level 0
+void SimpleStorage::write(const WriteBatch& batch) {
+    if (batch.empty()) {
+        return;
+    }
+    for (const auto& op : batch.operations()) {
+        if (op.entry.type != ValueType::REMOVED) {
+            checkEntrySize(Utils::onDiskEntrySize(op.key, op.entry.value));
+        }
+    }
+    Writer writer;
+    writer.batch = &batch;
+    writeImpl(writer);
+}
+
+void SimpleStorage::writeImpl(Writer& writer) {
+    constexpr size_t MAX_GROUP_OPERATIONS = 4096;
+
+    std::unique_lock lock(writers_mutex_);
+    writers_.push_back(&writer);
+    writer.cv.wait(lock, [&] { return writer.done || writers_.front() == &writer; });
+    if (writer.done) {
+        // Applied by the leader
+        if (writer.error) {
+            std::rethrow_exception(writer.error);
+        }
+        return;
+    }
+    // We are the leader, take the queue
+    std::vector<Writer*> group;
+    size_t operations = 0;
+    for (auto* w : writers_) {
+        size_t count = w->batch ? w->batch->count() : 1;
+        if (!group.empty() && operations + count > MAX_GROUP_OPERATIONS) {
+            break;
+        }
+        group.push_back(w);
+        operations += count;
+    }
+    lock.unlock();
+
+    std::exception_ptr error;
+    try {
+        applyWriteGroup(group);
+    }
+    catch (...) {
+        error = std::current_exception();
+    }
+
+    lock.lock();
+    for (auto* w : group) {
+        writers_.pop_front();
+        if (w != &writer) {
+            w->error = error;
+            w->done = true;
+            w->cv.notify_one();
+        }
+    }
+    if (!writers_.empty()) {
+        writers_.front()->cv.notify_one(); // next leader
+    }
+    lock.unlock();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void SimpleStorage::applyWriteGroup(const std::vector<Writer*>& group) {
+    group_operations_.clear();
+    bool has_batch = false;
+    for (auto* w : group) {
+        if (w->batch) {
+            has_batch = true;
+            for (const auto& op : w->batch->operations()) {
+                group_operations_.push_back({ &op.key, &op.entry, op.expiration_ms });
+            }
+        }
+        else {
+            group_operations_.push_back({ w->key, w->entry, w->expiration_ms });
+        }
+    }
+
+    auto insert = [this](MemTable* memtable, uint64_t lsn) {
+        // Log sequence number orders concurrent writes of the same key as in the log
+        for (const auto& op : group_operations_) {
+            memtable->put(*op.key, *op.entry, op.expiration_ms, lsn);
+        }
+        return memtable->full();
+    };
+    // Cached rows of the written keys are dropped once the writes are visible
+    auto invalidateRows = [this] {
+        for (const auto& op : group_operations_) {
+            invalidateRow(*op.key);
+        }
+    };
+
+    uint64_t lsn;
+    bool full;
+    if (has_batch) {
+        // Exclusive lock keeps other writers away, readers don't see the batch until all of it is in the MemTable
+        std::unique_lock lock(readwrite_mutex_);
+        lsn = wal_.append(group_operations_);
+        auto* memtable = memTable();
+        memtable->setVisibleSeqNum(lsn - 1);
+        try {
+            full = insert(memtable, lsn);
+        }
+        catch (...) {
+            memtable->setVisibleSeqNum(std::numeric_limits<uint64_t>::max());
+            throw;
+        }
+        memtable->setVisibleSeqNum(std::numeric_limits<uint64_t>::max());
+        invalidateRows();
+        if (full) {
+            switchMemTable(lock);
+            full = false;
+        }
+    }
+    else {
+        // MemTable accepts concurrent writes, exclusive lock is needed only to switch it
+        std::shared_lock lock(readwrite_mutex_);
+        lsn = wal_.append(group_operations_);
+        full = insert(memTable(), lsn);
+        invalidateRows();
+    }
+    if (full) {
+        std::unique_lock lock(readwrite_mutex_);
+        if (memTable()->full()) { // might be switched by flush() already
+            switchMemTable(lock);
+        }
+    }
+    // One sync covers the whole group
+    wal_.sync(lsn);
+}
+
+void SimpleStorage::switchMemTable(std::unique_lock<std::shared_mutex>& lock) {
+    // Only one immutable MemTable at a time, stall writers until the previous one is flushed
+    flush_done_cv_.wait(lock, [this] { return !currentVersion()->immutable_memtable || flush_error_; });
+    if (flush_error_) {
+        std::rethrow_exception(flush_error_);
+    }
+    publishVersion([&](LevelsVersion& version) {
+        version.immutable_memtable = std::static_pointer_cast<MemTable>(version.levels[0]);
+        version.levels[0] = std::make_shared<MemTable>(manifest_.getConfig().memtable_size_bytes);
+        });
+    immutable_seq_num_ = ++sst_sequence_number;
+    immutable_wal_segment_ = wal_.rotate();
+    flush_requested_ = true;
+    flush_cv_.notify_one();
+}
+
+void SimpleStorage::flushLoop(std::stop_token stop_token) {
+    while (true) {
+        {
+            std::shared_lock lock(readwrite_mutex_);
+            flush_cv_.wait(lock, stop_token, [this] { return flush_requested_; });
+            if (stop_token.stop_requested()) {
+                return; // Immutable MemTable, if any, is still in the WAL
+            }
+        }
+        flushImmutableMemTable();
+    }
+}
+
+void SimpleStorage::flushImmutableMemTable() {
+    // Nobody modifies the immutable MemTable, safe to read without lock
+    uint64_t max_seq_num = 0;
+    uint64_t wal_segment = 0;
+    try {
+        std::shared_ptr<MemTable> immutable_memtable;
+        {
+            std::lock_guard lock(readwrite_mutex_);
+            flush_requested_ = false;
+            wal_segment = immutable_wal_segment_;
+            immutable_memtable = currentVersion()->immutable_memtable;
+        }
+        std::vector<std::unique_ptr<SSTFile>>  ssts;
+        ssts.push_back(SSTFile::writeAndCreate(data_dir_ / std::filesystem::path(memtable_name),
+            manifest_.getConfig().block_size,
+            immutable_seq_num_, true,
+            immutable_memtable->begin(), immutable_memtable->end(), sstOptions()));
+        if (wal_.syncMode() != WalSyncMode::NONE) {
+            // WAL segment is dropped below, SST must be on the disk before that
+            FileIO::syncFile(ssts.front()->path());
+        }
+        std::lock_guard lock(readwrite_mutex_);
+        publishVersion([&](LevelsVersion& version) {
+            auto& l = version.editFileLevel(1);
+            l.addSST(std::move(ssts));
+            version.immutable_memtable.reset();
+            max_seq_num = l.maxSeqNum();
+            });
+    }
+    catch (...) {
+        std::lock_guard lock(readwrite_mutex_);
+        flush_error_ = std::current_exception();
+        flush_done_cv_.notify_all();
+        return;
+    }
+    flush_done_cv_.notify_all();
+    wal_.removeSegments(wal_segment);
+    mergeAsync(1, max_seq_num); // Merge the MemTable into Level 0
 }
 
 void SimpleStorage::completeMerge() {
     std::lock_guard lock(readwrite_mutex_);
     MergeLog merge_log(data_dir_ / merge_log_name);
-    for (const auto& [level, sst_paths] : merge_log.filesToRegister()) {
-        std::vector<std::unique_ptr<SSTFile>>  to_merge;
-        auto* level_ptr = static_cast<IFileLevel*>(levels_[level].get());
-        for (const auto& sst_path : sst_paths) {
-            to_merge.push_back(SSTFile::readAndCreate(sst_path));
+    publishVersion([&](LevelsVersion& version) {
+        for (const auto& [level, sst_paths] : merge_log.filesToRegister()) {
+            std::vector<std::unique_ptr<SSTFile>>  to_merge;
+            for (const auto& sst_path : sst_paths) {
+                to_merge.push_back(SSTFile::readAndCreate(sst_path, sstOptions()));
+            }
+            version.editFileLevel(level).addSST(std::move(to_merge));
         }
-        level_ptr->addSST(std::move(to_merge));
-    }
+        });
 
     merge_log.removeFiles(); // Remove the merge log file after processing
 }
@@ -251,7 +615,17 @@ void SimpleStorage::mergeAsync(int level, uint64_t maxSeqNum) {
 }
 
 MemTable* SimpleStorage::memTable() {
-    return static_cast<MemTable*>(levels_[0].get());
+    // Switched only under exclusive readwrite_mutex_, callers hold it
+    return static_cast<MemTable*>(currentVersion()->levels[0].get());
+}
+
+SSTOptions SimpleStorage::sstOptions() const {
+    SSTOptions options;
+    options.bloom_bits_per_key = manifest_.getConfig().bloom_bits_per_key;
+    options.use_mmap = manifest_.getConfig().use_mmap;
+    options.use_io_uring = manifest_.getConfig().use_io_uring;
+    options.datablock_hash_index = manifest_.getConfig().datablock_hash_index;
+    return options;
 }
 
 void SimpleStorage::shrinkTimerLoop(std::stop_token stop_token) {
@@ -305,17 +679,13 @@ void SimpleStorage::workerLoop(std::stop_token stop_token) {
 }
 
 void SimpleStorage::handleMergeTask(const MergeTask& t) {
-    if (t.level <= 0 || t.level >= static_cast<int>(levels_.size()) - 1) {
+    auto num_levels = static_cast<int>(currentVersion()->levels.size());
+    if (t.level <= 0 || t.level >= num_levels - 1) {
         return; //We don't merge MemTable and the last level
     }
     int dst_level = t.level + 1;
-    auto* level = static_cast<IFileLevel*>(levels_[t.level].get());
-    auto* next_level = static_cast<IFileLevel*>(levels_[dst_level].get());
-    std::vector<std::filesystem::path> files_to_merge;
-    {
-        std::shared_lock lock(readwrite_mutex_);
-        files_to_merge = level->filelistToMerge(t.seq_num);
-    }
+    // Only this thread changes the levels below Level 0, flush only adds files to Level 0
+    auto files_to_merge = static_cast<const IFileLevel&>(*currentVersion()->levels[t.level]).filelistToMerge(t.seq_num);
     if (files_to_merge.empty()) {
         return; // Nothing to merge
     }
@@ -323,7 +693,9 @@ void SimpleStorage::handleMergeTask(const MergeTask& t) {
     MergeLog merge_log(data_dir_ / merge_log_name);
     uint64_t seq_num = 0;
     for (const auto& sst_path : files_to_merge) {
-        auto merge_result = next_level->mergeToTmp(sst_path, manifest_.getConfig().block_size);
+        auto version = currentVersion();
+        const auto& next_level = static_cast<const IFileLevel&>(*version->levels[dst_level]);
+        auto merge_result = next_level.mergeToTmp(sst_path, manifest_.getConfig().block_size, sstOptions());
         merge_log.addToRemove(sst_path);
         for (const auto& sst : merge_result.new_files) {
             merge_log.addToRegister(dst_level, sst->path());
@@ -334,42 +706,54 @@ void SimpleStorage::handleMergeTask(const MergeTask& t) {
         merge_log.commit();
         {
             std::lock_guard lock(readwrite_mutex_);
-            next_level->removeSSTs(merge_result.files_to_remove); // Remove merged SST file from the next level
-            next_level->addSST(std::move(merge_result.new_files));
-            level->removeSSTs({ sst_path });
-            seq_num = level->maxSeqNum(); // Get the maximum sequence number after merging
+            // Both levels change in one version, readers never see the data twice or not at all
+            publishVersion([&](LevelsVersion& next) {
+                auto& dst = next.editFileLevel(dst_level);
+                dst.removeSSTs(merge_result.files_to_remove); // Remove merged SST file from the next level
+                dst.addSST(std::move(merge_result.new_files));
+                auto& src = next.editFileLevel(t.level);
+                src.removeSSTs({ sst_path });
+                seq_num = src.maxSeqNum(); // Get the maximum sequence number after merging
+                });
         }
-        merge_log.removeFiles();
+        version.reset();
+        merge_log.complete(); // Removed files are deleted by their last reader
     }
-    if (dst_level < levels_.size() - 1) {
+    if (dst_level < num_levels - 1) {
         mergeAsync(dst_level, seq_num); // Schedule the next level merge if needed
     }
 }
 
 void SimpleStorage::handleRemoveSST(const RemoveSSTTask& t) {
     std::lock_guard lock(readwrite_mutex_);
-    for (int i = 1; i < levels_.size(); ++i) {
-        if (static_cast<IFileLevel*>(levels_[i].get())->remove(t.key, t.seq_num)) {
+    // Patches the removal flag in place, readers of older versions see the same files
+    auto version = currentVersion();
+    for (size_t i = 1; i < version->levels.size(); ++i) {
+        if (static_cast<IFileLevel*>(version->levels[i].get())->remove(t.key, t.seq_num)) {
+            invalidateRow(t.key);
             return;
         }
     }
 }
 
 void SimpleStorage::handleShrink(const ShrinkTask&) {
-    GeneralLevel* last_level = nullptr;
-    for (int i = levels_.size() - 1; i > 1; --i) {
-        if (static_cast<GeneralLevel*>(levels_[i].get())->count() == 0) {
+    auto version = currentVersion();
+    size_t last_level = 0;
+    for (size_t i = version->levels.size() - 1; i > 1; --i) {
+        if (static_cast<const GeneralLevel&>(*version->levels[i]).count() == 0) {
             continue; // Skip empty levels
         }
-        last_level = static_cast<GeneralLevel*>(levels_[i].get());
+        last_level = i;
     }
-    if (!last_level) {
+    if (last_level == 0) {
         return; // No levels to shrink
     }
-    auto merge_result = last_level->shrink(manifest_.getConfig().block_size);
+    auto merge_result = static_cast<const GeneralLevel&>(*version->levels[last_level]).shrink(
+        manifest_.getConfig().block_size, sstOptions());
+    version.reset();
     MergeLog merge_log(data_dir_ / merge_log_name);
     for (const auto& sst : merge_result.new_files) {
-        merge_log.addToRegister(levels_.size() - 1, sst->path());
+        merge_log.addToRegister(last_level, sst->path());
     }
     for (const auto& sst_path : merge_result.files_to_remove) {
         merge_log.addToRemove(sst_path);
@@ -377,10 +761,13 @@ void SimpleStorage::handleShrink(const ShrinkTask&) {
     merge_log.commit();
     {
         std::lock_guard lock(readwrite_mutex_);
-        last_level->removeSSTs(merge_result.files_to_remove);
-        last_level->addSST(std::move(merge_result.new_files));
+        publishVersion([&](LevelsVersion& next) {
+            auto& level = next.editFileLevel(last_level);
+            level.removeSSTs(merge_result.files_to_remove);
+            level.addSST(std::move(merge_result.new_files));
+            });
     }
-    merge_log.removeFiles();
+    merge_log.complete();
 }
 
 
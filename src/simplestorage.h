@@ -5,7 +5,13 @@
 #include "ilevel.h"
 #include "utils.h"
 #include "lockfile.h"
+#include "wal.h"
+#include "writebatch.h"
+#include "blockcache.h"
+#include "tablecache.h"
+#include "rowcache.h"
 
+#include <atomic>
 #include <string>
 #include <vector>
 #include <memory>
@@ -16,6 +22,9 @@
 #include <queue>
 #include <thread>
 #include <functional>
+#include <exception>
+#include <deque>
+#include <span>
 
 
 class MemTable;
@@ -50,16 +59,34 @@ public:
         if (key.size() > sst::datablock::MAX_KEY_LENGTH) {
             throw std::invalid_argument("Key size exceeds maximum allowed size");
         }
-        if (Utils::onDiskEntrySize(key, value) + sst::datablock::DATABLOCK_COUNT_SIZE > manifest_.getConfig().block_size) {
-            throw std::invalid_argument("Entry size exceeds maximum allowed size");
-        }
+        checkEntrySize(Utils::onDiskEntrySize(key, value));
         uint64_t expiration_ms = ttl_seconds.has_value() ?
             Utils::getNow() + ttl_seconds.value() * 1000ull :
             sst::datablock::EXPIRATION_NOT_SET;
         putImpl(key, Entry{ valueTypeFromType<T>(), value }, expiration_ms);
     }
 
+    // Applies all operations of the batch atomically
+    void write(const WriteBatch& batch);
+
     std::optional<Entry> get(const std::string& key) const;
+    // Value decoded straight from the stored bytes, without an Entry. Returns the same values as get(),
+    // an empty string or blob included. Throws std::invalid_argument if the key holds a value of another type.
+    template <AllSupportedTypes T>
+    std::optional<T> get(const std::string& key) const {
+        T value{};
+        if (!getInto(key, value)) {
+            return std::nullopt;
+        }
+        return value;
+    }
+    // Like get<T>() but decodes into `out`, strings and blobs reuse its buffer. False if the key does not exist.
+    template <AllSupportedTypes T>
+    bool getInto(const std::string& key, T& out) const {
+        return getRaw(key, [&out](const RawValue& raw) { Utils::deserializeValueInto(raw, out); });
+    }
+    // Results are in the order of the keys. Faster than get() in a loop, neighbouring keys share block reads.
+    std::vector<std::optional<Entry>> multiGet(std::span<const std::string> keys) const;
     bool removeAsync(const std::string& key);
     void remove(const std::string& key);
     bool exists(const std::string& key) const;
@@ -68,35 +95,115 @@ public:
     void forEachKeyWithPrefix(const std::string& prefix, const std::function<bool(const std::string&)>& callback) const;
 
     void clearCache();
+    // Counters of the process-wide block cache
+    BlockCache::Stats blockCacheStats() const;
+    // Counters of the process-wide cache of open SST files
+    TableCache::Stats tableCacheStats() const;
+    // Counters of the row cache of this storage, zeros if it is disabled
+    RowCache::Stats rowCacheStats() const;
     void flush();
     void shrink();
     void waitAllAsync();
 private:
+    // Caller of put/remove/write waiting in the writer queue
+    struct Writer {
+        const WriteBatch* batch = nullptr; // or the single operation below
+        const std::string* key = nullptr;
+        const Entry* entry = nullptr;
+        uint64_t expiration_ms = 0;
+        bool done = false;
+        std::exception_ptr error;
+        std::condition_variable cv;
+    };
+
     void putImpl(const std::string& key, const Entry& entry, uint64_t ttl);
-    void flushImpl();
+    // Throws if a block with the entry alone (its count and hash index included) exceeds the block size
+    void checkEntrySize(uint64_t entry_size) const;
+    // Calls the callback with the value of an existing key, false if there is none. Uses the row cache if enabled.
+    bool getRaw(const std::string& key, const RawValueCallback& callback) const;
+    bool readRaw(const std::string& key, const RawValueCallback& callback) const;
+    // Called once the change of the key is visible to readers
+    void invalidateRow(const std::string& key) {
+        if (row_cache_) {
+            row_cache_->invalidate(key);
+        }
+    }
+    void writeImpl(Writer& writer);
+    void applyWriteGroup(const std::vector<Writer*>& group);
+    // Immutable snapshot of the levels: levels[0] is the MemTable, levels[1] Level 0 and so on.
+    // Readers take the current version without locks and keep it alive while they read, changes
+    // are published as a new version. SST files dropped by a version are deleted from the disk
+    // once the last version using them is released.
+    struct LevelsVersion {
+        std::vector<std::shared_ptr<ILevel>> levels;
+        // Full MemTable waiting for the flush thread, still visible to readers until published in Level 0
+        std::shared_ptr<MemTable> immutable_memtable;
+
+        // Replaces the file level with a copy which may be changed until the version is published
+        IFileLevel& editFileLevel(size_t level);
+    };
+
+    std::shared_ptr<const LevelsVersion> currentVersion() const {
+        return version_.load(std::memory_order_acquire);
+    }
+    // Publishes a copy of the current version changed by func, the caller holds readwrite_mutex_ exclusively
+    template <typename Func>
+    void publishVersion(Func&& func);
+    void switchMemTable(std::unique_lock<std::shared_mutex>& lock);
+    void flushLoop(std::stop_token stop_token);
+    void flushImmutableMemTable();
+    template <typename Func>
+    static bool forEachLevel(const LevelsVersion& version, Func&& func);
     void completeMerge();
     void removeAllTemporaryFiles();
     void mergeAsync(int level, uint64_t maxSeqNum);
     MemTable* memTable();
+    SSTOptions sstOptions() const;
     void shrinkTimerLoop(std::stop_token stop_token);
     void workerLoop(std::stop_token stop_token);
     void handleMergeTask(const MergeTask&);
     void handleRemoveSST(const RemoveSSTTask&);
     void handleShrink(const ShrinkTask&);
-    std::vector<std::unique_ptr<ILevel>> levels_;
+
+    // Counts the open storages of the process. The storage opened while no other one is open sets
+    // the capacities of the process-wide caches, storages opened next to it don't change them.
+    class OpenStorage {
+    public:
+        explicit OpenStorage(const Config& config);
+        ~OpenStorage();
+        OpenStorage(const OpenStorage&) = delete;
+        OpenStorage& operator=(const OpenStorage&) = delete;
+    };
+
+    std::atomic<std::shared_ptr<const LevelsVersion>> version_;
+    std::unique_ptr<RowCache> row_cache_; // null if Config::row_cache_size_bytes is 0
+    uint64_t immutable_seq_num_ = 0;
+    uint64_t immutable_wal_segment_ = 0;
+    bool flush_requested_ = false;
+    std::exception_ptr flush_error_;
     Manifest manifest_;
+    OpenStorage open_storage_;
     std::filesystem::path data_dir_;
-    mutable std::shared_mutex readwrite_mutex_; 
+    // Taken by writers and background work, readers use the current version without it
+    mutable std::shared_mutex readwrite_mutex_;
     mutable std::mutex queue_mutex_; 
     mutable std::mutex shrink_mutex_;
     std::condition_variable queue_cv_;
     std::condition_variable queue_empty_cv_;
     std::condition_variable_any shrink_cv_;
+    std::condition_variable_any flush_cv_;
+    std::condition_variable_any flush_done_cv_;
+    // Leader/follower writer queue, the writer in front applies the writes of the whole queue
+    std::mutex writers_mutex_;
+    std::deque<Writer*> writers_;
+    std::vector<WriteAheadLog::Operation> group_operations_; // used by the leader only
 
     std::queue<StorageTask> task_queue_;
     std::jthread worker_thread_;
     std::jthread shrink_timer_thread_;
     StorageLockFile lock_file_;
+    WriteAheadLog wal_; // opened after the lock file is acquired
+    std::jthread flush_thread_;
 
     static uint64_t sst_sequence_number;
 };
@@ -20,9 +20,14 @@ std::vector<uint8_t> IndexBlockBuilder::build() {
     return ret;
 }
 
-SSTBuilder::SSTBuilder(const std::filesystem::path& path, uint32_t max_datablock_size, uint64_t seq_num)
-    : index_block_builder_(), data_block_builder_(max_datablock_size),
+SSTBuilder::SSTBuilder(const std::filesystem::path& path, uint32_t max_datablock_size, uint64_t seq_num,
+    const SSTOptions& options)
+    : index_block_builder_(), data_block_builder_(max_datablock_size, options.format_version, options.datablock_hash_index), options_(options),
+    filter_builder_(options.bloom_bits_per_key), max_partition_size_(max_datablock_size),
     ofs_(path, std::ios::binary), path_(path), seq_num_(seq_num) {
+    if (options.format_version < sst::header::SST_VERSION_FILTER || options.format_version > sst::header::SST_VERSION) {
+        throw std::invalid_argument("Unsupported SST version for writing: " + std::to_string(options.format_version));
+    }
     if (!ofs_) {
         throw std::runtime_error("Failed to open SST file for writing: " +
             path.string());
@@ -30,65 +35,199 @@ SSTBuilder::SSTBuilder(const std::filesystem::path& path, uint32_t max_datablock
 }
 
 uint64_t SSTBuilder::currentSize() {
-    return static_cast<uint64_t>(ofs_.tellp()) + data_block_builder_.size() + index_block_builder_.size();
+    // The top-level index of the partitions is small, it is not counted
+    uint64_t index_size = partitionedIndex() ? partitions_.size() + partition_builder_.size()
+        : index_block_builder_.size();
+    return static_cast<uint64_t>(ofs_.tellp()) + data_block_builder_.size() + index_size;
 }
 
 void SSTBuilder::writeHeader(uint64_t seq_num) {
     ofs_.write(sst::header::SST_SIGNATURE, sst::header::SST_SIGNATURE_SIZE);
-    ofs_ << sst::header::SST_VERSION;
+    ofs_ << options_.format_version;
     std::vector<uint8_t> sequence_buf;
     Utils::serializeLE(seq_num, sequence_buf);
     ofs_.write(reinterpret_cast<const char*>(sequence_buf.data()), sequence_buf.size());
 }
 
+void SSTBuilder::write(const std::vector<uint8_t>& data) {
+    ofs_.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
 void SSTBuilder::addEntry(const std::string& key, const Entry& entry, uint64_t expiration_ms) {
-    last_key_ = key;
-    if (inmemory_index_block_.empty()) {
+    if (options_.bloom_bits_per_key > 0) {
+        filter_builder_.addKey(key);
+    }
+    if (num_blocks_ == 0) {
         writeHeader(seq_num_);
-        index_block_builder_.addKey(key, ofs_.tellp());
-        inmemory_index_block_.push_back({ key, ofs_.tellp() });
+        first_key_ = key;
     }
+    bool new_block = data_block_builder_.empty();
     if (!data_block_builder_.addEntry(key, entry, expiration_ms)) {
-        auto datablock_data = data_block_builder_.build();
-        ofs_.write(reinterpret_cast<const char*>(datablock_data.data()),
-            datablock_data.size());
-        index_block_builder_.addKey(key, ofs_.tellp());
-        inmemory_index_block_.push_back({ key, ofs_.tellp() });
-
+        flushDatablock();
+        new_block = true;
         // add current value to new datablock
         if (!data_block_builder_.addEntry(key, entry, expiration_ms)) {
             throw std::runtime_error("Failed to add entry even after flushing DataBlock (entry too large?)");
         }
     }
+    if (new_block) {
+        // The block is written at the current position once it is full
+        addIndexKey(key);
+    }
+    last_key_ = key;
+    ++num_entries_;
 }
 
-std::unique_ptr<SSTFile> SSTBuilder::finalize() {
+void SSTBuilder::addIndexKey(const std::string& min_key) {
+    // Any key after the last key of the previous block and up to min_key separates the blocks,
+    // the shortest one keeps the index small. The first key of the file stays whole.
+    auto key = num_blocks_ == 0 ? min_key : Utils::shortestSeparator(last_key_, min_key);
+    ++num_blocks_;
+    if (!partitionedIndex()) {
+        index_block_builder_.addKey(key, ofs_.tellp());
+        top_index_builder_.addKey(key, ofs_.tellp());
+        return;
+    }
+    if (partition_builder_.size() >= max_partition_size_) {
+        flushIndexPartition(ofs_.tellp()); // the previous block is written already
+    }
+    if (partition_builder_.empty()) {
+        partition_min_key_ = key;
+    }
+    partition_builder_.addKey(key, ofs_.tellp());
+}
+
+void SSTBuilder::flushIndexPartition(iblock::OffsetFieldType end_offset) {
+    partition_index_.emplace_back(partition_min_key_, partitions_.size());
+    auto partition = partition_builder_.build(end_offset);
+    partitions_.insert(partitions_.end(), partition.begin(), partition.end());
+}
+
+void SSTBuilder::flushDatablock() {
     if (!data_block_builder_.empty()) {
-        auto datablock_data = data_block_builder_.build();
-        ofs_.write(reinterpret_cast<const char*>(datablock_data.data()),
-            datablock_data.size());
+        write(data_block_builder_.build());
     }
-    auto indexblock_data = index_block_builder_.build();
-    size_t index_block_offset = ofs_.tellp();
-    if (index_block_offset == 0) {
+}
+
+std::unique_ptr<SSTFile> SSTBuilder::finalize() {
+    flushDatablock();
+    if (num_blocks_ == 0) {
         // If no data was written, we can't create a valid SST file
         ofs_.close();
         std::filesystem::remove(path_);
         return nullptr;
     }
-    ofs_.write(reinterpret_cast<const char*>(indexblock_data.data()),
-        indexblock_data.size());
-    return std::unique_ptr<SSTFile>(new SSTFile(path_, index_block_offset, seq_num_, last_key_, inmemory_index_block_));
+    iblock::OffsetFieldType index_block_offset = ofs_.tellp();
+    std::vector<uint8_t> top_index;
+    bool partitioned = false;
+    if (!partitionedIndex()) {
+        // [IndexBlock][IndexBlockSize]
+        write(index_block_builder_.build());
+        top_index = top_index_builder_.build(index_block_offset);
+    }
+    else {
+        // [Partitions][TopLevelIndex]. An index of one partition is small enough to stay in memory,
+        // it points at the DataBlocks directly.
+        partitioned = !partition_index_.empty();
+        if (partitioned) {
+            flushIndexPartition(index_block_offset);
+            write(partitions_);
+            for (const auto& [min_key, position] : partition_index_) {
+                top_index_builder_.addKey(min_key, index_block_offset + position);
+            }
+            index_block_offset = ofs_.tellp();
+            top_index = top_index_builder_.build(index_block_offset);
+        }
+        else {
+            top_index = partition_builder_.build(index_block_offset);
+        }
+        write(top_index);
+        if (!hasFooter()) {
+            // [IndexLevels][TopLevelIndexSize]
+            std::vector<uint8_t> index_trailer;
+            Utils::serializeLE(partitioned ? iblock::TWO_LEVEL_INDEX : iblock::SINGLE_LEVEL_INDEX, index_trailer);
+            Utils::serializeLE(static_cast<iblock::CountFieldType>(top_index.size()), index_trailer);
+            write(index_trailer);
+        }
+    }
+    // Filter block follows the index block: [Filter][FilterSize], the footer holds the size since SST_VERSION_FOOTER
+    std::vector<uint8_t> filter_data;
+    if (!filter_builder_.empty()) {
+        filter_data = filter_builder_.build();
+    }
+    uint64_t filter_offset = ofs_.tellp();
+    write(filter_data);
+    SSTProperties properties{ num_entries_, num_blocks_ };
+    if (hasFooter()) {
+        writePropertiesAndFooter(properties, index_block_offset, top_index.size(), partitioned,
+            filter_offset, filter_data.size());
+    }
+    else {
+        std::vector<uint8_t> filter_size;
+        Utils::serializeLE(static_cast<sst::filter::FilterSizeFieldType>(filter_data.size()), filter_size);
+        write(filter_size);
+    }
+    ofs_.close(); // The file is complete, readers may open or map it
+    if (!ofs_) {
+        throw std::runtime_error("Failed to write SST file: " + path_.string());
+    }
+    return std::unique_ptr<SSTFile>(new SSTFile(path_, seq_num_, last_key_, IndexPartition(std::move(top_index)), partitioned,
+        BloomFilter(std::move(filter_data)), options_.format_version, options_,
+        hasFooter() ? std::optional(properties) : std::nullopt));
 }
 
-void SSTBuilder::addDatablock(const std::string& min_key, const std::vector<uint8_t>& data,
-    const std::string& max_key)
+void SSTBuilder::writePropertiesAndFooter(const SSTProperties& properties, uint64_t index_offset, uint64_t index_size,
+    bool partitioned, uint64_t filter_offset, uint64_t filter_size) {
+    namespace footer = sst::footer;
+    // Properties: [NumEntries][NumDataBlocks][MaxKeyLen][MaxKey][MinKeyLen][MinKey], MinKey since SST_VERSION_KEY_RANGE
+    uint64_t properties_offset = ofs_.tellp();
+    std::vector<uint8_t> data;
+    Utils::serializeLE(static_cast<footer::NumEntriesFieldType>(properties.num_entries), data);
+    Utils::serializeLE(static_cast<footer::NumBlocksFieldType>(properties.num_datablocks), data);
+    Utils::serializeLE(static_cast<sst::datablock::KeyLengthFieldType>(last_key_.size()), data);
+    data.insert(data.end(), last_key_.begin(), last_key_.end());
+    if (options_.format_version >= sst::header::SST_VERSION_KEY_RANGE) {
+        Utils::serializeLE(static_cast<sst::datablock::KeyLengthFieldType>(first_key_.size()), data);
+        data.insert(data.end(), first_key_.begin(), first_key_.end());
+    }
+    auto properties_size = data.size();
+    // Footer: [IndexOffset][IndexSize][IndexLevels][FilterOffset][FilterSize][PropertiesOffset][PropertiesSize][Version][Signature]
+    auto addHandle = [&](uint64_t offset, uint64_t size) {
+        Utils::serializeLE(static_cast<footer::BlockOffsetFieldType>(offset), data);
+        Utils::serializeLE(static_cast<footer::BlockSizeFieldType>(size), data);
+    };
+    addHandle(index_offset, index_size);
+    Utils::serializeLE(partitioned ? iblock::TWO_LEVEL_INDEX : iblock::SINGLE_LEVEL_INDEX, data);
+    addHandle(filter_offset, filter_size);
+    addHandle(properties_offset, properties_size);
+    data.push_back(options_.format_version);
+    data.insert(data.end(), sst::header::SST_SIGNATURE, sst::header::SST_SIGNATURE + sst::header::SST_SIGNATURE_SIZE);
+    write(data);
+}
+
+void SSTBuilder::addDatablock(const DataBlock& block)
 {
-    last_key_ = max_key;
-    if (inmemory_index_block_.empty()) {
+    if (block.version() != options_.format_version) {
+        // Blocks of older files are re-encoded in the format of this file
+        for (sst::datablock::CountFieldType i = 0; i < block.count(); ++i) {
+            auto [key, value] = block.get(i);
+            addEntry(key, value.entry, value.expiration_ms);
+        }
+        return;
+    }
+    flushDatablock();
+    if (num_blocks_ == 0) {
         writeHeader(seq_num_);
+        first_key_ = block.keyAt(0);
     }
-    index_block_builder_.addKey(min_key, ofs_.tellp());
-    inmemory_index_block_.push_back({ min_key, ofs_.tellp() });
+    addIndexKey(block.keyAt(0));
+    last_key_ = block.keyAt(block.count() - 1);
+    num_entries_ += block.count();
+    auto data = block.data();
     ofs_.write(reinterpret_cast<const char*>(data.data()), data.size());
+    if (options_.bloom_bits_per_key > 0) {
+        block.forEachKey([&](std::string_view key) {
+            filter_builder_.addKey(key);
+            });
+    }
 }
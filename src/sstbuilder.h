@@ -3,6 +3,8 @@
 #include "types.h"
 #include "datablock.h"
 #include "utils.h"
+#include "bloomfilter.h"
+#include "indexpartition.h"
 #include <filesystem>
 #include <fstream>
 #include <memory>
@@ -11,6 +13,23 @@
 #include <vector>
 
 class SSTFile;
+
+// Options of written and opened SST files
+struct SSTOptions {
+    uint32_t bloom_bits_per_key = sst::filter::DEFAULT_BITS_PER_KEY; // 0 - no filter
+    bool use_mmap = false; // read blocks from a file mapping instead of the block cache
+    bool use_io_uring = true; // batch block reads of multiGet and prefix scans, pread if unavailable
+    uint8_t format_version = sst::header::SST_VERSION; // SST_VERSION_FILTER or newer
+    bool datablock_hash_index = false; // hash index of point lookups in each written DataBlock
+};
+
+// Statistics of an SST file, stored in its properties block (since SST_VERSION_FOOTER)
+struct SSTProperties {
+    uint64_t num_entries = 0; // including removed ones
+    uint64_t num_datablocks = 0;
+};
+
+// Single-level index of files older than SST_VERSION_PARTITIONED
 class IndexBlockBuilder {
 public:
     IndexBlockBuilder() = default;
@@ -27,20 +46,50 @@ private:
 
 class SSTBuilder {
 public:
-    SSTBuilder(const std::filesystem::path& path, uint32_t max_datablock_size, uint64_t seq_num);
+    SSTBuilder(const std::filesystem::path& path, uint32_t max_datablock_size, uint64_t seq_num,
+        const SSTOptions& options = {});
     uint64_t currentSize();
     void addEntry(const std::string& key, const Entry& entry, uint64_t expiration_ms);
-    void addDatablock(const std::string& min_key, const std::vector<uint8_t>& data,
-        const std::string& max_key);
+    // Copies a block of the same format as is, older blocks are re-encoded
+    void addDatablock(const DataBlock& block);
     std::unique_ptr<SSTFile> finalize();
 
 private:
     void writeHeader(uint64_t seq_num);
+    // Writes the pending entries as a DataBlock
+    void flushDatablock();
+    bool partitionedIndex() const noexcept {
+        return options_.format_version >= sst::header::SST_VERSION_PARTITIONED;
+    }
+    bool hasFooter() const noexcept {
+        return options_.format_version >= sst::header::SST_VERSION_FOOTER;
+    }
+    // Adds the block starting at the current position to the index, before last_key_ moves to it
+    void addIndexKey(const std::string& min_key);
+    // Completes the pending index partition, its last block ends at end_offset
+    void flushIndexPartition(sst::indexblock::OffsetFieldType end_offset);
+    void write(const std::vector<uint8_t>& data);
+    // [Properties][Footer] at the end of files of SST_VERSION_FOOTER or newer
+    void writePropertiesAndFooter(const SSTProperties& properties, uint64_t index_offset, uint64_t index_size,
+        bool partitioned, uint64_t filter_offset, uint64_t filter_size);
+
     IndexBlockBuilder index_block_builder_;
     DataBlockBuilder data_block_builder_;
-    std::vector<std::pair<std::string, sst::indexblock::OffsetFieldType>> inmemory_index_block_;
+    SSTOptions options_;
+    BloomFilterBuilder filter_builder_;
+    uint32_t max_partition_size_; // index partitions are about as large as DataBlocks
+    IndexPartitionBuilder partition_builder_;
+    std::string partition_min_key_;
+    // Complete partitions, written after the DataBlocks
+    std::vector<uint8_t> partitions_;
+    std::vector<std::pair<std::string, sst::indexblock::OffsetFieldType>> partition_index_; // min key, position in partitions_
+    // In older formats the in-memory copy of the index block
+    IndexPartitionBuilder top_index_builder_;
+    uint64_t num_blocks_ = 0;
+    uint64_t num_entries_ = 0;
     std::ofstream ofs_;
     std::filesystem::path path_;
     uint64_t seq_num_;
+    std::string first_key_;
     std::string last_key_; // Used to track the last key added to the SST
 };
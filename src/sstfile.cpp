@@ -1,249 +1,659 @@
 #include "sstfile.h"
 #include "utils.h"
+#include <algorithm>
 #include <array>
+#include <cstdint>
 namespace iblock = sst::indexblock;
-int SSTFile::max_cached_files_ = 10; // Maximum number of cached datablocks
 
-SSTFile::SSTFile(const std::filesystem::path& path, sst::indexblock::OffsetFieldType index_block_offset,
-    uint64_t seq_num, const std::string max_key,
-    std::vector <std::pair<std::string, iblock::OffsetFieldType>> index_block) :
-    path_(path), index_block_offset_(index_block_offset), index_block_(std::move(index_block)), seq_num_(seq_num), max_key_(max_key) {}
+namespace {
+    struct FooterHandle {
+        uint64_t offset;
+        uint64_t size;
+    };
+    struct Footer {
+        FooterHandle index;
+        iblock::IndexLevelsFieldType levels;
+        FooterHandle filter;
+        FooterHandle properties;
+    };
+
+    // Parses the footer at `pos`, the blocks must end before meta_end
+    Footer parseFooter(const uint8_t* pos, uint64_t meta_end, uint8_t version, const std::filesystem::path& path) {
+        namespace footer = sst::footer;
+        // [IndexOffset][IndexSize][IndexLevels][FilterOffset][FilterSize][PropertiesOffset][PropertiesSize][Version][Signature]
+        auto readHandle = [&]() {
+            FooterHandle handle;
+            handle.offset = Utils::deserializeLE<footer::BlockOffsetFieldType>(pos);
+            handle.size = Utils::deserializeLE<footer::BlockSizeFieldType>(pos + footer::BLOCK_OFFSET_SIZE);
+            pos += footer::BLOCK_HANDLE_SIZE;
+            if (handle.offset < sst::header::SST_HEADER_SIZE || handle.offset > meta_end || handle.size > meta_end - handle.offset)
+                throw std::runtime_error("SST footer corrupted: Block is out of file bounds: " + path.string());
+            return handle;
+        };
+        Footer result;
+        result.index = readHandle();
+        result.levels = Utils::deserializeLE<iblock::IndexLevelsFieldType>(pos);
+        pos += iblock::INDEX_LEVELS_SIZE;
+        result.filter = readHandle();
+        result.properties = readHandle();
+        auto footer_version = *pos++;
+        if (std::string_view(reinterpret_cast<const char*>(pos), sst::header::SST_SIGNATURE_SIZE) != sst::header::SST_SIGNATURE)
+            throw std::runtime_error("SST footer corrupted: Invalid signature: " + path.string());
+        if (footer_version != version)
+            throw std::runtime_error("SST footer corrupted: Version differs from the header: " + path.string());
+        if (result.levels != iblock::SINGLE_LEVEL_INDEX && result.levels != iblock::TWO_LEVEL_INDEX)
+            throw std::runtime_error("Invalid number of index levels: " + std::to_string(result.levels));
+        return result;
+    }
+
+    struct Properties {
+        SSTProperties properties;
+        std::string_view max_key;
+        std::string_view min_key; // empty before SST_VERSION_KEY_RANGE
+    };
+
+    // [NumEntries][NumDataBlocks][MaxKeyLen][MaxKey][MinKeyLen][MinKey], the views point into data
+    Properties parseProperties(std::span<const uint8_t> data, uint8_t version, const std::filesystem::path& path) {
+        namespace footer = sst::footer;
+        constexpr size_t fixed_size = sizeof(footer::NumEntriesFieldType) + sizeof(footer::NumBlocksFieldType);
+        auto readKey = [&](size_t pos) {
+            if (pos + sst::datablock::KEY_LEN_SIZE > data.size())
+                throw std::runtime_error("SST properties block corrupted: " + path.string());
+            auto len = Utils::deserializeLE<sst::datablock::KeyLengthFieldType>(data.data() + pos);
+            if (len == 0 || pos + sst::datablock::KEY_LEN_SIZE + len > data.size())
+                throw std::runtime_error("SST properties block corrupted: Invalid key length: " + path.string());
+            return std::string_view(reinterpret_cast<const char*>(data.data() + pos + sst::datablock::KEY_LEN_SIZE), len);
+        };
+        if (data.size() < fixed_size)
+            throw std::runtime_error("SST properties block corrupted: " + path.string());
+        Properties result;
+        result.properties.num_entries = Utils::deserializeLE<footer::NumEntriesFieldType>(data.data());
+        result.properties.num_datablocks = Utils::deserializeLE<footer::NumBlocksFieldType>(data.data() + sizeof(footer::NumEntriesFieldType));
+        result.max_key = readKey(fixed_size);
+        if (version >= sst::header::SST_VERSION_KEY_RANGE) {
+            result.min_key = readKey(fixed_size + sst::datablock::KEY_LEN_SIZE + result.max_key.size());
+        }
+        return result;
+    }
+}
+
+SSTFile::SSTFile(const std::filesystem::path& path, uint64_t seq_num, const std::string max_key,
+    IndexPartition top_index, bool partitioned_index, BloomFilter filter, uint8_t version, const SSTOptions& options,
+    std::optional<SSTProperties> properties) :
+    path_(path), top_index_(std::move(top_index)), partitioned_index_(partitioned_index), seq_num_(seq_num), max_key_(max_key),
+    key_range_loaded_(!top_index_.empty()), filter_(std::move(filter)), properties_(properties), version_(version),
+    file_id_(BlockCache::newFileId()), use_mmap_(options.use_mmap), use_io_uring_(options.use_io_uring) {
+    if (key_range_loaded_) {
+        min_key_ = top_index_.key(0); // the first index key is the whole first key of the file
+    }
+}
+
+SSTFile::~SSTFile() {
+    BlockCache::instance().eraseFile(file_id_);
+    TableCache::instance().erase(file_id_);
+    if (obsolete_.load(std::memory_order_acquire)) {
+        std::error_code ec; // a leftover is removed with the merge log on the next start
+        std::filesystem::remove(path_, ec);
+    }
+}
+
+std::shared_ptr<RandomAccessFile> SSTFile::openFile() const {
+    // Reads go through the descriptor without a lock, it stays open until the read is done
+    return TableCache::instance().open(file_id_, path_);
+}
+
+std::shared_ptr<const MappedFile> SSTFile::mapFile() const {
+    std::lock_guard lock(file_mutex_);
+    if (!mapping_) {
+        try {
+            mapping_ = std::make_shared<const MappedFile>(path_);
+        }
+        catch (const std::exception&) {
+            return nullptr;
+        }
+    }
+    return mapping_;
+}
+
+std::shared_ptr<const uint8_t> SSTFile::readBlock(iblock::OffsetFieldType block_offset, iblock::OffsetFieldType block_size) const {
+    if (use_mmap_) {
+        // Parsed in place, the block keeps the mapping alive
+        auto mapping = mapFile();
+        if (!mapping || block_offset + block_size > mapping->size()) {
+            return nullptr;
+        }
+        return std::shared_ptr<const uint8_t>(mapping, mapping->data() + block_offset);
+    }
+    auto& cache = BlockCache::instance();
+    if (auto block = cache.lookup(file_id_, block_offset)) {
+        return std::shared_ptr<const uint8_t>(block, block->data());
+    }
+    // Concurrent readers of the same file don't wait for each other, a block missed by
+    // several readers at once may be read more than once
+    auto file = openFile();
+    if (!file) {
+        return nullptr;
+    }
+    auto data = std::make_shared<std::vector<uint8_t>>(block_size);
+    std::shared_lock lock(write_mutex_);
+    if (file->read(block_offset, data->data(), block_size) != block_size) {
+        return nullptr;
+    }
+    auto block = cache.insertIfAbsent(file_id_, block_offset, std::move(data));
+    return std::shared_ptr<const uint8_t>(block, block->data());
+}
 
-void SSTFile::openIfNeeded() const {
-    if (!ifs_.is_open()) {
-        ifs_.open(path_, std::ios::binary);
+std::optional<DataBlock> SSTFile::readDatablock(const BlockHandle& handle) const {
+    auto data = readBlock(handle.offset, handle.size);
+    if (!data) {
+        return std::nullopt;
     }
+    return DataBlock(std::move(data), handle.size, version_);
 }
 
-std::vector<uint8_t> SSTFile::readDatablock(iblock::OffsetFieldType block_offset, iblock::OffsetFieldType block_size) const {
-    // SSTFile is not thread-safe, but this is const operation so it can be called concurrently
-    std::lock_guard lock(cache_mutex_);
-    if (datablock_cache_.find(block_offset) != datablock_cache_.end()) {
-        return datablock_cache_[block_offset];
+std::optional<IndexPartition> SSTFile::readPartition(iblock::CountFieldType partition_idx) const {
+    auto offset = top_index_.offset(partition_idx);
+    auto size = top_index_.blockSize(partition_idx);
+    auto data = readBlock(offset, size);
+    if (!data) {
+        return std::nullopt;
     }
-    if (datablock_cache_.size() >= max_cached_files_) {
-        // Remove random cached block if we exceed the limit
-        datablock_cache_.erase(datablock_cache_.begin());
+    return IndexPartition(std::move(data), size);
+}
+
+SSTFile::IndexCursor SSTFile::seekBlock(std::string_view key) const {
+    IndexCursor cursor;
+    if (!partitioned_index_) {
+        cursor.partition = top_index_;
+        cursor.idx = top_index_.find(key);
+        return cursor;
+    }
+    cursor.partition_idx = top_index_.find(key);
+    if (cursor.partition_idx >= top_index_.count()) {
+        return cursor;
+    }
+    auto partition = readPartition(cursor.partition_idx);
+    if (!partition) {
+        return cursor;
+    }
+    cursor.partition = std::move(*partition);
+    // Partitions start with the min key of their first block, the key is not before it
+    cursor.idx = cursor.partition.find(key);
+    return cursor;
+}
+
+SSTFile::IndexCursor SSTFile::firstBlock() const {
+    ensureIndexLoaded(); // iterators start here
+    IndexCursor cursor;
+    if (top_index_.empty()) {
+        return cursor;
     }
-    openIfNeeded();
-    if (!ifs_) {
-        return {};
+    if (!partitioned_index_) {
+        cursor.partition = top_index_;
+        return cursor;
     }
-    ifs_.seekg(block_offset, std::ios::beg);
-    std::vector<uint8_t> data(block_size);
-    ifs_.read(reinterpret_cast<char*>(data.data()), block_size);
-    if (ifs_.gcount() != block_size) {
-        return {};
+    auto partition = readPartition(0);
+    if (!partition) {
+        throw std::runtime_error("Failed to read index partition from SST file: " + path_.string());
     }
-    datablock_cache_[block_offset] = std::move(data);
-    return datablock_cache_[block_offset];
+    cursor.partition = std::move(*partition);
+    return cursor;
 }
 
-std::vector<uint8_t> SSTFile::readDatablock(const std::filesystem::path path, sst::indexblock::OffsetFieldType block_offset, sst::indexblock::OffsetFieldType block_size)
-{
-    std::vector<uint8_t> ret;
-    std::ifstream ifs(path, std::ios::binary);
-    if (!ifs) {
-        return ret;
+SSTFile::IndexCursor SSTFile::lastBlock() const {
+    IndexCursor cursor;
+    if (top_index_.empty()) {
+        return cursor;
     }
-    ifs.seekg(block_offset, std::ios::beg);
-    ret.resize(block_size);
-    ifs.read(reinterpret_cast<char*>(ret.data()), block_size);
-    if (ifs.gcount() != block_size) {
-        return ret;
+    if (!partitioned_index_) {
+        cursor.partition = top_index_;
     }
-    return ret;
+    else {
+        cursor.partition_idx = top_index_.count() - 1;
+        auto partition = readPartition(cursor.partition_idx);
+        if (!partition) {
+            throw std::runtime_error("Failed to read index partition from SST file: " + path_.string());
+        }
+        cursor.partition = std::move(*partition);
+    }
+    cursor.idx = cursor.partition.count() - 1;
+    return cursor;
+}
+
+void SSTFile::nextBlock(IndexCursor& cursor) const {
+    ++cursor.idx;
+    if (cursor.idx < cursor.partition.count() || !partitioned_index_ ||
+        cursor.partition_idx + 1 >= top_index_.count()) {
+        return;
+    }
+    auto partition = readPartition(++cursor.partition_idx);
+    if (!partition) {
+        throw std::runtime_error("Failed to read index partition from SST file: " + path_.string());
+    }
+    cursor.partition = std::move(*partition);
+    cursor.idx = 0;
+}
+
+DataBlock SSTFile::readExistingDatablock(const BlockHandle& handle) const {
+    auto block = readDatablock(handle);
+    if (!block) {
+        throw std::runtime_error("Failed to read DataBlock from SST file: " + path_.string());
+    }
+    return std::move(*block);
+}
+
+std::vector<std::optional<DataBlock>> SSTFile::readDatablocks(std::span<const BlockHandle> blocks) const {
+    std::vector<std::optional<DataBlock>> result(blocks.size());
+    if (use_mmap_ || blocks.size() == 1) {
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            result[i] = readDatablock(blocks[i]);
+        }
+        return result;
+    }
+    auto& cache = BlockCache::instance();
+    std::vector<size_t> missed;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (auto block = cache.lookup(file_id_, blocks[i].offset)) {
+            result[i] = DataBlock(std::move(block), version_);
+        }
+        else {
+            missed.push_back(i);
+        }
+    }
+    if (missed.empty()) {
+        return result;
+    }
+    auto file = openFile();
+    if (!file) {
+        return result;
+    }
+    std::vector<std::shared_ptr<std::vector<uint8_t>>> buffers;
+    std::vector<ReadRequest> requests;
+    buffers.reserve(missed.size());
+    requests.reserve(missed.size());
+    for (auto i : missed) {
+        auto& buffer = buffers.emplace_back(std::make_shared<std::vector<uint8_t>>(blocks[i].size));
+        requests.push_back(ReadRequest{ file.get(), blocks[i].offset, buffer->data(), buffer->size() });
+    }
+    std::shared_lock lock(write_mutex_);
+    FileIO::readBatch(requests, use_io_uring_);
+    for (size_t j = 0; j < missed.size(); ++j) {
+        if (requests[j].bytes_read != requests[j].size) {
+            continue;
+        }
+        result[missed[j]] = DataBlock(cache.insertIfAbsent(file_id_, requests[j].offset, std::move(buffers[j])), version_);
+    }
+    return result;
 }
 
 void SSTFile::writeDatablock(const DataBlock& block, sst::indexblock::OffsetFieldType offsetIndex) const {
-    datablock_cache_[offsetIndex] = block.data();
+    std::unique_lock lock(write_mutex_);
     std::fstream ofs(path_, std::ios::in | std::ios::out | std::ios::binary);
     if (!ofs) {
         throw std::runtime_error("Failed to open SST file for writing: " + path_.string());
     }
     ofs.seekp(offsetIndex, std::ios::beg);
     ofs.write(reinterpret_cast<const char*>(block.data().data()), block.data().size());
+    ofs.flush();
     if (!ofs) {
         throw std::runtime_error("Failed to write datablock to SST file: " + path_.string());
     }
-}
-
-auto SSTFile::findDBlockOffset(const std::string& min_key) const {
-    auto it = std::upper_bound(index_block_.begin(), index_block_.end(), min_key,
-        [](const std::string& lhs, const std::pair<std::string, iblock::OffsetFieldType>& rhs) {
-            return lhs < rhs.first;
-        });
-    return it == index_block_.begin() ? index_block_.end() : std::prev(it);
-}
-
-sst::indexblock::OffsetFieldType SSTFile::getDatablockSize(decltype(index_block_)::const_iterator it) const
-{
-    sst::indexblock::OffsetFieldType block_size = 0;
-    auto next_it = std::next(it);
-    if (next_it == index_block_.end()) {
-        block_size = index_block_offset_ - it->second;
-    }
-    else {
-        block_size = next_it->second - it->second;
+    if (!use_mmap_) {
+        auto data = block.data();
+        BlockCache::instance().insert(file_id_, offsetIndex,
+            std::make_shared<const std::vector<uint8_t>>(data.begin(), data.end()));
     }
-    return block_size;
 }
 
-
 std::optional<Entry> SSTFile::get(const std::string& key) const {
-    auto it = findDBlockOffset(key);
-    if (it == index_block_.end()) {
+    ensureIndexLoaded();
+    if (!filter_.mayContain(key)) {
         return std::nullopt;
     }
-    auto data = readDatablock(it->second, getDatablockSize(it));
-    if (data.empty()) {
+    auto block = seekBlock(key);
+    if (!block.valid()) {
+        return std::nullopt;
+    }
+    auto data_block = readDatablock(block.handle());
+    if (!data_block) {
         return std::nullopt; // No data block found for the key
     }
-    DataBlock data_block(std::move(data));
-    return data_block.get(key);
+    return data_block->get(key);
+}
+void SSTFile::multiGet(std::span<const std::string* const> keys, std::span<std::optional<Entry>> results) const {
+    ensureIndexLoaded();
+    // Block of every key first, so that all missing blocks are read in one batch
+    std::vector<BlockHandle> blocks;
+    std::vector<size_t> key_blocks(keys.size(), SIZE_MAX);
+    IndexCursor block;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const auto& key = *keys[i];
+        if (results[i] || !filter_.mayContain(key)) {
+            continue;
+        }
+        // Keys are sorted, the partition of the previous key is searched first
+        if (block.valid() && block.partition.key(0) <= key &&
+            (!partitioned_index_ || block.partition_idx + 1 >= top_index_.count() || key < top_index_.key(block.partition_idx + 1))) {
+            block.idx = block.partition.find(key);
+        }
+        else {
+            block = seekBlock(key);
+        }
+        if (!block.valid()) {
+            continue;
+        }
+        auto handle = block.handle();
+        if (blocks.empty() || blocks.back().offset != handle.offset) {
+            blocks.push_back(handle); // neighbours of the same block reuse it
+        }
+        key_blocks[i] = blocks.size() - 1;
+    }
+    auto data_blocks = readDatablocks(blocks);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (key_blocks[i] != SIZE_MAX && data_blocks[key_blocks[i]]) {
+            results[i] = data_blocks[key_blocks[i]]->get(*keys[i]);
+        }
+    }
 }
+
 bool SSTFile::remove(const std::string& key)
 {
-    auto it = findDBlockOffset(key);
-    if (it == index_block_.end()) {
+    ensureIndexLoaded();
+    if (!filter_.mayContain(key)) {
         return false;
     }
-    auto datablock_size = getDatablockSize(it);
-    auto data = readDatablock(it->second, datablock_size);
-    if (data.empty()) {
+    auto block = seekBlock(key);
+    if (!block.valid()) {
         return false;
     }
-    // We don't protect the cache by mutex because remove is not thread-safe operation
-    auto find_it = datablock_cache_.find(it->second);
-    if (find_it != datablock_cache_.end()) {
-        find_it->second = data; // Update the cached block with the latest data
+    auto handle = block.handle();
+    auto data_block = readDatablock(handle);
+    if (!data_block) {
+        return false;
     }
-    DataBlock data_block(std::move(data));
-    if (data_block.remove(key)) {
-        writeDatablock(data_block, it->second);
+    if (data_block->remove(key)) {
+        writeDatablock(*data_block, handle.offset);
         return true;
     }
     return false;
 }
 EntryStatus SSTFile::status(const std::string& key) const
 {
-    auto it = findDBlockOffset(key);
-    if (it == index_block_.end()) {
+    ensureIndexLoaded();
+    if (!filter_.mayContain(key)) {
+        return EntryStatus::NOT_FOUND;
+    }
+    auto block = seekBlock(key);
+    if (!block.valid()) {
+        return EntryStatus::NOT_FOUND;
+    }
+    auto data_block = readDatablock(block.handle());
+    if (!data_block) {
+        return EntryStatus::NOT_FOUND;
+    }
+    return data_block->status(key);
+}
+
+EntryStatus SSTFile::getRaw(const std::string& key, const RawValueCallback& callback) const
+{
+    ensureIndexLoaded();
+    if (!filter_.mayContain(key)) {
+        return EntryStatus::NOT_FOUND;
+    }
+    auto block = seekBlock(key);
+    if (!block.valid()) {
         return EntryStatus::NOT_FOUND;
     }
-    auto data = readDatablock(it->second, getDatablockSize(it));
-    if (data.empty()) {
+    auto data_block = readDatablock(block.handle());
+    if (!data_block) {
         return EntryStatus::NOT_FOUND;
     }
-    DataBlock data_block(std::move(data));
-    return data_block.status(key);
+    return data_block->getRaw(key, callback);
 }
 void SSTFile::rename(const std::filesystem::path& new_path) {
-    if (ifs_.is_open()) {
-        ifs_.close();
+    {
+        // Not called concurrently with reads, the descriptor is closed so the file can be renamed on any OS
+        TableCache::instance().erase(file_id_);
+        std::lock_guard lock(file_mutex_);
+        mapping_.reset(); // blocks still held by readers keep the old mapping alive
     }
     std::filesystem::rename(path_, new_path);
     path_ = new_path;
 }
 
-std::string SSTFile::minKey() const {
-    if (index_block_.empty()) {
-        throw std::runtime_error("Index block is empty, cannot retrieve minimum key.");
+const std::string& SSTFile::minKey() const {
+    if (!key_range_loaded_) {
+        ensureIndexLoaded();
     }
-    return index_block_.front().first;
+    return min_key_;
 }
 
-std::string SSTFile::maxKey() const {
+const std::string& SSTFile::maxKey() const {
+    if (!key_range_loaded_) {
+        ensureIndexLoaded();
+    }
     return max_key_;
 }
 
-std::unique_ptr<SSTFile> SSTFile::readAndCreate(const std::filesystem::path& sst_path) {
-    std::ifstream ifs(sst_path, std::ios::binary | std::ios::ate);
+std::optional<SSTProperties> SSTFile::properties() const {
+    ensureIndexLoaded();
+    return properties_;
+}
+
+std::unique_ptr<SSTFile> SSTFile::readAndCreate(const std::filesystem::path& sst_path, const SSTOptions& options) {
+    // Only the header is read here, the index and the filter are loaded on the first access
+    std::ifstream ifs(sst_path, std::ios::binary);
     if (!ifs) throw std::runtime_error("Failed to open SST file for reading: " + sst_path.string());
 
-    uint64_t filesize = ifs.tellg();
-    ifs.seekg(0, std::ios::beg);
-    if (filesize < iblock::INDEX_BLOCK_COUNT_SIZE + sst::header::SST_HEADER_SIZE)
+    std::array<uint8_t, sst::header::SST_HEADER_SIZE> header;
+    if (!ifs.read(reinterpret_cast<char*>(header.data()), header.size()))
         throw std::runtime_error("File too small for SST structure");
-
-    char signature[5] = { 0 };
-    ifs.read(signature, sst::header::SST_SIGNATURE_SIZE);
-    if (std::string(signature, sst::header::SST_SIGNATURE_SIZE) != sst::header::SST_SIGNATURE)
+    if (std::string_view(reinterpret_cast<const char*>(header.data()), sst::header::SST_SIGNATURE_SIZE) != sst::header::SST_SIGNATURE)
         throw std::runtime_error("Invalid SST signature");
-    uint8_t version;
-    ifs.read(reinterpret_cast<char*>(&version), sst::header::SST_VERSION_SIZE);
-    std::array<uint8_t, sst::header::SST_SEQUENCE_SIZE> sequence_bytes;
-    ifs.read(reinterpret_cast<char*>(sequence_bytes.data()), sst::header::SST_SEQUENCE_SIZE);
-    uint64_t seq_num = Utils::deserializeLE<uint64_t>(sequence_bytes.data());
+    uint8_t version = header[sst::header::SST_SIGNATURE_SIZE];
+    if (version < sst::header::SST_VERSION_V1 || version > sst::header::SST_VERSION)
+        throw std::runtime_error("Unsupported SST version: " + std::to_string(version));
+    uint64_t seq_num = Utils::deserializeLE<uint64_t>(header.data() + sst::header::SST_SIGNATURE_SIZE + sst::header::SST_VERSION_SIZE);
+
+    auto sst = std::unique_ptr<SSTFile>(new SSTFile(sst_path, seq_num, {}, IndexPartition(), false,
+        BloomFilter(), version, options));
+    sst->index_loaded_ = false;
+    if (version >= sst::header::SST_VERSION_KEY_RANGE) {
+        sst->loadKeyRange(ifs);
+    }
+    return sst;
+}
+
+void SSTFile::loadKeyRange(std::ifstream& ifs) {
+    namespace footer = sst::footer;
+    uint64_t filesize = std::filesystem::file_size(path_);
+    if (filesize < sst::header::SST_HEADER_SIZE + footer::FOOTER_SIZE)
+        throw std::runtime_error("File too small for SST footer: " + path_.string());
+    auto read = [&](uint64_t offset, std::vector<uint8_t>& data) {
+        ifs.seekg(offset);
+        if (!ifs.read(reinterpret_cast<char*>(data.data()), data.size()))
+            throw std::runtime_error("Failed to read SST file: " + path_.string());
+    };
+    std::vector<uint8_t> data(footer::FOOTER_SIZE);
+    read(filesize - footer::FOOTER_SIZE, data);
+    auto properties = parseFooter(data.data(), filesize - footer::FOOTER_SIZE, version_, path_).properties;
+    data.resize(properties.size);
+    read(properties.offset, data);
+    auto parsed = parseProperties(data, version_, path_);
+    min_key_ = parsed.min_key;
+    max_key_ = parsed.max_key;
+    key_range_loaded_ = true;
+}
 
-    ifs.seekg(filesize - iblock::INDEX_BLOCK_COUNT_SIZE, std::ios::beg);
+void SSTFile::ensureIndexLoaded() const {
+    if (index_loaded_.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::lock_guard lock(index_mutex_);
+    if (!index_loaded_.load(std::memory_order_relaxed)) {
+        loadIndex();
+        index_loaded_.store(true, std::memory_order_release);
+    }
+}
+
+void SSTFile::loadIndex() const {
+    auto file = openFile();
+    if (!file) throw std::runtime_error("Failed to open SST file for reading: " + path_.string());
+    auto read = [&](uint64_t offset, uint8_t* data, size_t size) {
+        if (file->read(offset, data, size) != size)
+            throw std::runtime_error("Failed to read SST file: " + path_.string());
+    };
+
+    uint64_t filesize = std::filesystem::file_size(path_);
+    if (version_ >= sst::header::SST_VERSION_FOOTER) {
+        loadFromFooter(*file, filesize);
+        return;
+    }
+    if (filesize < iblock::INDEX_BLOCK_COUNT_SIZE + sst::header::SST_HEADER_SIZE)
+        throw std::runtime_error("File too small for SST structure");
+
+    uint64_t index_end = filesize; // IndexBlock ends with its size
+    BloomFilter filter;
+    if (version_ >= sst::header::SST_VERSION_FILTER) {
+        if (filesize < sst::filter::FILTER_SIZE_SIZE + iblock::INDEX_BLOCK_COUNT_SIZE + sst::header::SST_HEADER_SIZE)
+            throw std::runtime_error("File too small for SST filter block");
+        std::array<uint8_t, sst::filter::FILTER_SIZE_SIZE> filter_size_bytes;
+        read(filesize - sst::filter::FILTER_SIZE_SIZE, filter_size_bytes.data(), filter_size_bytes.size());
+        auto filter_size = Utils::deserializeLE<sst::filter::FilterSizeFieldType>(filter_size_bytes.data());
+        if (filesize < filter_size + sst::filter::FILTER_SIZE_SIZE + iblock::INDEX_BLOCK_COUNT_SIZE + sst::header::SST_HEADER_SIZE)
+            throw std::runtime_error("File too small for SST filter block");
+        index_end = filesize - sst::filter::FILTER_SIZE_SIZE - filter_size;
+        std::vector<uint8_t> filter_data(filter_size);
+        read(index_end, filter_data.data(), filter_size);
+        filter = BloomFilter(std::move(filter_data));
+    }
+
+    bool partitioned = false;
     iblock::CountFieldType indexblock_size = 0;
-    ifs.read(reinterpret_cast<char*>(&indexblock_size), sizeof(indexblock_size));
-    indexblock_size = Utils::deserializeLE<iblock::CountFieldType>(reinterpret_cast<uint8_t*>(&indexblock_size));
-    if (filesize < indexblock_size + iblock::INDEX_BLOCK_COUNT_SIZE + sst::header::SST_HEADER_SIZE)
+    if (version_ >= sst::header::SST_VERSION_PARTITIONED) {
+        // [TopLevelIndex][IndexLevels][TopLevelIndexSize]
+        if (index_end < iblock::INDEX_LEVELS_SIZE + iblock::INDEX_BLOCK_COUNT_SIZE + sst::header::SST_HEADER_SIZE)
+            throw std::runtime_error("File too small for SST index block");
+        std::array<uint8_t, iblock::INDEX_LEVELS_SIZE + iblock::INDEX_BLOCK_COUNT_SIZE> trailer;
+        read(index_end - trailer.size(), trailer.data(), trailer.size());
+        auto levels = Utils::deserializeLE<iblock::IndexLevelsFieldType>(trailer.data());
+        if (levels != iblock::SINGLE_LEVEL_INDEX && levels != iblock::TWO_LEVEL_INDEX)
+            throw std::runtime_error("Invalid number of index levels: " + std::to_string(levels));
+        partitioned = levels == iblock::TWO_LEVEL_INDEX;
+        indexblock_size = Utils::deserializeLE<iblock::CountFieldType>(trailer.data() + iblock::INDEX_LEVELS_SIZE);
+        index_end -= trailer.size();
+    }
+    else {
+        // [IndexBlock][IndexBlockSize]
+        std::array<uint8_t, iblock::INDEX_BLOCK_COUNT_SIZE> size_bytes;
+        read(index_end - iblock::INDEX_BLOCK_COUNT_SIZE, size_bytes.data(), size_bytes.size());
+        indexblock_size = Utils::deserializeLE<iblock::CountFieldType>(size_bytes.data());
+        index_end -= iblock::INDEX_BLOCK_COUNT_SIZE;
+    }
+    if (index_end < indexblock_size + sst::header::SST_HEADER_SIZE)
         throw std::runtime_error("File too small for SST index block");
-    auto indexblock_offset = filesize
-        - static_cast<std::streamoff>(indexblock_size)
-        - static_cast<std::streamoff>(sizeof(indexblock_size));
+    auto indexblock_offset = index_end - indexblock_size;
 
-    ifs.seekg(indexblock_offset, std::ios::beg);
     std::vector<uint8_t> indexblock_buf(indexblock_size);
-    ifs.read(reinterpret_cast<char*>(indexblock_buf.data()), indexblock_size);
+    read(indexblock_offset, indexblock_buf.data(), indexblock_size);
 
-    std::vector<std::pair<std::string, iblock::OffsetFieldType>> index_block;
-    uint64_t pos = 0;
-    iblock::OffsetFieldType offset = 0;
-    while (pos + sizeof(iblock::IndexKeyLengthFieldType) < indexblock_buf.size()) {
-        auto key_len = Utils::deserializeLE<iblock::IndexKeyLengthFieldType>(&indexblock_buf[pos]);
-        if (key_len == 0 || pos + iblock::INDEX_KEY_LEN + iblock::BLOCK_OFFSET_SIZE + key_len > indexblock_buf.size()) {
-            throw std::runtime_error("Invalid key length in index block");
+    IndexPartition top_index;
+    if (version_ >= sst::header::SST_VERSION_PARTITIONED) {
+        top_index = IndexPartition(std::move(indexblock_buf));
+    }
+    else {
+        // Single-level index: [KeyLen][Key][Offset]...
+        IndexPartitionBuilder index_builder;
+        uint64_t pos = 0;
+        while (pos + sizeof(iblock::IndexKeyLengthFieldType) < indexblock_buf.size()) {
+            auto key_len = Utils::deserializeLE<iblock::IndexKeyLengthFieldType>(&indexblock_buf[pos]);
+            if (key_len == 0 || pos + iblock::INDEX_KEY_LEN + iblock::BLOCK_OFFSET_SIZE + key_len > indexblock_buf.size()) {
+                throw std::runtime_error("Invalid key length in index block");
+            }
+            pos += sizeof(iblock::IndexKeyLengthFieldType);
+            std::string_view min_key(reinterpret_cast<const char*>(&indexblock_buf[pos]), key_len);
+            pos += key_len;
+            auto offset = Utils::deserializeLE<iblock::OffsetFieldType>(&indexblock_buf[pos]);
+            pos += sizeof(iblock::OffsetFieldType);
+            index_builder.addKey(min_key, offset);
         }
-        pos += sizeof(iblock::IndexKeyLengthFieldType);
-        auto min_key = Utils::deserializeLE<std::string>(&indexblock_buf[pos], key_len);
-        pos += key_len;
-        offset = Utils::deserializeLE<iblock::OffsetFieldType>(&indexblock_buf[pos]);
-        pos += sizeof(iblock::OffsetFieldType);
-        index_block.emplace_back(std::move(min_key), offset);
+        if (index_builder.empty()) {
+            throw std::runtime_error("Index block is empty");
+        }
+        top_index = IndexPartition(index_builder.build(indexblock_offset));
     }
 
-    auto db = DataBlock(readDatablock(sst_path, offset, indexblock_offset - index_block.back().second));
-    auto max_key = db.get(db.count() - 1).first;
-    return std::unique_ptr<SSTFile>(new SSTFile(sst_path, indexblock_offset, seq_num, max_key, std::move(index_block)));
+    top_index_ = std::move(top_index);
+    partitioned_index_ = partitioned;
+    filter_ = std::move(filter);
+    auto db = readExistingDatablock(lastBlock().handle());
+    max_key_ = db.keyAt(db.count() - 1);
+    min_key_ = top_index_.key(0);
 }
 
 
 
+void SSTFile::loadFromFooter(const RandomAccessFile& file, uint64_t filesize) const {
+    namespace footer = sst::footer;
+    if (filesize < sst::header::SST_HEADER_SIZE + footer::FOOTER_SIZE)
+        throw std::runtime_error("File too small for SST footer: " + path_.string());
+    // One read of the tail, a second one only if the metadata blocks don't fit in it
+    uint64_t meta_end = filesize - footer::FOOTER_SIZE;
+    uint64_t meta_start = filesize - std::min<uint64_t>(filesize - sst::header::SST_HEADER_SIZE,
+        std::max(footer::TAIL_READ_SIZE, footer::FOOTER_SIZE));
+    std::vector<uint8_t> tail(filesize - meta_start);
+    if (file.read(meta_start, tail.data(), tail.size()) != tail.size())
+        throw std::runtime_error("Failed to read SST footer: " + path_.string());
+    auto parsed_footer = parseFooter(tail.data() + tail.size() - footer::FOOTER_SIZE, meta_end, version_, path_);
+
+    // Index, filter and properties precede the footer
+    auto first = std::min({ parsed_footer.index.offset, parsed_footer.filter.offset, parsed_footer.properties.offset });
+    if (first < meta_start) {
+        tail.resize(filesize - first);
+        if (file.read(first, tail.data(), tail.size()) != tail.size())
+            throw std::runtime_error("Failed to read SST index block: " + path_.string());
+        meta_start = first;
+    }
+    auto block = [&](const FooterHandle& handle) {
+        auto begin = tail.begin() + (handle.offset - meta_start);
+        return std::vector<uint8_t>(begin, begin + handle.size);
+    };
+
+    auto properties_data = block(parsed_footer.properties);
+    auto properties = parseProperties(properties_data, version_, path_);
+    top_index_ = IndexPartition(block(parsed_footer.index));
+    partitioned_index_ = parsed_footer.levels == iblock::TWO_LEVEL_INDEX;
+    filter_ = BloomFilter(block(parsed_footer.filter));
+    properties_ = properties.properties;
+    if (!key_range_loaded_) {
+        if (top_index_.empty())
+            throw std::runtime_error("SST index block is empty: " + path_.string());
+        max_key_ = properties.max_key;
+        min_key_ = top_index_.key(0);
+    }
+}
+
 std::vector<std::string> SSTFile::keysWithPrefix(const std::string& prefix, unsigned int max_results) const {
     std::vector<std::string> result;
-    if (prefix > maxKey()) {
-        return result;
-    }
-    auto min_key = minKey();
-    if (prefix < min_key && min_key.rfind(prefix, 0) != 0) {
+    if (max_results == 0) {
         return result;
     }
-    auto it = findDBlockOffset(prefix);
-    if (it == index_block_.end()) {
-        it = index_block_.begin(); // Key is out of the block, but prefix might be less then min_key
-    }
-    for (; it != index_block_.end() &&
-        result.size() < static_cast<size_t>(max_results);
-        ++it) {
-        if (prefix < it->first && it->first.rfind(prefix, 0) != 0) {
-            break;
-        }
-        auto block_data = readDatablock(it->second, getDatablockSize(it));
-        DataBlock block(std::move(block_data));
+    forEachPrefixBlock(prefix, [&](const DataBlock& block) {
         auto keys = block.keysWithPrefix(prefix, max_results - static_cast<int>(result.size()));
         result.insert(result.end(), keys.begin(), keys.end());
-        if (result.size() >= static_cast<size_t>(max_results)) break;
-    }
-
+        return result.size() < static_cast<size_t>(max_results);
+        });
     return result;
 }
 
 bool SSTFile::forEachKeyWithPrefix(const std::string& prefix,
     const std::function<bool(const std::string&)>& callback) const {
+    return forEachPrefixBlock(prefix, [&](const DataBlock& block) {
+        return block.forEachKeyWithPrefix(prefix, callback); // Stop if callback returns false
+        });
+}
+
+bool SSTFile::forEachPrefixBlock(const std::string& prefix, const std::function<bool(const DataBlock&)>& func) const {
     if (prefix > maxKey()) {
         return true;
     }
@@ -251,32 +661,45 @@ bool SSTFile::forEachKeyWithPrefix(const std::string& prefix,
     if (prefix < min_key && min_key.rfind(prefix, 0) != 0) {
         return true;
     }
-    auto it = findDBlockOffset(prefix);
-    if (it == index_block_.end()) {
-        it = index_block_.begin(); // Key is out of the block, but prefix might be less then min_key
-    }
-    for (; it != index_block_.end(); ++it) {
-        if (prefix < it->first && it->first.rfind(prefix, 0) != 0) {
-            break; // No more keys with this prefix
+    auto it = seekBlock(prefix);
+    if (!it.valid()) {
+        it = firstBlock(); // Key is out of the block, but prefix might be less then min_key
+    }
+    // The first batch is a single block, short scans don't read ahead
+    size_t batch_size = 1;
+    std::vector<BlockHandle> batch;
+    while (it.valid()) {
+        batch.clear();
+        for (; it.valid() && batch.size() < batch_size; nextBlock(it)) {
+            auto min_key = it.minKey();
+            if (prefix < min_key && !min_key.starts_with(prefix)) {
+                it = IndexCursor(); // No more keys with this prefix
+                break;
+            }
+            batch.push_back(it.handle());
         }
-        auto block_data = readDatablock(it->second, getDatablockSize(it));
-        DataBlock block(std::move(block_data));
-        if (!block.forEachKeyWithPrefix(prefix, callback)) {
-            return false; // Stop if callback returns false
+        auto blocks = readDatablocks(batch);
+        for (auto& block : blocks) {
+            if (!block) {
+                throw std::runtime_error("Failed to read DataBlock from SST file: " + path_.string());
+            }
+            if (!func(*block)) {
+                return false;
+            }
         }
+        batch_size = std::min(batch_size * 2, sst::cache::MAX_SCAN_READAHEAD_BLOCKS);
     }
     return true;
 }
 
-std::unique_ptr<SSTFile> SSTFile::shrink(uint32_t datablock_size) const {
+std::unique_ptr<SSTFile> SSTFile::shrink(uint32_t datablock_size, const SSTOptions& options) const {
     auto first_out_path = path_.string() + std::string("_cleaned_.tmp");
     return SSTFile::writeAndCreate(first_out_path, datablock_size, seqNum(),
-        false, begin(), end());
+        false, begin(), end(), options);
 }
 
 void SSTFile::clearCache() noexcept {
-    //This operation is not thread-safe
-    datablock_cache_.clear();
+    BlockCache::instance().eraseFile(file_id_);
 }
 
 std::vector<std::unique_ptr<SSTFile>>  SSTFile::merge(
@@ -285,16 +708,17 @@ std::vector<std::unique_ptr<SSTFile>>  SSTFile::merge(
     const std::filesystem::path& out_dir,
     uint64_t max_file_size,
     uint32_t datablock_size,
-    bool keep_removed)
+    bool keep_removed,
+    const SSTOptions& options)
 {
     // Read input files
-    auto sst1 = SSTFile::readAndCreate(sst1_path);
+    auto sst1 = SSTFile::readAndCreate(sst1_path, options);
 
     std::vector<std::unique_ptr<SSTFile>>  dst_files;
     if (dst_file_paths.empty()) {
         auto first_out_path = out_dir / ("merged_" + std::to_string(sst1->seqNum()) + ".tmp");
         auto new_sst = SSTFile::writeAndCreate(first_out_path, datablock_size, sst1->seqNum(),
-            keep_removed, sst1->begin(), sst1->end());
+            keep_removed, sst1->begin(), sst1->end(), options);
         if (new_sst) {
             dst_files.push_back(std::move(new_sst));
         }
@@ -304,24 +728,18 @@ std::vector<std::unique_ptr<SSTFile>>  SSTFile::merge(
 
     dst_files.reserve(dst_file_paths.size());
     for (const auto& dst_file_path : dst_file_paths) {
-        dst_files.push_back(SSTFile::readAndCreate(dst_file_path));
+        dst_files.push_back(SSTFile::readAndCreate(dst_file_path, options));
     }
 
     bool sst1_before = !dst_files.empty() && sst1->maxKey() < dst_files.front()->minKey();
     bool sst1_after = !dst_files.empty() && sst1->minKey() > dst_files.back()->maxKey();
     if (dst_files.size() == 1 && (sst1_before || sst1_after)) {
         uint64_t seq_num = std::min(sst1->seqNum(), dst_files.front()->seqNum());
-        SSTBuilder builder(out_dir / ("merged_" + std::to_string(seq_num) + ".tmp"), datablock_size, seq_num);
+        SSTBuilder builder(out_dir / ("merged_" + std::to_string(seq_num) + ".tmp"), datablock_size, seq_num, options);
         auto copyFile = [&](const std::unique_ptr<SSTFile>& file) {
-            int i = 0;
-            for (auto it = file->index_block_.begin(); it != file->index_block_.end(); ++it, ++i) {
-                auto block_data = file->readDatablock(it->second, file->getDatablockSize(it));
-                std::string max_key;
-                if (i == file->index_block_.size() - 1) {
-                    DataBlock db(block_data);
-                    max_key = db.get(db.count() - 1).first;
-                }
-                builder.addDatablock(it->first, block_data, max_key);
+            for (auto it = file->firstBlock(); it.valid();) {
+                builder.addDatablock(file->readExistingDatablock(it.handle()));
+                file->nextBlock(it);
             }
         };
         if (sst1_before) {
@@ -349,7 +767,7 @@ std::vector<std::unique_ptr<SSTFile>>  SSTFile::merge(
     auto seq_num = seq_nums.front();
 
     SSTBuilder builder(out_dir / ("merged_" + std::to_string(seq_num) + ".tmp"),
-        datablock_size, seq_num);
+        datablock_size, seq_num, options);
 
     auto it1 = sst1->begin();
     auto it2 = dst_files.front()->begin();
@@ -373,7 +791,7 @@ std::vector<std::unique_ptr<SSTFile>>  SSTFile::merge(
             }
             auto p = out_dir / ("merged_" + std::to_string(seq_nums[current_seq_index]) + ".tmp");
 
-            builder = SSTBuilder(p, datablock_size, seq_nums[current_seq_index]);
+            builder = SSTBuilder(p, datablock_size, seq_nums[current_seq_index], options);
         }
         auto [key1, stt_entry1] = *it1;
         if (!keep_removed && stt_entry1.entry.type == ValueType::REMOVED) {
@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <bit>
 #include <filesystem>
 #include <fstream>
@@ -8,12 +9,18 @@
 #include <vector>
 #include <unordered_map>
 #include <mutex>
+#include <shared_mutex>
 #include <functional>
+#include <span>
 
 #include "constants.h"
 #include "types.h"
 #include "datablock.h"
 #include "sstbuilder.h"
+#include "blockcache.h"
+#include "tablecache.h"
+#include "indexpartition.h"
+#include "fileio.h"
 #include "utils.h"
 
 template <typename T>
@@ -33,6 +40,28 @@ concept SSTInputIterator =
 std::input_iterator<It> && SSTPairConcept<std::iter_value_t<It>>;
 
 class SSTFile {
+    // Position of a DataBlock in the index
+    struct BlockHandle {
+        sst::indexblock::OffsetFieldType offset = 0;
+        sst::indexblock::OffsetFieldType size = 0;
+    };
+    // Walks the DataBlocks in key order, holds the index partition of the current block
+    struct IndexCursor {
+        IndexPartition partition; // the top-level index of files with a single-level index
+        sst::indexblock::CountFieldType partition_idx = 0; // entry of the partition in the top-level index
+        sst::indexblock::CountFieldType idx = 0;
+
+        bool valid() const noexcept {
+            return idx < partition.count();
+        }
+        std::string_view minKey() const {
+            return partition.key(idx);
+        }
+        BlockHandle handle() const {
+            return { partition.offset(idx), partition.blockSize(idx) };
+        }
+    };
+
 public:
     class iterator {
     public:
@@ -44,10 +73,10 @@ public:
         using reference = value_type&;
 
         // Default‐constructed iterator is “end.”
-        iterator() noexcept : sst_file_(nullptr), block_idx_(0), inner_idx_(0) {}
+        iterator() noexcept : sst_file_(nullptr), inner_idx_(0) {}
         // Construct a “begin” iterator (loads the first DataBlock, if any)
-        explicit iterator(const SSTFile* sst) noexcept : sst_file_(sst), block_idx_(0), inner_idx_(0) {
-            if (sst_file_->index_block_.empty()) {
+        explicit iterator(const SSTFile* sst) : sst_file_(sst), block_(sst->firstBlock()), inner_idx_(0) {
+            if (!block_.valid()) {
                 sst_file_ = nullptr;
                 return;
             }
@@ -67,8 +96,8 @@ public:
             }
 
             // else: move on to the next block
-            ++block_idx_;
-            if (block_idx_ >= sst_file_->index_block_.size()) {
+            sst_file_->nextBlock(block_);
+            if (!block_.valid()) {
                 // no more blocks → become end
                 sst_file_ = nullptr;
                 return *this;
@@ -97,7 +126,7 @@ public:
                 return true;
             }
             return (sst_file_ == other.sst_file_) &&
-                (block_idx_ == other.block_idx_) &&
+                (block_offset_ == other.block_offset_) &&
                 (inner_idx_ == other.inner_idx_);
         }
 
@@ -107,26 +136,26 @@ public:
 
     private:
         const SSTFile* sst_file_;
-        size_t block_idx_;
+        IndexCursor block_;
+        sst::indexblock::OffsetFieldType block_offset_ = 0;
         DataBlock current_block_;
         size_t inner_idx_;
         void loadCurrentBlock() {
-            // Fetch offset of the block
-            const auto& idx_vec = sst_file_->index_block_;
-            auto offset = idx_vec[block_idx_].second;
-            auto block_size = sst_file_->getDatablockSize(idx_vec.begin() + block_idx_);
-            auto raw_bytes = sst_file_->readDatablock(offset, block_size);
-            current_block_ = DataBlock(std::move(raw_bytes));
+            // Shares the cached or mapped block, no copy
+            auto handle = block_.handle();
+            block_offset_ = handle.offset;
+            current_block_ = sst_file_->readExistingDatablock(handle);
         }
     };
 
-    iterator begin() const noexcept {
+    iterator begin() const {
         return iterator(this);
     }
     iterator end() const noexcept {
         return iterator(); // default‐constructed = “end”
     }
 
+    ~SSTFile();
     SSTFile(SSTFile&&) = delete;
     SSTFile& operator=(SSTFile&&) = delete;
     SSTFile(const SSTFile&) = delete;
@@ -137,19 +166,42 @@ public:
         const std::function<bool(const std::string&)>& callback) const;
 
     std::optional<Entry> get(const std::string& key) const;
+    // Looks up sorted keys which have no result yet, each DataBlock is read and parsed once
+    void multiGet(std::span<const std::string* const> keys, std::span<std::optional<Entry>> results) const;
     bool remove(const std::string& key);
     EntryStatus status(const std::string& key) const;
+    // Passes the value bytes of an existing key to the callback while the block is held
+    EntryStatus getRaw(const std::string& key, const RawValueCallback& callback) const;
     void rename(const std::filesystem::path& new_path);
+    // The file is removed from the disk when the last reader releases the object
+    void markObsolete() noexcept {
+        obsolete_.store(true, std::memory_order_release);
+    }
     const std::filesystem::path& path() const noexcept {
         return path_;
     }
     const uint64_t& seqNum() const noexcept {
         return seq_num_;
     }
-    std::string minKey() const;
-    std::string maxKey() const;
-    static std::unique_ptr<SSTFile> readAndCreate(const std::filesystem::path& sst_path);
-    std::unique_ptr<SSTFile> shrink(uint32_t datablock_size) const;
+    // SST format version the file was written with
+    uint8_t version() const noexcept {
+        return version_;
+    }
+    // Read when the file is opened since SST_VERSION_KEY_RANGE, older files load their index for them
+    const std::string& minKey() const;
+    const std::string& maxKey() const;
+    // Stored since SST_VERSION_FOOTER, nullopt for older files
+    std::optional<SSTProperties> properties() const;
+    // Bytes of the index kept in memory, 0 until the index is loaded.
+    // Index partitions of large files are read through the block cache.
+    size_t indexMemoryUsage() const noexcept {
+        return index_loaded_.load(std::memory_order_acquire) ? top_index_.size() : 0;
+    }
+    // Reads the header and, since SST_VERSION_KEY_RANGE, the key range from the footer and the properties block.
+    // The index and the filter are loaded on the first access.
+    // Only read options (use_mmap, use_io_uring) of the options are used
+    static std::unique_ptr<SSTFile> readAndCreate(const std::filesystem::path& sst_path, const SSTOptions& options = {});
+    std::unique_ptr<SSTFile> shrink(uint32_t datablock_size, const SSTOptions& options = {}) const;
     void clearCache() noexcept;
     static std::vector<std::unique_ptr<SSTFile>>  merge(
         const std::filesystem::path& sst1_path,
@@ -157,16 +209,17 @@ public:
         const std::filesystem::path& out_dir,
         uint64_t max_file_size,
         uint32_t datablock_size,
-        bool keep_removed);
+        bool keep_removed,
+        const SSTOptions& options = {});
 
     template <SSTInputIterator InputIt>
     static std::unique_ptr<SSTFile> writeAndCreate(const std::filesystem::path& sst_path, int max_datablock_size, uint64_t seq_num,
-        bool keep_removed, InputIt begin, InputIt end) {
+        bool keep_removed, InputIt begin, InputIt end, const SSTOptions& options = {}) {
         if (begin == end) {
             return nullptr;
         }
 
-        SSTBuilder builder(sst_path, max_datablock_size, seq_num);
+        SSTBuilder builder(sst_path, max_datablock_size, seq_num, options);
         for (auto it = begin; it != end; ++it) {
             const auto& val = *it;
             if (keep_removed || (val.second.entry.type != ValueType::REMOVED && !Utils::isExpired(val.second.expiration_ms))) {
@@ -179,28 +232,66 @@ public:
 
 protected:
 private:
-    SSTFile(const std::filesystem::path& path, sst::indexblock::OffsetFieldType file_size,
-        uint64_t seq_num, const std::string max_key,
-        std::vector<std::pair<std::string, sst::indexblock::OffsetFieldType>> index_block);
+    SSTFile(const std::filesystem::path& path, uint64_t seq_num, const std::string max_key,
+        IndexPartition top_index, bool partitioned_index,
+        BloomFilter filter, uint8_t version, const SSTOptions& options, std::optional<SSTProperties> properties = std::nullopt);
 
-    std::vector<uint8_t> readDatablock(sst::indexblock::OffsetFieldType block_offset, sst::indexblock::OffsetFieldType block_size) const;
-    static std::vector<uint8_t> readDatablock(const std::filesystem::path path, sst::indexblock::OffsetFieldType block_offset, sst::indexblock::OffsetFieldType block_size);
+    // Returns the cached bytes or reads them from the disk, in mmap mode the mapped bytes.
+    // nullptr if they can't be read.
+    std::shared_ptr<const uint8_t> readBlock(sst::indexblock::OffsetFieldType block_offset, sst::indexblock::OffsetFieldType block_size) const;
+    // nullopt if the block can't be read
+    std::optional<DataBlock> readDatablock(const BlockHandle& handle) const;
+    // Writes the block in place. Readers of a mapped file see the new bytes, also in blocks they already hold.
     void writeDatablock(const DataBlock& block, sst::indexblock::OffsetFieldType offsetIndex) const;
-    auto findDBlockOffset(const std::string& min_key) const;
+    std::optional<IndexPartition> readPartition(sst::indexblock::CountFieldType partition_idx) const;
+    // Block which may hold the key, invalid if the key is before the first block or the partition can't be read
+    IndexCursor seekBlock(std::string_view key) const;
+    IndexCursor firstBlock() const;
+    // Requires the loaded index
+    IndexCursor lastBlock() const;
+    void nextBlock(IndexCursor& cursor) const;
 
-    mutable std::ifstream ifs_;
-    void openIfNeeded() const;
+    // Opened on the first read and closed by the table cache when other files are used more recently
+    std::shared_ptr<RandomAccessFile> openFile() const;
+    void ensureIndexLoaded() const;
+    // Reads the index, the filter and the max key of files opened by readAndCreate
+    void loadIndex() const;
+    // Same for files with a footer, the tail of the file is read at once
+    void loadFromFooter(const RandomAccessFile& file, uint64_t filesize) const;
+    // Reads the key range of a file opened by readAndCreate from its footer and properties block
+    void loadKeyRange(std::ifstream& ifs);
+    std::shared_ptr<const MappedFile> mapFile() const;
 
     std::filesystem::path path_;
-    std::vector<std::pair<std::string, sst::indexblock::OffsetFieldType>> index_block_;
-    sst::indexblock::OffsetFieldType index_block_offset_;
+    // Set by loadIndex on the first access, immutable once index_loaded_ is set
+    mutable IndexPartition top_index_; // the whole index of files with a single-level index
+    mutable bool partitioned_index_; // top_index_ points at index partitions
     uint64_t seq_num_;
-    std::string max_key_;
+    mutable std::string min_key_;
+    mutable std::string max_key_;
+    bool key_range_loaded_; // min_key_ and max_key_ are set without the index, immutable after opening
+    mutable BloomFilter filter_; // empty for files without filter block
+    mutable std::optional<SSTProperties> properties_;
+    uint8_t version_; // format of the DataBlocks
+    mutable std::atomic<bool> index_loaded_ = true;
+    std::atomic<bool> obsolete_ = false;
+    mutable std::mutex index_mutex_; // held while the index is loaded
 
-    mutable std::mutex cache_mutex_;
-    mutable std::unordered_map<sst::indexblock::OffsetFieldType, std::vector<uint8_t>> datablock_cache_; // Cache for datablocks by their offset
-    static int max_cached_files_;
-    sst::indexblock::OffsetFieldType getDatablockSize(decltype(index_block_)::const_iterator it) const;
+    uint64_t file_id_; // key of the file's blocks in BlockCache
+    mutable std::mutex file_mutex_; // guards the mapping_ pointer, never held across I/O
+    // Exclusive while a block is patched in place, shared by readers from the read of a missed
+    // block until it is in the block cache. A patch is neither torn nor overwritten by old bytes.
+    mutable std::shared_mutex write_mutex_;
+    mutable std::shared_ptr<const MappedFile> mapping_;
+    bool use_mmap_ = false;
+    bool use_io_uring_ = true;
+    // Throws if the block can't be read
+    DataBlock readExistingDatablock(const BlockHandle& handle) const;
+    // Same as readDatablock for several blocks, the cache misses are read in one batch
+    std::vector<std::optional<DataBlock>> readDatablocks(std::span<const BlockHandle> blocks) const;
+    // Calls func for each block which may hold keys with the prefix until it returns false.
+    // Blocks are read in growing batches, so long scans keep several reads in flight.
+    bool forEachPrefixBlock(const std::string& prefix, const std::function<bool(const DataBlock&)>& func) const;
 
     friend class SSTBuilder;
 };
@@ -0,0 +1,82 @@
+#include "tablecache.h"
+#include "constants.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+TableCache::TableCache(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {}
+
+TableCache& TableCache::instance() {
+    static TableCache cache(sst::cache::DEFAULT_MAX_OPEN_FILES);
+    return cache;
+}
+
+TableCache::File TableCache::open(uint64_t file_id, const std::filesystem::path& path) {
+    {
+        std::lock_guard lock(mutex_);
+        auto it = map_.find(file_id);
+        if (it != map_.end()) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return it->second->second;
+        }
+    }
+    // Concurrent first readers may both open the file, one of the descriptors is kept
+    File file;
+    try {
+        file = std::make_shared<RandomAccessFile>(path);
+    }
+    catch (const std::runtime_error&) {
+        return nullptr;
+    }
+    opens_.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard lock(mutex_);
+    auto it = map_.find(file_id);
+    if (it != map_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->second;
+    }
+    lru_.emplace_front(file_id, file);
+    map_.emplace(file_id, lru_.begin());
+    evict();
+    return file;
+}
+
+void TableCache::erase(uint64_t file_id) {
+    File file; // closed outside of the lock
+    std::lock_guard lock(mutex_);
+    auto it = map_.find(file_id);
+    if (it != map_.end()) {
+        file = std::move(it->second->second);
+        lru_.erase(it->second);
+        map_.erase(it);
+    }
+}
+
+void TableCache::setCapacity(size_t capacity) {
+    std::lock_guard lock(mutex_);
+    capacity_ = std::max<size_t>(capacity, 1);
+    evict();
+}
+
+TableCache::Stats TableCache::stats() const {
+    Stats stats;
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.opens = opens_.load(std::memory_order_relaxed);
+    std::lock_guard lock(mutex_);
+    stats.open_files = lru_.size();
+    stats.capacity = capacity_;
+    return stats;
+}
+
+void TableCache::resetStats() noexcept {
+    hits_ = 0;
+    opens_ = 0;
+}
+
+void TableCache::evict() {
+    while (lru_.size() > capacity_) {
+        map_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+}
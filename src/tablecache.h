@@ -0,0 +1,53 @@
+#pragma once
+#include "fileio.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Process-wide cache of open SST file descriptors, shared by all open SST files.
+// Files are opened on their first read and closed in LRU order once more than the capacity are open.
+// A reader keeps its descriptor until it is done, so an evicted file is closed after its last read.
+class TableCache {
+public:
+    using File = std::shared_ptr<RandomAccessFile>;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t opens = 0; // descriptors opened, including reopens of evicted files
+        size_t open_files = 0;
+        size_t capacity = 0;
+    };
+
+    explicit TableCache(size_t capacity);
+    TableCache(const TableCache&) = delete;
+    TableCache& operator=(const TableCache&) = delete;
+
+    // Cache used by SSTFile
+    static TableCache& instance();
+
+    // Cached descriptor of the file or a newly opened one, nullptr if the file can't be opened
+    File open(uint64_t file_id, const std::filesystem::path& path);
+    // Closes the file once its readers are done, e.g. before it is renamed or removed
+    void erase(uint64_t file_id);
+    // Closes files until the new capacity is respected, at least one file stays open
+    void setCapacity(size_t capacity);
+    Stats stats() const;
+    void resetStats() noexcept;
+
+private:
+    using LruList = std::list<std::pair<uint64_t, File>>; // most recently used in front
+
+    void evict();
+
+    mutable std::mutex mutex_; // never held while a file is opened
+    LruList lru_;
+    std::unordered_map<uint64_t, LruList::iterator> map_;
+    size_t capacity_;
+    std::atomic<uint64_t> hits_ = 0;
+    std::atomic<uint64_t> opens_ = 0;
+};
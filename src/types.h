@@ -6,6 +6,7 @@
 #include <cstdint>
 #include <limits>
 #include <concepts>
+#include <functional>
 
 template <typename T>
 concept SupportedInteger =
@@ -119,10 +120,47 @@ struct Entry {
     Value value;
 };
 
+// Serialized value of an entry in a MemTable or a DataBlock, the bytes are valid during the callback only
+struct RawValue {
+    ValueType type;
+    const uint8_t* data;
+    size_t size; // readable bytes, other entries may follow the value
+    bool varint_length; // length of blob-like values is a varint, not ValueLengthFieldType
+    uint64_t expiration_ms;
+};
+using RawValueCallback = std::function<void(const RawValue&)>;
+
+
+// Durability of the write-ahead log
+enum class WalSyncMode {
+    NONE,      // Records are handed to the OS but never synced, survives a process crash only
+    BATCHED,   // Log is synced in background every wal_sync_interval_ms, put() does not wait
+    PER_WRITE, // put() returns after its record is synced, concurrent writers share one sync
+};
 
 struct Config {
     size_t memtable_size_bytes = 64 * 1024 * 1024; //64 MB
     size_t l0_max_files = 4; 
     size_t block_size = 32 * 1024; //32 KB default block size
     uint32_t shrink_timer_minutes = 0; // 0 means disabled
+    uint32_t bloom_bits_per_key = sst::filter::DEFAULT_BITS_PER_KEY; // 0 disables bloom filters in new SST files
+    // Runtime options, not stored in the manifest
+    WalSyncMode wal_sync_mode = WalSyncMode::BATCHED;
+    uint32_t wal_sync_interval_ms = 100;
+    // Capacity of the process-wide block cache shared by all storages, 0 disables caching.
+    // Set by the storage opened while no other storage is open, ignored by the others.
+    size_t block_cache_size_bytes = sst::cache::DEFAULT_BLOCK_CACHE_SIZE;
+    // Capacity of the cache of point lookup results of this storage, 0 disables it
+    size_t row_cache_size_bytes = 0;
+    // SST files kept open by the process-wide table cache, least recently read files are closed first.
+    // Set by the storage opened while no other storage is open, like block_cache_size_bytes.
+    size_t max_open_files = sst::cache::DEFAULT_MAX_OPEN_FILES;
+    // Read SST blocks straight from memory-mapped files, the block cache is not used for them
+    bool use_mmap = false;
+    // Submit block reads of multiGet and prefix scans at once through io_uring (Linux),
+    // pread is used one block at a time if it is disabled or not supported
+    bool use_io_uring = true;
+    // Write a hash index into each DataBlock of new SST files: point lookups probe one bucket
+    // instead of a binary search, at the cost of about 3 bytes per key
+    bool datablock_hash_index = false;
 };
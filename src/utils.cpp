@@ -1,7 +1,9 @@
 #include "utils.h"
 #include "constants.h"
 
+#include <array>
 #include <chrono>
+#include <stdexcept>
 using namespace std::chrono;
 
 uint64_t Utils::getNow()
@@ -18,3 +20,199 @@ bool Utils::isExpired(uint64_t timestamp)
     uint64_t now = getNow();
     return timestamp <= now;
 }
+
+uint32_t Utils::crc32(const uint8_t* data, size_t size, uint32_t crc)
+{
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint64_t Utils::hash64(const void* data, size_t size, uint64_t seed)
+{
+    constexpr uint64_t m = 0xc6a4a7935bd1e995ull;
+    constexpr int r = 47;
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    uint64_t h = seed ^ (size * m);
+
+    size_t blocks = size / 8;
+    for (size_t i = 0; i < blocks; ++i) {
+        auto k = deserializeLE<uint64_t>(bytes + i * 8);
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    const auto* tail = bytes + blocks * 8;
+    switch (size & 7) {
+    case 7: h ^= uint64_t(tail[6]) << 48; [[fallthrough]];
+    case 6: h ^= uint64_t(tail[5]) << 40; [[fallthrough]];
+    case 5: h ^= uint64_t(tail[4]) << 32; [[fallthrough]];
+    case 4: h ^= uint64_t(tail[3]) << 24; [[fallthrough]];
+    case 3: h ^= uint64_t(tail[2]) << 16; [[fallthrough]];
+    case 2: h ^= uint64_t(tail[1]) << 8; [[fallthrough]];
+    case 1: h ^= uint64_t(tail[0]);
+        h *= m;
+    }
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
+
+std::string Utils::shortestSeparator(std::string_view previous, std::string_view next)
+{
+    // Any shorter string is a prefix of the common prefix (not greater than previous)
+    // or differs from it (less than previous or greater than next)
+    size_t common = 0;
+    while (common < previous.size() && common < next.size() && previous[common] == next[common]) {
+        ++common;
+    }
+    return std::string(next.substr(0, common + 1));
+}
+
+void Utils::serializeVarint(uint64_t value, std::vector<uint8_t>& buffer) {
+    while (value >= 0x80) {
+        buffer.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<uint8_t>(value));
+}
+
+size_t Utils::deserializeVarint(const uint8_t* data, size_t size, uint64_t& value) {
+    constexpr size_t MAX_VARINT_SIZE = 10;
+    value = 0;
+    for (size_t i = 0; i < size && i < MAX_VARINT_SIZE; ++i) {
+        value |= static_cast<uint64_t>(data[i] & 0x7F) << (7 * i);
+        if ((data[i] & 0x80) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+void Utils::serializeValue(const Value& value, std::vector<uint8_t>& buffer, bool varint_length)
+{
+    std::visit([&buffer, varint_length](const auto& val) {
+        using T = std::decay_t<decltype(val)>;
+        if constexpr (SupportedTrivial<T>) {
+            serializeLE(val, buffer);
+        }
+        else if constexpr (SupportedBlob<T>) {
+            sst::datablock::ValueLengthFieldType value_len = val.size() * sizeof(typename T::value_type);
+            if (varint_length) {
+                serializeVarint(value_len, buffer);
+            }
+            else {
+                serializeLE(value_len, buffer);
+            }
+            buffer.insert(buffer.end(), val.begin(), val.end());
+        }
+        else {
+            static_assert(always_false<T>::value, "Unsupported type for serialization");
+        }
+        }, value);
+}
+
+size_t Utils::deserializeValueLength(const uint8_t* data, size_t size, uint64_t& value_len, bool varint_length) {
+    size_t len_size = sst::datablock::VALUE_LEN_SIZE;
+    if (varint_length) {
+        len_size = deserializeVarint(data, size, value_len);
+        if (len_size == 0) {
+            throw std::runtime_error("Value corrupted: Value length exceeds data bounds.");
+        }
+    }
+    else {
+        if (size < len_size) {
+            throw std::runtime_error("Value corrupted: Value length exceeds data bounds.");
+        }
+        value_len = deserializeLE<sst::datablock::ValueLengthFieldType>(data);
+    }
+    if (value_len > size - len_size) {
+        throw std::runtime_error("Value corrupted: Value length exceeds data bounds.");
+    }
+    return len_size;
+}
+
+size_t Utils::serializedValueSize(const RawValue& raw) {
+    switch (raw.type) {
+    case ValueType::STRING:
+    case ValueType::U8STRING:
+    case ValueType::BLOB: {
+        uint64_t value_len = 0;
+        return deserializeValueLength(raw.data, raw.size, value_len, raw.varint_length) + value_len;
+    }
+    default: {
+        size_t consumed = 0;
+        deserializeValue(raw.type, raw.data, raw.size, consumed, raw.varint_length);
+        return consumed;
+    }
+    }
+}
+
+namespace {
+    template <AllSupportedTypes T>
+    Value deserializeTyped(const uint8_t* data, size_t size, size_t& consumed, bool varint_length) {
+        if constexpr (SupportedTrivial<T>) {
+            if (size < sizeof(T)) {
+                throw std::runtime_error("Value corrupted: Value exceeds data bounds.");
+            }
+            consumed = sizeof(T);
+            return Utils::deserializeLE<T>(data);
+        }
+        else {
+            uint64_t value_len = 0;
+            size_t len_size = Utils::deserializeValueLength(data, size, value_len, varint_length);
+            consumed = len_size + value_len;
+            return Utils::deserializeLE<T>(data + len_size, static_cast<sst::datablock::CountFieldType>(value_len));
+        }
+    }
+}
+
+Value Utils::deserializeValue(ValueType type, const uint8_t* data, size_t size, size_t& consumed, bool varint_length)
+{
+    switch (type) {
+    case ValueType::UINT8:
+        return deserializeTyped<uint8_t>(data, size, consumed, varint_length);
+    case ValueType::INT8:
+        return deserializeTyped<int8_t>(data, size, consumed, varint_length);
+    case ValueType::UINT16:
+        return deserializeTyped<uint16_t>(data, size, consumed, varint_length);
+    case ValueType::INT16:
+        return deserializeTyped<int16_t>(data, size, consumed, varint_length);
+    case ValueType::UINT32:
+        return deserializeTyped<uint32_t>(data, size, consumed, varint_length);
+    case ValueType::INT32:
+        return deserializeTyped<int32_t>(data, size, consumed, varint_length);
+    case ValueType::UINT64:
+        return deserializeTyped<uint64_t>(data, size, consumed, varint_length);
+    case ValueType::INT64:
+        return deserializeTyped<int64_t>(data, size, consumed, varint_length);
+    case ValueType::FLOAT:
+        return deserializeTyped<float>(data, size, consumed, varint_length);
+    case ValueType::DOUBLE:
+        return deserializeTyped<double>(data, size, consumed, varint_length);
+    case ValueType::STRING:
+        return deserializeTyped<std::string>(data, size, consumed, varint_length);
+    case ValueType::U8STRING:
+        return deserializeTyped<std::u8string>(data, size, consumed, varint_length);
+    case ValueType::BLOB:
+        return deserializeTyped<std::vector<uint8_t>>(data, size, consumed, varint_length);
+    default:
+        throw std::runtime_error("Value corrupted: Unsupported value type.");
+    }
+}
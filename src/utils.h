@@ -1,10 +1,20 @@
 #pragma once
+#include <bit>
 #include <cstdint>
 #include <chrono>
+#include <string>
+#include <string_view>
+#include <stdexcept>
 #include "types.h"
 namespace Utils {
     uint64_t getNow();
     bool isExpired(uint64_t timestamp);
+    // CRC-32 (IEEE 802.3), pass the previous result as `crc` to continue a running checksum
+    uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+    // Fast non-cryptographic hash (MurmurHash64A), stable across platforms
+    uint64_t hash64(const void* data, size_t size, uint64_t seed = 0);
+    // Shortest string s with previous < s <= next, previous must be less than next
+    std::string shortestSeparator(std::string_view previous, std::string_view next);
 
 
     template <SupportedTrivial T>
@@ -55,6 +65,19 @@ namespace Utils {
         return T(buffer, buffer + size);
     }
 
+    // Unsigned LEB128: 7 bits per byte, low bits first
+    void serializeVarint(uint64_t value, std::vector<uint8_t>& buffer);
+    // Returns the number of bytes read, 0 if the varint is truncated or too long
+    size_t deserializeVarint(const uint8_t* data, size_t size, uint64_t& value);
+    constexpr size_t varintSize(uint64_t value) {
+        size_t size = 1;
+        while (value >= 0x80) {
+            value >>= 7;
+            ++size;
+        }
+        return size;
+    }
+
     template <typename T>
     size_t onDiskSize(const T& value) {
         if constexpr (SupportedInteger<T> || SupportedReal<T>) {
@@ -72,9 +95,56 @@ namespace Utils {
         return std::visit([](const auto& val) { return onDiskSize(val); }, v);
     }
 
+    // Size in compact entries, where ValueLen is a varint
+    inline size_t onDiskSizeVarint(const Value& v) {
+        return std::visit([](const auto& val) -> size_t {
+            if constexpr (SupportedBlob<std::decay_t<decltype(val)>>) {
+                size_t len = val.size() * sizeof(typename std::decay_t<decltype(val)>::value_type);
+                return varintSize(len) + len;
+            }
+            else {
+                return onDiskSize(val);
+            }
+            }, v);
+    }
+
+    // Serializes value in the on-disk format: fixed size types as is, blob-like types prefixed by ValueLen
+    // (4 bytes or a varint)
+    void serializeValue(const Value& value, std::vector<uint8_t>& buffer, bool varint_length = false);
+    // Reads ValueLen of a blob-like value into value_len, returns its size. Throws if the value exceeds `size` bytes.
+    size_t deserializeValueLength(const uint8_t* data, size_t size, uint64_t& value_len, bool varint_length = false);
+    // Decodes value written by serializeValue. `size` is the number of readable bytes,
+    // `consumed` receives the number of bytes occupied by the value. Throws if data is corrupted.
+    Value deserializeValue(ValueType type, const uint8_t* data, size_t size, size_t& consumed, bool varint_length = false);
+
+    // Bytes of the serialized value, without the data following it
+    size_t serializedValueSize(const RawValue& raw);
+
+    // Decodes the value straight into `out`, blob-like values reuse its buffer and may be empty, as in deserializeValue.
+    // Throws std::invalid_argument if the value is of another type.
+    template <AllSupportedTypes T>
+    void deserializeValueInto(const RawValue& raw, T& out) {
+        if (raw.type != valueTypeFromType<T>()) {
+            throw std::invalid_argument("Value type mismatch");
+        }
+        if constexpr (SupportedTrivial<T>) {
+            if (raw.size < sizeof(T)) {
+                throw std::runtime_error("Value corrupted: Value exceeds data bounds.");
+            }
+            out = deserializeLE<T>(raw.data);
+        }
+        else {
+            uint64_t value_len = 0;
+            auto* value = raw.data + deserializeValueLength(raw.data, raw.size, value_len, raw.varint_length);
+            out.assign(value, value + value_len);
+        }
+    }
+
+    // Upper bound for all DataBlock formats. Compact entries are never larger: their varint lengths of
+    // keys (<= 1024 bytes) and blocks (<= 2 MB) take at most 2 and 3 bytes, the expiration is optional.
     template <typename T>
     inline uint32_t onDiskEntrySize(const std::string& key, const T& value) {
         return key.size() + onDiskSize(value) + sst::datablock::MIN_ENTRY_SIZE +
-            sst::datablock::OFFSET_ENTRY_SIZE;
+            sst::datablock::SHARED_LEN_SIZE + sst::datablock::OFFSET_ENTRY_SIZE;
     }
 }
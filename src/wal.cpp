@@ -0,0 +1,269 @@
+#include "wal.h"
+#include "constants.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <regex>
+#include <stdexcept>
+
+namespace dblock = sst::datablock;
+namespace wal = sst::wal;
+
+namespace {
+    constexpr auto segment_prefix = "wal_";
+    constexpr auto segment_extension = ".log";
+
+    struct WalOp {
+        std::string key;
+        Entry entry;
+        uint64_t expiration_ms;
+    };
+
+    // [KeyLen][Key][Expiration][ValueType][Value], same field layout as a DataBlock entry
+    void encodeOp(const std::string& key, const Entry& entry, uint64_t expiration_ms, std::vector<uint8_t>& buffer) {
+        Utils::serializeLE(static_cast<dblock::KeyLengthFieldType>(key.size()), buffer);
+        buffer.insert(buffer.end(), key.begin(), key.end());
+        Utils::serializeLE(static_cast<dblock::ExpirationFieldType>(expiration_ms), buffer);
+        Utils::serializeLE(static_cast<dblock::ValueTypeFieldType>(entry.type), buffer);
+        if (entry.type != ValueType::REMOVED) {
+            Utils::serializeValue(entry.value, buffer);
+        }
+    }
+
+    std::vector<WalOp> decodeOps(const uint8_t* data, size_t size) {
+        if (size < wal::COUNT_SIZE) {
+            throw std::runtime_error("WAL corrupted: Record is too small.");
+        }
+        auto count = Utils::deserializeLE<wal::CountFieldType>(data);
+        size_t pos = wal::COUNT_SIZE;
+        std::vector<WalOp> ops;
+        ops.reserve(count);
+        for (wal::CountFieldType i = 0; i < count; ++i) {
+            if (pos + dblock::MIN_ENTRY_SIZE > size) {
+                throw std::runtime_error("WAL corrupted: Entry exceeds record bounds.");
+            }
+            auto key_len = Utils::deserializeLE<dblock::KeyLengthFieldType>(data + pos);
+            pos += dblock::KEY_LEN_SIZE;
+            if (pos + key_len + dblock::EXPIRATION_SIZE + dblock::VALUE_TYPE_SIZE > size) {
+                throw std::runtime_error("WAL corrupted: Key exceeds record bounds.");
+            }
+            WalOp op;
+            op.key = Utils::deserializeLE<std::string>(data + pos, key_len);
+            pos += key_len;
+            op.expiration_ms = Utils::deserializeLE<dblock::ExpirationFieldType>(data + pos);
+            pos += dblock::EXPIRATION_SIZE;
+            op.entry.type = static_cast<ValueType>(Utils::deserializeLE<dblock::ValueTypeFieldType>(data + pos));
+            pos += dblock::VALUE_TYPE_SIZE;
+            if (op.entry.type != ValueType::REMOVED) {
+                size_t consumed = 0;
+                op.entry.value = Utils::deserializeValue(op.entry.type, data + pos, size - pos, consumed);
+                pos += consumed;
+            }
+            ops.push_back(std::move(op));
+        }
+        return ops;
+    }
+}
+
+WriteAheadLog::WriteAheadLog(const std::filesystem::path& dir, WalSyncMode mode, uint32_t sync_interval_ms)
+    : dir_(dir), mode_(mode), sync_interval_ms_(sync_interval_ms) {
+    auto segments = listSegments();
+    if (!segments.empty()) {
+        segment_id_ = segments.back();
+    }
+    file_ = std::make_unique<AppendableFile>(segmentPath(segment_id_));
+    if (mode_ == WalSyncMode::BATCHED) {
+        sync_thread_ = std::jthread([this](std::stop_token st) { syncLoop(st); });
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    if (sync_thread_.joinable()) {
+        sync_thread_.request_stop();
+        sync_thread_.join();
+    }
+    if (mode_ != WalSyncMode::NONE && synced_lsn_ < last_lsn_) {
+        try {
+            file_->sync();
+        }
+        catch (...) {
+            // nothing we can do in destructor
+        }
+    }
+}
+
+void WriteAheadLog::replay(const ReplayCallback& callback) {
+    std::lock_guard lock(mutex_);
+    auto segments = listSegments();
+    for (auto it = segments.begin(); it != segments.end(); ++it) {
+        auto path = segmentPath(*it);
+        std::vector<uint8_t> data;
+        {
+            std::ifstream in(path, std::ios::binary);
+            data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        size_t pos = 0;
+        while (pos + wal::RECORD_HEADER_SIZE <= data.size()) {
+            auto checksum = Utils::deserializeLE<wal::ChecksumFieldType>(&data[pos]);
+            auto length = Utils::deserializeLE<wal::LengthFieldType>(&data[pos + wal::CHECKSUM_SIZE]);
+            if (length > data.size() - pos - wal::RECORD_HEADER_SIZE) {
+                break; // torn write
+            }
+            if (Utils::crc32(&data[pos + wal::CHECKSUM_SIZE], wal::LENGTH_SIZE + length) != checksum) {
+                break;
+            }
+            std::vector<WalOp> ops;
+            try {
+                ops = decodeOps(&data[pos + wal::RECORD_HEADER_SIZE], length);
+            }
+            catch (const std::runtime_error&) {
+                break;
+            }
+            // record is applied as a whole or not at all
+            ++last_lsn_;
+            for (const auto& op : ops) {
+                callback(last_lsn_, op.key, op.entry, op.expiration_ms);
+            }
+            pos += wal::RECORD_HEADER_SIZE + length;
+        }
+        if (pos == data.size()) {
+            continue;
+        }
+        // Cut the log at the damaged record, otherwise records appended after it
+        // would be applied out of order on the next replay
+        for (auto next = std::next(it); next != segments.end(); ++next) {
+            std::filesystem::remove(segmentPath(*next));
+        }
+        if (*it != segment_id_) {
+            segment_id_ = *it;
+            file_ = std::make_unique<AppendableFile>(path);
+        }
+        file_->truncate(pos);
+        break;
+    }
+    synced_lsn_ = last_lsn_; // Replayed records are on the disk already
+}
+
+uint64_t WriteAheadLog::append(const std::string& key, const Entry& entry, uint64_t expiration_ms) {
+    std::lock_guard lock(mutex_);
+    record_buffer_.resize(wal::RECORD_HEADER_SIZE);
+    Utils::serializeLE(static_cast<wal::CountFieldType>(1), record_buffer_);
+    encodeOp(key, entry, expiration_ms, record_buffer_);
+    return appendRecordLocked();
+}
+
+uint64_t WriteAheadLog::append(std::span<const Operation> operations) {
+    std::lock_guard lock(mutex_);
+    record_buffer_.resize(wal::RECORD_HEADER_SIZE);
+    Utils::serializeLE(static_cast<wal::CountFieldType>(operations.size()), record_buffer_);
+    for (const auto& op : operations) {
+        encodeOp(*op.key, *op.entry, op.expiration_ms, record_buffer_);
+    }
+    return appendRecordLocked();
+}
+
+uint64_t WriteAheadLog::appendRecordLocked() {
+    auto length = static_cast<wal::LengthFieldType>(record_buffer_.size() - wal::RECORD_HEADER_SIZE);
+    std::vector<uint8_t> header;
+    Utils::serializeLE(length, header);
+    std::copy(header.begin(), header.end(), record_buffer_.begin() + wal::CHECKSUM_SIZE);
+    auto checksum = Utils::crc32(record_buffer_.data() + wal::CHECKSUM_SIZE, wal::LENGTH_SIZE + length);
+    header.clear();
+    Utils::serializeLE(checksum, header);
+    std::copy(header.begin(), header.end(), record_buffer_.begin());
+
+    file_->append(record_buffer_.data(), record_buffer_.size());
+    return ++last_lsn_;
+}
+
+void WriteAheadLog::sync(uint64_t lsn) {
+    if (mode_ != WalSyncMode::PER_WRITE) {
+        return;
+    }
+    std::unique_lock lock(mutex_);
+    syncLocked(lock, lsn);
+}
+
+void WriteAheadLog::syncLocked(std::unique_lock<std::mutex>& lock, uint64_t lsn) {
+    while (synced_lsn_ < lsn) {
+        if (sync_in_progress_) {
+            // Somebody else is syncing, its sync might already cover our record
+            synced_cv_.wait(lock);
+            continue;
+        }
+        sync_in_progress_ = true;
+        uint64_t target = last_lsn_;
+        lock.unlock();
+        try {
+            file_->sync();
+        }
+        catch (...) {
+            lock.lock();
+            sync_in_progress_ = false;
+            synced_cv_.notify_all();
+            throw;
+        }
+        lock.lock();
+        sync_in_progress_ = false;
+        synced_lsn_ = std::max(synced_lsn_, target);
+        synced_cv_.notify_all();
+    }
+}
+
+uint64_t WriteAheadLog::rotate() {
+    std::unique_lock lock(mutex_);
+    synced_cv_.wait(lock, [this] { return !sync_in_progress_; });
+    if (mode_ != WalSyncMode::NONE && synced_lsn_ < last_lsn_) {
+        file_->sync();
+    }
+    synced_lsn_ = last_lsn_;
+    synced_cv_.notify_all();
+    auto closed_segment = segment_id_;
+    file_ = std::make_unique<AppendableFile>(segmentPath(++segment_id_));
+    return closed_segment;
+}
+
+void WriteAheadLog::removeSegments(uint64_t segment_id) {
+    std::lock_guard lock(mutex_);
+    for (auto id : listSegments()) {
+        if (id <= segment_id && id != segment_id_) {
+            std::filesystem::remove(segmentPath(id));
+        }
+    }
+}
+
+std::filesystem::path WriteAheadLog::segmentPath(uint64_t segment_id) const {
+    return dir_ / (segment_prefix + std::to_string(segment_id) + segment_extension);
+}
+
+std::vector<uint64_t> WriteAheadLog::listSegments() const {
+    static const std::regex pattern(R"(wal_(\d+)\.log)");
+    std::vector<uint64_t> segments;
+    for (const auto& entry : std::filesystem::directory_iterator(dir_)) {
+        std::smatch match;
+        auto fname = entry.path().filename().string();
+        if (entry.is_regular_file() && std::regex_match(fname, match, pattern)) {
+            segments.push_back(std::stoull(match[1]));
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+void WriteAheadLog::syncLoop(std::stop_token stop_token) {
+    std::unique_lock lock(mutex_);
+    while (!stop_token.stop_requested()) {
+        sync_timer_cv_.wait_for(lock, stop_token, std::chrono::milliseconds(sync_interval_ms_),
+            [&] { return stop_token.stop_requested(); });
+        if (synced_lsn_ < last_lsn_) {
+            try {
+                syncLocked(lock, last_lsn_);
+            }
+            catch (...) {
+                // will retry on the next tick
+            }
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "types.h"
+#include "fileio.h"
+
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Write-ahead log for the MemTable. Every put/remove is appended here before it becomes
+// visible in the MemTable. The log is split into segments (wal_{id}.log), a new segment is
+// started when the MemTable becomes immutable and old segments are removed once it is persisted.
+// Concurrent writers are group committed: one sync covers every record appended before it.
+class WriteAheadLog {
+public:
+    // Operation referenced by a record being appended
+    struct Operation {
+        const std::string* key;
+        const Entry* entry;
+        uint64_t expiration_ms;
+    };
+    using ReplayCallback = std::function<void(uint64_t lsn, const std::string& key, const Entry& entry, uint64_t expiration_ms)>;
+
+    WriteAheadLog(const std::filesystem::path& dir, WalSyncMode mode, uint32_t sync_interval_ms);
+    ~WriteAheadLog();
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+    WriteAheadLog(WriteAheadLog&&) = delete;
+    WriteAheadLog& operator=(WriteAheadLog&&) = delete;
+
+    // Applies all intact records of all segments in log order. Log is cut at the first torn or
+    // corrupted record. Must be called before any append, appended records get sequence
+    // numbers following the replayed ones.
+    void replay(const ReplayCallback& callback);
+    // Appends a record and returns its log sequence number, does not wait for the sync.
+    uint64_t append(const std::string& key, const Entry& entry, uint64_t expiration_ms);
+    // Appends all operations as one record, so they are replayed all or nothing.
+    uint64_t append(std::span<const Operation> operations);
+    // Blocks until the record with given sequence number is durable according to the sync mode.
+    void sync(uint64_t lsn);
+    // Syncs and closes the current segment, starts a new one. Returns id of the closed segment.
+    uint64_t rotate();
+    // Removes segments with id <= segment_id. Called once their records are persisted in SST.
+    void removeSegments(uint64_t segment_id);
+
+    WalSyncMode syncMode() const noexcept {
+        return mode_;
+    }
+
+private:
+    void syncLoop(std::stop_token stop_token);
+    void syncLocked(std::unique_lock<std::mutex>& lock, uint64_t lsn);
+    // Writes header of the record prepared in record_buffer_ and appends it to the file
+    uint64_t appendRecordLocked();
+    std::filesystem::path segmentPath(uint64_t segment_id) const;
+    std::vector<uint64_t> listSegments() const;
+
+    std::filesystem::path dir_;
+    WalSyncMode mode_;
+    uint32_t sync_interval_ms_;
+    uint64_t segment_id_ = 1;
+    std::unique_ptr<AppendableFile> file_;
+
+    std::mutex mutex_;
+    std::condition_variable synced_cv_;
+    std::condition_variable_any sync_timer_cv_;
+    uint64_t last_lsn_ = 0;
+    uint64_t synced_lsn_ = 0;
+    bool sync_in_progress_ = false;
+    std::vector<uint8_t> record_buffer_;
+    std::jthread sync_thread_;
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include "types.h"
+#include "constants.h"
+#include "utils.h"
+
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Group of puts and removes applied by SimpleStorage::write atomically: readers see
+// either all of them or none, after a crash the batch is restored as a whole or not at all.
+// Operations are applied in the order they were added.
+class WriteBatch {
+public:
+    struct Operation {
+        std::string key;
+        Entry entry;
+        uint64_t expiration_ms;
+    };
+
+    template <AllSupportedTypes T>
+    void put(const std::string& key, const T& value, std::optional<uint32_t> ttl_seconds = std::nullopt) {
+        checkKey(key);
+        uint64_t expiration_ms = ttl_seconds.has_value() ?
+            Utils::getNow() + ttl_seconds.value() * 1000ull :
+            sst::datablock::EXPIRATION_NOT_SET;
+        operations_.push_back(Operation{ key, Entry{ valueTypeFromType<T>(), value }, expiration_ms });
+    }
+
+    void remove(const std::string& key) {
+        checkKey(key);
+        operations_.push_back(Operation{ key, Entry{ ValueType::REMOVED, {} }, sst::datablock::EXPIRATION_DELETED });
+    }
+
+    const std::vector<Operation>& operations() const noexcept {
+        return operations_;
+    }
+    size_t count() const noexcept {
+        return operations_.size();
+    }
+    bool empty() const noexcept {
+        return operations_.empty();
+    }
+    void clear() noexcept {
+        operations_.clear();
+    }
+
+private:
+    static void checkKey(const std::string& key) {
+        if (key.empty()) {
+            throw std::invalid_argument("Key cannot be empty");
+        }
+        if (key.size() > sst::datablock::MAX_KEY_LENGTH) {
+            throw std::invalid_argument("Key size exceeds maximum allowed size");
+        }
+    }
+
+    std::vector<Operation> operations_;
+};
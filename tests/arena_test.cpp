@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include "../src/arena.h"
+#include <cstring>
+#include <thread>
+#include <vector>
+
+TEST(ArenaTest, AllocationsDoNotOverlap) {
+    Arena arena(1024);
+    std::vector<std::pair<uint8_t*, size_t>> allocated;
+    for (size_t i = 1; i < 200; ++i) {
+        auto* p = arena.allocate(i, i % 2 ? 1 : 8);
+        if (i % 2 == 0) {
+            EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % 8, 0u);
+        }
+        std::memset(p, static_cast<int>(i), i);
+        allocated.emplace_back(p, i);
+    }
+    for (const auto& [p, size] : allocated) {
+        for (size_t j = 0; j < size; ++j) {
+            ASSERT_EQ(p[j], static_cast<uint8_t>(size));
+        }
+    }
+}
+
+TEST(ArenaTest, MemoryUsageAndReset) {
+    Arena arena(1024);
+    EXPECT_EQ(arena.memoryUsage(), 0u);
+    arena.allocate(10);
+    auto after_first = arena.memoryUsage();
+    EXPECT_GE(after_first, 1024u);
+    arena.allocate(10);
+    EXPECT_EQ(arena.memoryUsage(), after_first); // same block
+    arena.allocate(4000); // large allocation gets its own block
+    EXPECT_GE(arena.memoryUsage(), after_first + 4000);
+    arena.reset();
+    EXPECT_EQ(arena.memoryUsage(), 0u);
+}
+
+TEST(ArenaTest, ConcurrentAllocate) {
+    Arena arena(4096);
+    constexpr int num_threads = 8;
+    constexpr int per_thread = 2000;
+    std::vector<std::thread> threads;
+    std::vector<std::vector<uint64_t*>> results(num_threads);
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < per_thread; ++i) {
+                auto* p = reinterpret_cast<uint64_t*>(arena.allocate(sizeof(uint64_t), alignof(uint64_t)));
+                *p = static_cast<uint64_t>(t) * per_thread + i;
+                results[t].push_back(p);
+            }
+            });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    for (int t = 0; t < num_threads; ++t) {
+        for (int i = 0; i < per_thread; ++i) {
+            ASSERT_EQ(*results[t][i], static_cast<uint64_t>(t) * per_thread + i);
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include "../src/blockcache.h"
+#include <thread>
+#include <vector>
+
+namespace {
+    BlockCache::Block makeBlock(size_t size, uint8_t fill) {
+        return std::make_shared<const std::vector<uint8_t>>(size, fill);
+    }
+}
+
+TEST(BlockCacheTest, LookupCountsHitsAndMisses) {
+    BlockCache cache(1024, 1);
+    EXPECT_EQ(cache.lookup(1, 0), nullptr);
+    cache.insert(1, 0, makeBlock(100, 7));
+    auto block = cache.lookup(1, 0);
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ(block->size(), 100u);
+    EXPECT_EQ((*block)[0], 7);
+    EXPECT_EQ(cache.lookup(2, 0), nullptr); // same offset, other file
+
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.usage_bytes, 100u);
+    EXPECT_EQ(stats.capacity_bytes, 1024u);
+}
+
+TEST(BlockCacheTest, EvictsLeastRecentlyUsed) {
+    BlockCache cache(300, 1);
+    cache.insert(1, 0, makeBlock(100, 0));
+    cache.insert(1, 100, makeBlock(100, 1));
+    cache.insert(1, 200, makeBlock(100, 2));
+    ASSERT_NE(cache.lookup(1, 0), nullptr); // block 0 becomes most recently used
+    cache.insert(1, 300, makeBlock(100, 3));
+
+    EXPECT_NE(cache.lookup(1, 0), nullptr);
+    EXPECT_EQ(cache.lookup(1, 100), nullptr);
+    EXPECT_NE(cache.lookup(1, 200), nullptr);
+    EXPECT_NE(cache.lookup(1, 300), nullptr);
+    EXPECT_LE(cache.stats().usage_bytes, 300u);
+
+    // Block larger than the capacity is not cached
+    cache.insert(1, 400, makeBlock(301, 4));
+    EXPECT_EQ(cache.lookup(1, 400), nullptr);
+    EXPECT_NE(cache.lookup(1, 300), nullptr);
+}
+
+TEST(BlockCacheTest, InsertIfAbsentKeepsCachedBlock) {
+    BlockCache cache(1024, 1);
+    auto first = cache.insertIfAbsent(1, 0, makeBlock(10, 1));
+    EXPECT_EQ((*first)[0], 1);
+    auto second = cache.insertIfAbsent(1, 0, makeBlock(10, 2));
+    EXPECT_EQ(second, first);
+    EXPECT_EQ((*cache.lookup(1, 0))[0], 1);
+    EXPECT_EQ(cache.stats().usage_bytes, 10u);
+
+    // Not cached, the given block is returned
+    auto large = cache.insertIfAbsent(1, 10, makeBlock(2048, 3));
+    EXPECT_EQ(large->size(), 2048u);
+    EXPECT_EQ(cache.lookup(1, 10), nullptr);
+}
+
+TEST(BlockCacheTest, InsertReplacesAndEraseFile) {
+    BlockCache cache(1024, 4);
+    cache.insert(1, 0, makeBlock(10, 1));
+    cache.insert(1, 0, makeBlock(20, 2));
+    cache.insert(1, 10, makeBlock(10, 3));
+    cache.insert(2, 0, makeBlock(10, 4));
+    auto block = cache.lookup(1, 0);
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ((*block)[0], 2);
+    EXPECT_EQ(cache.stats().usage_bytes, 40u);
+
+    cache.eraseFile(1);
+    EXPECT_EQ(cache.lookup(1, 0), nullptr);
+    EXPECT_EQ(cache.lookup(1, 10), nullptr);
+    EXPECT_NE(cache.lookup(2, 0), nullptr);
+    EXPECT_EQ(cache.stats().usage_bytes, 10u);
+    // Evicted block stays valid for its holder
+    EXPECT_EQ((*block)[0], 2);
+
+    cache.setCapacity(0);
+    EXPECT_EQ(cache.stats().usage_bytes, 0u);
+    cache.insert(3, 0, makeBlock(1, 1));
+    EXPECT_EQ(cache.lookup(3, 0), nullptr);
+}
+
+TEST(BlockCacheTest, ConcurrentAccess) {
+    constexpr int THREADS = 4;
+    constexpr int OPS = 20000;
+    BlockCache cache(64 * 100, 4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < OPS; ++i) {
+                uint64_t offset = (i * 7 + t) % 200;
+                if (auto block = cache.lookup(1, offset)) {
+                    ASSERT_EQ((*block)[0], static_cast<uint8_t>(offset));
+                }
+                else {
+                    cache.insert(1, offset, makeBlock(64, static_cast<uint8_t>(offset)));
+                }
+            }
+            });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.hits + stats.misses, static_cast<uint64_t>(THREADS * OPS));
+    EXPECT_LE(stats.usage_bytes, 64u * 100);
+}
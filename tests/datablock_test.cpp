@@ -295,3 +295,197 @@ TEST(DataBlockTest, ForEachKeyWithPrefix_Basic) {
     ASSERT_EQ(first_only.size(), 1u);
     EXPECT_EQ(first_only[0], "pre_a");
 }
+
+TEST(DataBlockTest, SharedBuffer_RemoveCopiesOnWrite) {
+    DataBlockBuilder builder(4096);
+    ASSERT_TRUE(builder.addEntry("a", Entry{ ValueType::UINT32, uint32_t(1) }, 0));
+    ASSERT_TRUE(builder.addEntry("b", Entry{ ValueType::UINT32, uint32_t(2) }, 0));
+    auto buffer = std::make_shared<const std::vector<uint8_t>>(builder.build());
+
+    DataBlock reader(buffer);
+    DataBlock writer(buffer);
+    EXPECT_EQ(reader.data().data(), buffer->data()); // wrapped, not copied
+
+    EXPECT_TRUE(writer.remove("a"));
+    EXPECT_NE(writer.data().data(), buffer->data());
+    EXPECT_EQ(writer.status("a"), EntryStatus::REMOVED);
+    EXPECT_EQ(reader.status("a"), EntryStatus::EXISTS);
+    EXPECT_EQ(DataBlock(buffer).status("a"), EntryStatus::EXISTS);
+}
+
+TEST(DataBlockTest, StringViewKeys) {
+    DataBlockBuilder builder(4096);
+    ASSERT_TRUE(builder.addEntry("key1", Entry{ ValueType::UINT32, uint32_t(1) }, 0));
+    ASSERT_TRUE(builder.addEntry("key12", Entry{ ValueType::UINT32, uint32_t(12) }, 0));
+    ASSERT_TRUE(builder.addEntry("key2", Entry{ ValueType::UINT32, uint32_t(2) }, 0));
+    DataBlock block(builder.build());
+
+    // Views into a longer buffer are not null terminated
+    std::string buffer = "key12345";
+    std::string_view key12(buffer.data(), 5);
+    auto res = block.get(key12);
+    ASSERT_TRUE(res.has_value());
+    EXPECT_EQ(std::get<uint32_t>(res->value), 12u);
+    EXPECT_EQ(block.status(std::string_view(buffer.data(), 4)), EntryStatus::EXISTS);
+    EXPECT_EQ(block.status(std::string_view(buffer.data(), 3)), EntryStatus::NOT_FOUND);
+    EXPECT_EQ(block.keysWithPrefix(std::string_view(buffer.data(), 4), 10).size(), 2u);
+
+    EXPECT_EQ(block.keyAt(1), "key12");
+}
+
+TEST(DataBlockTest, PrefixCompressed_RoundTripAndSize) {
+    // 40 keys with a long shared prefix, more than two restart intervals
+    std::vector<std::string> keys;
+    for (int i = 0; i < 40; ++i) {
+        keys.push_back("tenant/0001/object/" + std::to_string(1000 + i));
+    }
+    DataBlockBuilder plain_builder(8192, sst::header::SST_VERSION_FILTER);
+    DataBlockBuilder builder(8192, sst::header::SST_VERSION_PREFIX);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        Entry entry = i == 7 ? Entry{ ValueType::REMOVED, {} } : Entry{ ValueType::UINT32, uint32_t(i) };
+        ASSERT_TRUE(plain_builder.addEntry(keys[i], entry, 0));
+        ASSERT_TRUE(builder.addEntry(keys[i], entry, 0));
+    }
+    DataBlock plain(plain_builder.build(), sst::header::SST_VERSION_FILTER);
+    DataBlock block(builder.build(), sst::header::SST_VERSION_PREFIX);
+    EXPECT_LT(block.data().size() * 2, plain.data().size());
+    ASSERT_EQ(block.count(), 40u);
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        auto idx = static_cast<sst::datablock::CountFieldType>(i);
+        EXPECT_EQ(block.keyAt(idx), keys[i]);
+        auto [key, value] = block.get(idx);
+        EXPECT_EQ(key, keys[i]);
+        auto res = block.get(keys[i]);
+        ASSERT_TRUE(res.has_value()) << keys[i];
+        if (i == 7) {
+            EXPECT_EQ(res->type, ValueType::REMOVED);
+            EXPECT_EQ(value.entry.type, ValueType::REMOVED);
+        }
+        else {
+            EXPECT_EQ(std::get<uint32_t>(res->value), i);
+            EXPECT_EQ(std::get<uint32_t>(value.entry.value), i);
+        }
+    }
+    EXPECT_FALSE(block.get("tenant/0001/object/0999").has_value());
+    EXPECT_FALSE(block.get("tenant/0001/object/10005").has_value());
+    EXPECT_FALSE(block.get("zzz").has_value());
+    EXPECT_EQ(block.keysWithPrefix("tenant/0001/object/101", 100).size(), 10u);
+    EXPECT_EQ(block.keysWithPrefix("tenant/0001/object/100", 100).size(), 9u); // one removed
+
+    // Removal keeps the value type, so entries after it are still decoded
+    EXPECT_TRUE(block.remove(keys[20]));
+    EXPECT_EQ(block.status(keys[20]), EntryStatus::REMOVED);
+    EXPECT_EQ(block.status(keys[21]), EntryStatus::EXISTS);
+    EXPECT_EQ(std::get<uint32_t>(block.get(keys[21])->value), 21u);
+    size_t all_keys = 0;
+    block.forEachKey([&](std::string_view key) {
+        EXPECT_EQ(key, keys[all_keys]);
+        ++all_keys;
+        });
+    EXPECT_EQ(all_keys, keys.size());
+}
+
+TEST(DataBlockTest, Compact_RoundTripAndSize) {
+    for (uint64_t v : { 0ull, 127ull, 128ull, 300ull, 1ull << 35, ~0ull }) {
+        std::vector<uint8_t> buf;
+        Utils::serializeVarint(v, buf);
+        EXPECT_EQ(buf.size(), Utils::varintSize(v));
+        uint64_t parsed = 0;
+        EXPECT_EQ(Utils::deserializeVarint(buf.data(), buf.size(), parsed), buf.size());
+        EXPECT_EQ(parsed, v);
+        EXPECT_EQ(Utils::deserializeVarint(buf.data(), buf.size() - 1, parsed), 0u); // truncated
+    }
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < 40; ++i) {
+        keys.push_back("tenant/0001/object/" + std::to_string(1000 + i));
+    }
+    const uint64_t far_future = Utils::getNow() + 3600 * 1000;
+    auto entryAt = [](size_t i) {
+        if (i == 7) return Entry{ ValueType::REMOVED, {} };
+        if (i % 5 == 0) return Entry{ ValueType::BLOB, std::vector<uint8_t>(i * 10 + 1, uint8_t(i)) };
+        if (i % 5 == 1) return Entry{ ValueType::STRING, std::string(i, 's') };
+        return Entry{ ValueType::UINT32, uint32_t(i) };
+        };
+    DataBlockBuilder prefix_builder(8192, sst::header::SST_VERSION_PREFIX);
+    DataBlockBuilder builder(8192, sst::header::SST_VERSION_COMPACT);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        uint64_t expiration = i == 9 ? sst::datablock::EXPIRATION_DELETED : (i % 4 == 0 ? far_future : 0);
+        ASSERT_TRUE(prefix_builder.addEntry(keys[i], entryAt(i), expiration));
+        ASSERT_TRUE(builder.addEntry(keys[i], entryAt(i), expiration));
+    }
+    DataBlock prefix(prefix_builder.build(), sst::header::SST_VERSION_PREFIX);
+    DataBlock block(builder.build(), sst::header::SST_VERSION_COMPACT);
+    // No 8-byte expiration on most entries and 1-byte lengths
+    EXPECT_LT(block.data().size() + keys.size() * 8, prefix.data().size());
+    ASSERT_EQ(block.count(), 40u);
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        auto idx = static_cast<sst::datablock::CountFieldType>(i);
+        auto [key, value] = block.get(idx);
+        EXPECT_EQ(key, keys[i]);
+        EXPECT_EQ(value.expiration_ms, i == 9 ? sst::datablock::EXPIRATION_DELETED : (i % 4 == 0 ? far_future : 0));
+        auto res = block.get(keys[i]);
+        ASSERT_TRUE(res.has_value()) << keys[i];
+        if (i == 7 || i == 9) {
+            EXPECT_EQ(res->type, ValueType::REMOVED);
+        }
+        else {
+            auto expected = entryAt(i);
+            EXPECT_EQ(res->type, expected.type);
+            EXPECT_EQ(res->value, expected.value);
+        }
+    }
+    EXPECT_FALSE(block.get("tenant/0001/object/0999").has_value());
+
+    EXPECT_TRUE(block.remove(keys[20]));
+    EXPECT_EQ(block.status(keys[20]), EntryStatus::REMOVED);
+    EXPECT_EQ(block.status(keys[21]), EntryStatus::EXISTS);
+    EXPECT_EQ(std::get<std::string>(block.get(keys[21])->value), std::string(21, 's'));
+    EXPECT_EQ(block.keysWithPrefix("tenant/0001/object/10", 100).size(), 37u); // 7, 9 and 20 removed
+}
+
+TEST(DataBlockTest, HashIndex_PointLookups) {
+    DataBlockBuilder builder(64 * 1024, sst::header::SST_VERSION_COMPACT, true);
+    DataBlockBuilder plain_builder(64 * 1024, sst::header::SST_VERSION_COMPACT);
+    std::vector<std::string> keys;
+    for (int i = 0; i < 500; ++i) {
+        keys.push_back("key_" + std::to_string(10000 + i));
+        ASSERT_TRUE(builder.addEntry(keys.back(), Entry{ ValueType::UINT32, uint32_t(i) }, 0));
+        ASSERT_TRUE(plain_builder.addEntry(keys.back(), Entry{ ValueType::UINT32, uint32_t(i) }, 0));
+    }
+    auto expected_size = builder.size();
+    DataBlock block(builder.build(), sst::header::SST_VERSION_COMPACT);
+    DataBlock plain(plain_builder.build(), sst::header::SST_VERSION_COMPACT);
+    EXPECT_EQ(block.data().size(), expected_size);
+    ASSERT_TRUE(block.hasHashIndex());
+    EXPECT_FALSE(plain.hasHashIndex());
+    ASSERT_EQ(block.count(), 500u);
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        auto res = block.get(keys[i]);
+        ASSERT_TRUE(res.has_value()) << keys[i];
+        EXPECT_EQ(std::get<uint32_t>(res->value), i);
+        EXPECT_EQ(block.keyAt(static_cast<sst::datablock::CountFieldType>(i)), keys[i]);
+    }
+    for (int i = 0; i < 500; ++i) {
+        auto missing = "key_" + std::to_string(10000 + i) + "_";
+        EXPECT_FALSE(block.get(missing).has_value());
+        EXPECT_EQ(block.status(missing), EntryStatus::NOT_FOUND);
+    }
+    EXPECT_FALSE(block.get("a").has_value());
+    EXPECT_FALSE(block.get("z").has_value());
+    // Prefix scans still use the restart table
+    EXPECT_EQ(block.keysWithPrefix("key_102", 1000).size(), 100u);
+
+    EXPECT_TRUE(block.remove(keys[17]));
+    EXPECT_EQ(block.status(keys[17]), EntryStatus::REMOVED);
+    EXPECT_TRUE(block.hasHashIndex());
+    EXPECT_EQ(block.status(keys[18]), EntryStatus::EXISTS);
+
+    // Older formats are written without the index
+    DataBlockBuilder old_builder(4096, sst::header::SST_VERSION_PREFIX, true);
+    ASSERT_TRUE(old_builder.addEntry("a", Entry{ ValueType::UINT32, uint32_t(1) }, 0));
+    EXPECT_FALSE(DataBlock(old_builder.build(), sst::header::SST_VERSION_PREFIX).hasHashIndex());
+}
@@ -46,6 +46,25 @@ TEST_F(GeneralLevelTest, KeyBetweenRanges_NoSSTReturned) {
     EXPECT_FALSE(level.get("bbb").has_value());
 }
 
+TEST_F(GeneralLevelTest, OpeningReadsKeyRangesOnly) {
+    for (int f = 0; f < 4; ++f) {
+        std::vector<std::pair<std::string, TestEntry>> items;
+        for (int i = 0; i < 100; ++i) {
+            items.push_back({ "f" + std::to_string(f) + ":" + std::to_string(1000 + i), TestEntry{Entry{ValueType::UINT32, uint32_t(i)}, 0} });
+        }
+        SSTFile::writeAndCreate(dir / ("file" + std::to_string(f) + ".vsst"), 4096, f + 1, true, items.begin(), items.end());
+    }
+    auto opens = TableCache::instance().stats().opens;
+    GeneralLevel level(dir, 1 << 20, 10, true);
+    auto copy = level.clone();
+    EXPECT_EQ(TableCache::instance().stats().opens, opens); // no index was loaded
+
+    auto val = copy->get("f2:1050");
+    ASSERT_TRUE(val.has_value());
+    EXPECT_EQ(std::get<uint32_t>(val->value), 50u);
+    EXPECT_EQ(TableCache::instance().stats().opens, opens + 1); // only the file of the key
+}
+
 TEST_F(GeneralLevelTest, KeyBeforeFirst_NoSSTReturned) {
     std::vector<std::pair<std::string, TestEntry>> items1 = {
         {"aaa", TestEntry{Entry{ValueType::UINT32, uint32_t(1)}, 0}},
@@ -2,6 +2,9 @@
 #include "../src/memtable.h"
 #include "../src/types.h"
 #include <thread>
+#include <atomic>
+#include <algorithm>
+#include <vector>
 using namespace std;
 
 class MemTableTest : public ::testing::Test {
@@ -129,3 +132,97 @@ TEST_F(MemTableTest, ForEachKeyWithPrefix_Basic) {
     ASSERT_EQ(stop.size(), 1u);
     EXPECT_EQ(stop[0], "abc1");
 }
+
+TEST_F(MemTableTest, NewerSequenceNumberWins) {
+    memtable->put("key", Entry{ ValueType::UINT32, uint32_t(2) }, std::numeric_limits<uint64_t>::max(), 10);
+    // Late write with older sequence number must not hide the newer value
+    memtable->put("key", Entry{ ValueType::UINT32, uint32_t(1) }, std::numeric_limits<uint64_t>::max(), 5);
+    auto result = memtable->get("key");
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(std::get<uint32_t>(result->value), 2u);
+
+    EXPECT_FALSE(memtable->remove("missing", 11));
+    EXPECT_TRUE(memtable->remove("key", 11));
+    EXPECT_EQ(memtable->status("key"), EntryStatus::REMOVED);
+    // Writes without sequence number follow the last one
+    memtable->put("key", Entry{ ValueType::UINT32, uint32_t(3) }, std::numeric_limits<uint64_t>::max());
+    EXPECT_EQ(std::get<uint32_t>(memtable->get("key")->value), 3u);
+    EXPECT_EQ(memtable->count(), 1u);
+}
+
+TEST_F(MemTableTest, VisibleSeqNumHidesUnfinishedBatch) {
+    memtable->put("a", Entry{ ValueType::UINT32, uint32_t(1) }, std::numeric_limits<uint64_t>::max(), 1);
+    memtable->setVisibleSeqNum(1);
+    memtable->put("a", Entry{ ValueType::UINT32, uint32_t(2) }, std::numeric_limits<uint64_t>::max(), 2);
+    memtable->put("b", Entry{ ValueType::UINT32, uint32_t(2) }, std::numeric_limits<uint64_t>::max(), 2);
+    // Readers see the state before the batch
+    EXPECT_EQ(std::get<uint32_t>(memtable->get("a")->value), 1u);
+    EXPECT_FALSE(memtable->get("b").has_value());
+    EXPECT_EQ(memtable->keysWithPrefix("", 10).size(), 1u);
+
+    memtable->setVisibleSeqNum(std::numeric_limits<uint64_t>::max());
+    EXPECT_EQ(std::get<uint32_t>(memtable->get("a")->value), 2u);
+    EXPECT_EQ(std::get<uint32_t>(memtable->get("b")->value), 2u);
+}
+
+TEST_F(MemTableTest, IterationIsSorted) {
+    std::vector<std::string> keys = { "m", "b", "z", "a", "k", "c" };
+    for (const auto& key : keys) {
+        memtable->put(key, Entry{ ValueType::UINT8, uint8_t(1) }, std::numeric_limits<uint64_t>::max());
+    }
+    std::sort(keys.begin(), keys.end());
+    std::vector<std::string> iterated;
+    for (auto it = memtable->begin(); it != memtable->end(); ++it) {
+        iterated.push_back((*it).first);
+    }
+    EXPECT_EQ(iterated, keys);
+}
+
+TEST(MemTableConcurrentTest, ConcurrentPutAndGet) {
+    constexpr int num_threads = 8;
+    constexpr int per_thread = 5000;
+    MemTable memtable(512 * 1024 * 1024);
+    std::atomic<uint64_t> seq{ 0 };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < per_thread; ++i) {
+                // Half of the keys are shared between threads
+                auto key = (i % 2 ? "shared_" : "own_" + std::to_string(t) + "_") + std::to_string(i);
+                memtable.put(key, Entry{ ValueType::INT32, int32_t(i) }, std::numeric_limits<uint64_t>::max(), ++seq);
+                auto result = memtable.get(key);
+                ASSERT_TRUE(result.has_value()) << key;
+                EXPECT_EQ(std::get<int32_t>(result->value), i) << key;
+            }
+            });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    EXPECT_EQ(memtable.count(), static_cast<size_t>(num_threads * per_thread / 2 + per_thread / 2));
+    std::string prev;
+    size_t iterated = 0;
+    for (auto it = memtable.begin(); it != memtable.end(); ++it, ++iterated) {
+        EXPECT_LT(prev, (*it).first);
+        prev = (*it).first;
+    }
+    EXPECT_EQ(iterated, memtable.count());
+}
+
+TEST_F(MemTableTest, ClearReleasesArena) {
+    MemTable table(8 * 1024 * 1024);
+    const std::string value(1000, 'v');
+    int i = 0;
+    while (!table.full()) {
+        table.put("key" + std::to_string(i++), Entry{ ValueType::STRING, value }, std::numeric_limits<uint64_t>::max());
+    }
+    // Accounting follows the real memory, so the payload alone must not exceed the limit
+    EXPECT_LE(static_cast<size_t>(i) * value.size(), 8u * 1024 * 1024);
+    EXPECT_EQ(std::get<std::string>(table.get("key0")->value), value);
+    table.clear();
+    EXPECT_FALSE(table.full());
+    EXPECT_EQ(table.count(), 0u);
+    EXPECT_FALSE(table.get("key0").has_value());
+    table.put("key0", Entry{ ValueType::UINT8, uint8_t(1) }, std::numeric_limits<uint64_t>::max());
+    EXPECT_EQ(std::get<uint8_t>(table.get("key0")->value), 1u);
+}
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 #include "../src/simplestorage.h"
+#include "../src/datablock.h"
+#include "../src/sstfile.h"
+#include "../src/levelzero.h"
 #include "test_utils.h"
 #include <filesystem>
 #include <chrono>
@@ -254,3 +257,455 @@ TEST(PerformanceTest, HighLoadMultiThread) {
     SUCCEED();
 }
 
+TEST(PerformanceTest, ThreadScaling) {
+    // Same amount of puts and gets with growing number of threads, MemTable only
+    size_t total_ops = envToSizeT("PERF_SCALING_OPS", 1000000);
+    size_t max_threads = envToSizeT("PERF_THREADS", std::thread::hardware_concurrency());
+    if (max_threads == 0) max_threads = 4;
+
+    Config config;
+    config.memtable_size_bytes = 512 * 1024 * 1024; // no flushes during the measurement
+    config.wal_sync_mode = WalSyncMode::NONE;
+    std::filesystem::path temp_dir = std::filesystem::temp_directory_path() / "perf_scaling_db";
+
+    for (size_t num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+        std::filesystem::remove_all(temp_dir);
+        auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+        std::atomic<size_t> id_counter{ 0 };
+        std::vector<std::thread> workers;
+
+        auto write_start = steady_clock::now();
+        for (size_t t = 0; t < num_threads; ++t) {
+            workers.emplace_back([&]() {
+                for (size_t id = id_counter.fetch_add(1); id < total_ops; id = id_counter.fetch_add(1)) {
+                    db->put(getKeyById(id), uint64_t(id));
+                }
+                });
+        }
+        for (auto& th : workers) {
+            th.join();
+        }
+        double write_seconds = duration<double>(steady_clock::now() - write_start).count();
+
+        workers.clear();
+        id_counter = 0;
+        auto read_start = steady_clock::now();
+        for (size_t t = 0; t < num_threads; ++t) {
+            workers.emplace_back([&]() {
+                for (size_t id = id_counter.fetch_add(1); id < total_ops; id = id_counter.fetch_add(1)) {
+                    volatile auto val = db->get(getKeyById(id));
+                }
+                });
+        }
+        for (auto& th : workers) {
+            th.join();
+        }
+        double read_seconds = duration<double>(steady_clock::now() - read_start).count();
+        std::cout << num_threads << " threads: " << static_cast<uint64_t>(total_ops / write_seconds) << " puts/s, "
+            << static_cast<uint64_t>(total_ops / read_seconds) << " gets/s\n";
+        db.reset();
+    }
+    std::filesystem::remove_all(temp_dir);
+    SUCCEED();
+}
+
+TEST(PerformanceTest, SSTReadScaling) {
+    // Random gets of flushed keys with a block cache much smaller than the data, most gets read the file
+    size_t total_keys = envToSizeT("PERF_SST_KEYS", 500000);
+    size_t total_ops = envToSizeT("PERF_SCALING_OPS", 1000000);
+    size_t max_threads = envToSizeT("PERF_THREADS", std::thread::hardware_concurrency());
+    if (max_threads == 0) max_threads = 4;
+
+    Config config;
+    config.wal_sync_mode = WalSyncMode::NONE;
+    config.block_cache_size_bytes = 1024 * 1024;
+    std::filesystem::path temp_dir = std::filesystem::temp_directory_path() / "perf_sst_read_db";
+    std::filesystem::remove_all(temp_dir);
+    auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+    for (size_t id = 0; id < total_keys; ++id) {
+        db->put(getKeyById(id), uint64_t(id));
+    }
+    db->flush();
+    db->waitAllAsync();
+
+    for (size_t num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+        std::atomic<size_t> op_counter{ 0 };
+        std::vector<std::thread> workers;
+        auto before = db->blockCacheStats();
+        auto start = steady_clock::now();
+        for (size_t t = 0; t < num_threads; ++t) {
+            workers.emplace_back([&, t]() {
+                std::mt19937_64 rng(t);
+                while (op_counter.fetch_add(1) < total_ops) {
+                    volatile auto val = db->get(getKeyById(rng() % total_keys));
+                }
+                });
+        }
+        for (auto& th : workers) {
+            th.join();
+        }
+        double seconds = duration<double>(steady_clock::now() - start).count();
+        auto stats = db->blockCacheStats();
+        std::cout << num_threads << " threads: " << static_cast<uint64_t>(total_ops / seconds) << " gets/s, block cache "
+            << stats.hits - before.hits << " hits / " << stats.misses - before.misses << " misses\n";
+    }
+    db.reset();
+    std::filesystem::remove_all(temp_dir);
+    SUCCEED();
+}
+
+TEST(PerformanceTest, PartitionedIndex) {
+    // Resident index memory and random gets of one large SST file, single-level versus partitioned index
+    size_t total_keys = envToSizeT("PERF_SST_KEYS", 500000);
+    size_t total_ops = envToSizeT("PERF_SCALING_OPS", 1000000);
+    std::vector<std::pair<std::string, DataBlock::DataBlockEntry>> items;
+    items.reserve(total_keys);
+    for (size_t id = 0; id < total_keys; ++id) {
+        items.push_back({ getKeyById(id), DataBlock::DataBlockEntry{ Entry{ ValueType::UINT64, uint64_t(id) }, 0 } });
+    }
+    std::sort(items.begin(), items.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    std::filesystem::path temp_dir = std::filesystem::temp_directory_path() / "perf_partitioned_index";
+    std::filesystem::remove_all(temp_dir);
+    std::filesystem::create_directories(temp_dir);
+
+    for (auto version : { sst::header::SST_VERSION_COMPACT, sst::header::SST_VERSION_PARTITIONED }) {
+        SSTOptions options;
+        options.format_version = version;
+        auto path = temp_dir / ("v" + std::to_string(version) + ".vsst");
+        SSTFile::writeAndCreate(path, 32 * 1024, 1, true, items.begin(), items.end(), options);
+        auto file = SSTFile::readAndCreate(path);
+        std::mt19937_64 rng(1);
+        size_t found = 0;
+        auto start = steady_clock::now();
+        for (size_t i = 0; i < total_ops; ++i) {
+            found += file->get(items[rng() % items.size()].first).has_value();
+        }
+        double seconds = duration<double>(steady_clock::now() - start).count();
+        std::cout << (version == sst::header::SST_VERSION_PARTITIONED ? "partitioned" : "single-level") << " index: "
+            << std::filesystem::file_size(path) / (1024 * 1024) << " MB file, " << file->indexMemoryUsage()
+            << " bytes resident, " << static_cast<uint64_t>(total_ops / seconds) << " gets/s\n";
+        EXPECT_EQ(found, total_ops);
+    }
+    std::filesystem::remove_all(temp_dir);
+}
+
+TEST(PerformanceTest, BatchedReadBackends) {
+    // multiGet batches and prefix scans with the block cache much smaller than the data,
+    // block reads go through io_uring (all at once) or pread (one by one)
+    size_t total_keys = envToSizeT("PERF_SST_KEYS", 500000);
+    size_t total_ops = envToSizeT("PERF_SCALING_OPS", 1000000);
+    size_t batch_size = envToSizeT("PERF_MULTIGET_BATCH", 64);
+    if (batch_size == 0) batch_size = 64;
+
+    Config config;
+    config.wal_sync_mode = WalSyncMode::NONE;
+    config.block_size = 4 * 1024;
+    config.block_cache_size_bytes = 1024 * 1024;
+    std::filesystem::path temp_dir = std::filesystem::temp_directory_path() / "perf_batched_read_db";
+    std::filesystem::remove_all(temp_dir);
+    {
+        SimpleStorage db(temp_dir, config);
+        for (size_t id = 0; id < total_keys; ++id) {
+            db.put(getKeyById(id), uint64_t(id));
+        }
+        db.flush();
+        db.waitAllAsync();
+    }
+
+    for (bool use_io_uring : { false, true }) {
+        config.use_io_uring = use_io_uring;
+        auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+        std::mt19937_64 rng(1);
+        std::vector<std::string> keys(batch_size);
+        size_t found = 0;
+        auto start = steady_clock::now();
+        for (size_t done = 0; done < total_ops; done += batch_size) {
+            for (auto& key : keys) {
+                key = getKeyById(rng() % total_keys);
+            }
+            for (const auto& value : db->multiGet(keys)) {
+                found += value.has_value();
+            }
+        }
+        double multiget_seconds = duration<double>(steady_clock::now() - start).count();
+
+        // 3-letter prefixes hold 676 consecutive keys, about a dozen blocks
+        size_t scans = std::max<size_t>(total_ops / 676, 1);
+        size_t scanned = 0;
+        start = steady_clock::now();
+        for (size_t i = 0; i < scans; ++i) {
+            scanned += db->keysWithPrefix(getStringFromIndex(static_cast<int>(rng() % total_keys)).substr(0, 3), 1000).size();
+        }
+        double scan_seconds = duration<double>(steady_clock::now() - start).count();
+        std::cout << (use_io_uring ? "io_uring: " : "pread:    ")
+            << static_cast<uint64_t>(total_ops / multiget_seconds) << " multiGet keys/s (" << found << " found), "
+            << static_cast<uint64_t>(scanned / scan_seconds) << " scanned keys/s\n";
+        db.reset();
+    }
+    std::filesystem::remove_all(temp_dir);
+    SUCCEED();
+}
+
+TEST(PerformanceTest, DataBlockLookups) {
+    // Point lookups in one 32 KB block with full keys: binary search over in-place key views
+    // versus a search which copies every probed key into a std::string
+    size_t total_ops = envToSizeT("PERF_SCALING_OPS", 1000000);
+    DataBlockBuilder builder(32 * 1024, sst::header::SST_VERSION_FILTER);
+    std::vector<std::string> keys;
+    for (size_t id = 0;; ++id) {
+        auto key = getStringFromIndex(static_cast<int>(id)) + pseudo_random_string(id, 20);
+        if (!builder.addEntry(key, Entry{ ValueType::UINT64, uint64_t(id) }, 0)) {
+            break;
+        }
+        keys.push_back(std::move(key));
+    }
+    DataBlock block(builder.build(), sst::header::SST_VERSION_FILTER);
+
+    std::mt19937_64 rng(1);
+    size_t found = 0;
+    auto start = steady_clock::now();
+    for (size_t i = 0; i < total_ops; ++i) {
+        found += block.get(keys[rng() % keys.size()]).has_value();
+    }
+    double view_seconds = duration<double>(steady_clock::now() - start).count();
+
+    size_t copied_found = 0;
+    start = steady_clock::now();
+    for (size_t i = 0; i < total_ops; ++i) {
+        const auto& key = keys[rng() % keys.size()];
+        sst::datablock::CountFieldType left = 0, right = block.count();
+        while (left < right) {
+            auto mid = left + (right - left) / 2;
+            if (key <= std::string(block.keyAt(mid))) {
+                right = mid;
+            }
+            else {
+                left = mid + 1;
+            }
+        }
+        copied_found += left < block.count() && std::string(block.keyAt(left)) == key;
+    }
+    double copy_seconds = duration<double>(steady_clock::now() - start).count();
+
+    // Same keys in a prefix-compressed block: binary search over restart points, then a short scan
+    DataBlockBuilder compressed_builder(32 * 1024, sst::header::SST_VERSION_PREFIX);
+    for (size_t id = 0; id < keys.size(); ++id) {
+        compressed_builder.addEntry(keys[id], Entry{ ValueType::UINT64, uint64_t(id) }, 0);
+    }
+    DataBlock compressed(compressed_builder.build(), sst::header::SST_VERSION_PREFIX);
+    size_t compressed_found = 0;
+    start = steady_clock::now();
+    for (size_t i = 0; i < total_ops; ++i) {
+        compressed_found += compressed.get(keys[rng() % keys.size()]).has_value();
+    }
+    double compressed_seconds = duration<double>(steady_clock::now() - start).count();
+
+    std::cout << keys.size() << " keys per block: " << static_cast<uint64_t>(total_ops / view_seconds)
+        << " lookups/s with key views, " << static_cast<uint64_t>(total_ops / copy_seconds)
+        << " searches/s copying probed keys\n"
+        << "prefix-compressed block of the same keys: " << compressed.data().size() << " bytes, "
+        << static_cast<uint64_t>(total_ops / compressed_seconds) << " lookups/s\n";
+    EXPECT_EQ(found, total_ops);
+    EXPECT_EQ(copied_found, total_ops);
+    EXPECT_EQ(compressed_found, total_ops);
+}
+
+TEST(PerformanceTest, DataBlockHashIndex) {
+    // Point lookups in one large block: binary search over restart points versus the hash index
+    size_t total_ops = envToSizeT("PERF_SCALING_OPS", 1000000);
+    uint32_t block_size = static_cast<uint32_t>(envToSizeT("PERF_BLOCK_SIZE", 256 * 1024));
+    DataBlockBuilder builder(block_size, sst::header::SST_VERSION);
+    DataBlockBuilder hash_builder(block_size, sst::header::SST_VERSION, true);
+    std::vector<std::string> keys;
+    for (size_t id = 0;; ++id) {
+        auto key = getStringFromIndex(static_cast<int>(id)) + pseudo_random_string(id, 20);
+        Entry entry{ ValueType::UINT64, uint64_t(id) };
+        if (!hash_builder.addEntry(key, entry, 0)) {
+            break;
+        }
+        builder.addEntry(key, entry, 0);
+        keys.push_back(std::move(key));
+    }
+    DataBlock block(builder.build());
+    DataBlock hash_block(hash_builder.build());
+
+    auto measure = [&](const DataBlock& b, bool hits, size_t& found) {
+        std::mt19937_64 rng(1);
+        std::string missing;
+        auto start = steady_clock::now();
+        for (size_t i = 0; i < total_ops; ++i) {
+            const auto& key = keys[rng() % keys.size()];
+            if (hits) {
+                found += b.get(key).has_value();
+            }
+            else {
+                missing.assign(key).push_back('~');
+                found += b.get(missing).has_value();
+            }
+        }
+        return total_ops / duration<double>(steady_clock::now() - start).count();
+    };
+    size_t found = 0, hash_found = 0, missed = 0, hash_missed = 0;
+    double search_hits = measure(block, true, found);
+    double hash_hits = measure(hash_block, true, hash_found);
+    double search_misses = measure(block, false, missed);
+    double hash_misses = measure(hash_block, false, hash_missed);
+
+    std::cout << keys.size() << " keys in a " << block_size / 1024 << " KB block, "
+        << block.data().size() << " bytes, with hash index " << hash_block.data().size() << " bytes\n"
+        << "hits: " << static_cast<uint64_t>(search_hits) << " lookups/s binary search, "
+        << static_cast<uint64_t>(hash_hits) << " lookups/s hash index\n"
+        << "misses: " << static_cast<uint64_t>(search_misses) << " lookups/s binary search, "
+        << static_cast<uint64_t>(hash_misses) << " lookups/s hash index\n";
+    EXPECT_TRUE(hash_block.hasHashIndex());
+    EXPECT_EQ(found, total_ops);
+    EXPECT_EQ(hash_found, total_ops);
+    EXPECT_EQ(missed, 0u);
+    EXPECT_EQ(hash_missed, 0u);
+}
+
+TEST(PerformanceTest, LevelZeroLookups) {
+    // Random gets in a Level 0 backlog of files: probing every file newest-first versus the interval index,
+    // for files with disjoint key ranges (keys written in order) and with overlapping ones (random keys)
+    size_t num_files = envToSizeT("PERF_L0_FILES", 32);
+    size_t keys_per_file = envToSizeT("PERF_L0_FILE_KEYS", 20000);
+    size_t total_ops = envToSizeT("PERF_SCALING_OPS", 1000000);
+    std::vector<std::string> keys;
+    keys.reserve(num_files * keys_per_file);
+    for (size_t id = 0; id < num_files * keys_per_file; ++id) {
+        keys.push_back(getKeyById(id));
+    }
+    std::sort(keys.begin(), keys.end());
+    std::filesystem::path temp_dir = std::filesystem::temp_directory_path() / "perf_level_zero";
+
+    for (bool disjoint : { true, false }) {
+        std::filesystem::remove_all(temp_dir);
+        std::filesystem::create_directories(temp_dir);
+        LevelZero level(temp_dir / "level0", num_files + 1);
+        std::vector<const SSTFile*> files;
+        for (size_t f = 0; f < num_files; ++f) {
+            std::vector<std::pair<std::string, DataBlock::DataBlockEntry>> items;
+            for (size_t i = 0; i < keys_per_file; ++i) {
+                auto idx = disjoint ? f * keys_per_file + i : i * num_files + f;
+                items.push_back({ keys[idx], DataBlock::DataBlockEntry{ Entry{ ValueType::UINT64, uint64_t(idx) }, 0 } });
+            }
+            std::vector<std::unique_ptr<SSTFile>> ssts;
+            ssts.push_back(SSTFile::writeAndCreate(temp_dir / "tmp.vsst", 32 * 1024, f + 1, true, items.begin(), items.end()));
+            files.push_back(ssts.front().get());
+            level.addSST(std::move(ssts));
+        }
+
+        std::mt19937_64 rng(1);
+        size_t found = 0;
+        auto start = steady_clock::now();
+        for (size_t i = 0; i < total_ops; ++i) {
+            const auto& key = keys[rng() % keys.size()];
+            for (auto it = files.rbegin(); it != files.rend(); ++it) {
+                if ((*it)->get(key).has_value()) {
+                    ++found;
+                    break;
+                }
+            }
+        }
+        double probe_all_seconds = duration<double>(steady_clock::now() - start).count();
+
+        size_t indexed_found = 0;
+        start = steady_clock::now();
+        for (size_t i = 0; i < total_ops; ++i) {
+            indexed_found += level.get(keys[rng() % keys.size()]).has_value();
+        }
+        double indexed_seconds = duration<double>(steady_clock::now() - start).count();
+
+        std::cout << num_files << " Level 0 files with " << (disjoint ? "disjoint" : "overlapping") << " key ranges: "
+            << static_cast<uint64_t>(total_ops / probe_all_seconds) << " gets/s probing every file, "
+            << static_cast<uint64_t>(total_ops / indexed_seconds) << " gets/s with the interval index\n";
+        EXPECT_EQ(found, total_ops);
+        EXPECT_EQ(indexed_found, total_ops);
+    }
+    std::filesystem::remove_all(temp_dir);
+}
+
+TEST(PerformanceTest, TypedGet) {
+    // Random gets of flushed counters and strings: get() building an Entry versus get<T>() and getInto()
+    size_t total_keys = envToSizeT("PERF_SST_KEYS", 200000);
+    size_t total_ops = envToSizeT("PERF_SCALING_OPS", 1000000);
+    std::filesystem::path temp_dir = std::filesystem::temp_directory_path() / "perf_typed_get";
+    std::filesystem::remove_all(temp_dir);
+    {
+        Config config;
+        config.wal_sync_mode = WalSyncMode::NONE;
+        SimpleStorage storage(temp_dir, config);
+        for (size_t id = 0; id < total_keys; ++id) {
+            storage.put("c" + getKeyById(id), uint64_t(id));
+            storage.put("s" + getKeyById(id), long_value + std::to_string(id));
+        }
+        storage.flush();
+
+        auto measure = [&](char prefix, auto&& read) {
+            std::mt19937_64 rng(1);
+            std::string key;
+            auto start = steady_clock::now();
+            for (size_t i = 0; i < total_ops; ++i) {
+                key.assign(1, prefix).append(getKeyById(rng() % total_keys));
+                read(key);
+            }
+            return static_cast<uint64_t>(total_ops / duration<double>(steady_clock::now() - start).count());
+        };
+        uint64_t sum = 0, typed_sum = 0;
+        size_t length = 0, into_length = 0;
+        auto entry_counters = measure('c', [&](const std::string& key) { sum += std::get<uint64_t>(storage.get(key)->value); });
+        auto typed_counters = measure('c', [&](const std::string& key) { typed_sum += *storage.get<uint64_t>(key); });
+        auto entry_strings = measure('s', [&](const std::string& key) { length += std::get<std::string>(storage.get(key)->value).size(); });
+        std::string value;
+        auto into_strings = measure('s', [&](const std::string& key) { storage.getInto(key, value); into_length += value.size(); });
+
+        std::cout << "uint64_t: " << entry_counters << " gets/s with Entry, " << typed_counters << " gets/s with get<T>()\n"
+            << "std::string: " << entry_strings << " gets/s with Entry, " << into_strings << " gets/s with getInto()\n";
+        EXPECT_EQ(sum, typed_sum);
+        EXPECT_EQ(length, into_length);
+    }
+    std::filesystem::remove_all(temp_dir);
+}
+
+TEST(PerformanceTest, RowCacheHotKeys) {
+    // Random gets where 1% of the keys take 90% of the reads, without and with the row cache
+    size_t total_keys = envToSizeT("PERF_SST_KEYS", 200000);
+    size_t total_ops = envToSizeT("PERF_SCALING_OPS", 1000000);
+    size_t hot_keys = std::max<size_t>(total_keys / 100, 1);
+    std::vector<std::string> keys;
+    keys.reserve(total_keys);
+    for (size_t id = 0; id < total_keys; ++id) {
+        keys.push_back(getKeyById(id));
+    }
+    std::filesystem::path temp_dir = std::filesystem::temp_directory_path() / "perf_row_cache";
+    for (size_t row_cache_size : { size_t(0), size_t(8 * 1024 * 1024) }) {
+        std::filesystem::remove_all(temp_dir);
+        Config config;
+        config.wal_sync_mode = WalSyncMode::NONE;
+        config.row_cache_size_bytes = row_cache_size;
+        SimpleStorage storage(temp_dir, config);
+        for (size_t id = 0; id < total_keys; ++id) {
+            storage.put(keys[id], uint64_t(id));
+        }
+        storage.flush();
+        storage.waitAllAsync();
+        BlockCache::instance().resetStats();
+
+        std::mt19937_64 rng(1);
+        uint64_t sum = 0;
+        auto start = steady_clock::now();
+        for (size_t i = 0; i < total_ops; ++i) {
+            auto r = rng();
+            auto id = r % 10 < 9 ? (r >> 8) % hot_keys : (r >> 8) % total_keys;
+            sum += *storage.get<uint64_t>(keys[id]);
+        }
+        double seconds = duration<double>(steady_clock::now() - start).count();
+        auto block_stats = storage.blockCacheStats();
+        auto row_stats = storage.rowCacheStats();
+        std::cout << "row cache " << row_cache_size / (1024 * 1024) << " MB: " << static_cast<uint64_t>(total_ops / seconds)
+            << " gets/s, row cache hit ratio " << row_stats.hitRatio() << " (" << row_stats.usage_bytes << " bytes), block cache hit ratio "
+            << block_stats.hitRatio() << "\n";
+        EXPECT_GT(sum, 0u);
+    }
+    std::filesystem::remove_all(temp_dir);
+}
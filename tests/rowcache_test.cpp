@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+#include "../src/rowcache.h"
+#include "../src/utils.h"
+
+namespace {
+    RowCache::RowPtr makeRow(uint32_t value, uint64_t expiration_ms = sst::datablock::EXPIRATION_NOT_SET) {
+        auto row = std::make_shared<RowCache::Row>();
+        row->type = ValueType::UINT32;
+        Utils::serializeValue(value, row->value);
+        row->expiration_ms = expiration_ms;
+        return row;
+    }
+}
+
+TEST(RowCacheTest, LookupInsertAndInvalidate) {
+    RowCache cache(64 * 1024, 1);
+    EXPECT_EQ(cache.lookup("key"), nullptr);
+    cache.insert("key", makeRow(7), cache.epoch("key"));
+    cache.insert("missing", std::make_shared<RowCache::Row>(), cache.epoch("missing"));
+
+    auto row = cache.lookup("key");
+    ASSERT_NE(row, nullptr);
+    uint32_t value = 0;
+    Utils::deserializeValueInto(row->raw(), value);
+    EXPECT_EQ(value, 7u);
+    row = cache.lookup("missing");
+    ASSERT_NE(row, nullptr);
+    EXPECT_EQ(row->type, ValueType::REMOVED);
+
+    cache.invalidate("key");
+    EXPECT_EQ(cache.lookup("key"), nullptr);
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 2u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_DOUBLE_EQ(stats.hitRatio(), 0.5);
+}
+
+TEST(RowCacheTest, SkipsRowsReadBeforeInvalidation) {
+    RowCache cache(64 * 1024, 1);
+    auto epoch = cache.epoch("key");
+    cache.invalidate("key"); // concurrent write while the old value was read
+    cache.insert("key", makeRow(1), epoch);
+    EXPECT_EQ(cache.lookup("key"), nullptr);
+
+    cache.insert("key", makeRow(2), cache.epoch("key"));
+    EXPECT_NE(cache.lookup("key"), nullptr);
+}
+
+TEST(RowCacheTest, EvictsLeastRecentlyUsedAndExpired) {
+    const size_t row_size = RowCache::ROW_OVERHEAD + 1 + sizeof(uint32_t);
+    RowCache cache(3 * row_size, 1);
+    for (auto key : { "a", "b", "c" }) {
+        cache.insert(key, makeRow(1), cache.epoch(key));
+    }
+    ASSERT_NE(cache.lookup("a"), nullptr); // "a" becomes most recently used
+    cache.insert("d", makeRow(1), cache.epoch("d"));
+    EXPECT_NE(cache.lookup("a"), nullptr);
+    EXPECT_EQ(cache.lookup("b"), nullptr);
+    EXPECT_LE(cache.stats().usage_bytes, 3 * row_size);
+
+    cache.insert("e", makeRow(1, Utils::getNow() - 1), cache.epoch("e"));
+    EXPECT_EQ(cache.lookup("e"), nullptr);
+}
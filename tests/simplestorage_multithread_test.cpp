@@ -2,9 +2,12 @@
 #include "../src/simplestorage.h"
 #include "test_utils.h"
 #include <filesystem>
+#include <chrono>
+#include <iostream>
 #include <latch>
 #include <thread>
 #include <vector>
+#include <optional>
 
 using namespace std;
 
@@ -91,3 +94,84 @@ TEST_F(SimpleStorageMTTest, ConcurrentReadWriteRemove) {
         }
     }
 }
+
+TEST_F(SimpleStorageMTTest, PutGetThroughputByThreadCount) {
+    // Writers share the MemTable, throughput should grow with thread count (up to the core count)
+    const int total_ops = 64000;
+    config.wal_sync_mode = WalSyncMode::NONE;
+    for (int num_threads : { 1, 2, 4, 8 }) {
+        std::filesystem::remove_all(temp_dir);
+        auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+        const int per_thread = total_ops / num_threads;
+        std::vector<std::thread> threads;
+        auto start = std::chrono::steady_clock::now();
+        for (int t = 0; t < num_threads; ++t) {
+            threads.emplace_back([db, t, per_thread]() {
+                for (int i = 0; i < per_thread; ++i) {
+                    std::string key = "tp_" + to_string(t) + "_" + std::to_string(i);
+                    db->put(key, uint64_t(i));
+                    auto val = db->get(key);
+                    ASSERT_TRUE(val.has_value()) << key;
+                    EXPECT_EQ(std::get<uint64_t>(val->value), uint64_t(i)) << key;
+                }
+                });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << num_threads << " threads: " << static_cast<uint64_t>(total_ops / seconds) << " put+get/s\n";
+        for (int t = 0; t < num_threads; ++t) {
+            EXPECT_TRUE(db->exists("tp_" + to_string(t) + "_" + std::to_string(per_thread - 1)));
+        }
+    }
+}
+
+TEST_F(SimpleStorageMTTest, CoalescedWritesKeepLogOrder) {
+    // Writers are grouped by the leader, the value seen after the writes must be
+    // the same one the WAL restores
+    const int num_threads = 8;
+    const int ops_per_thread = 2000;
+    config.wal_sync_mode = WalSyncMode::PER_WRITE;
+    std::vector<std::optional<Entry>> before(10);
+    {
+        auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; ++t) {
+            threads.emplace_back([db, t]() {
+                for (int i = 0; i < ops_per_thread; ++i) {
+                    std::string key = "hot_" + std::to_string(i % 10);
+                    if (i % 7 == 0) {
+                        WriteBatch batch;
+                        batch.put(key, uint32_t(t * ops_per_thread + i));
+                        batch.put("own_" + to_string(t), uint32_t(i));
+                        db->write(batch);
+                    }
+                    else if (i % 11 == 0) {
+                        db->remove(key);
+                    }
+                    else {
+                        db->put(key, uint32_t(t * ops_per_thread + i));
+                    }
+                }
+                });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+        for (int k = 0; k < 10; ++k) {
+            before[k] = db->get("hot_" + std::to_string(k));
+        }
+    }
+    auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+    for (int k = 0; k < 10; ++k) {
+        auto after = db->get("hot_" + std::to_string(k));
+        ASSERT_EQ(before[k].has_value(), after.has_value()) << k;
+        if (after.has_value()) {
+            EXPECT_EQ(before[k]->value, after->value) << k;
+        }
+    }
+    for (int t = 0; t < num_threads; ++t) {
+        EXPECT_TRUE(db->exists("own_" + to_string(t)));
+    }
+}
@@ -2,6 +2,8 @@
 #include "../src/simplestorage.h"
 #include <filesystem>
 #include <fstream>
+#include <atomic>
+#include <thread>
 
 using namespace std;
 
@@ -59,6 +61,108 @@ TEST_F(SimpleStorageTest, PutAndGet_String) {
     EXPECT_EQ(std::get<std::u8string>(result->value), value);
 }
 
+TEST_F(SimpleStorageTest, TypedGet_MemTableAndSST) {
+    auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+    db->put("counter", uint64_t(42));
+    db->put("name", std::string("value"));
+    db->put("blob", std::vector<uint8_t>{ 1, 2, 3 });
+    db->put("removed", uint64_t(1));
+    db->remove("removed");
+
+    for (int pass = 0; pass < 2; ++pass) {
+        SCOPED_TRACE(pass == 0 ? "MemTable" : "SST");
+        EXPECT_EQ(db->get<uint64_t>("counter"), 42u);
+        EXPECT_EQ(db->get<std::string>("name"), "value");
+        EXPECT_EQ(db->get<std::vector<uint8_t>>("blob"), (std::vector<uint8_t>{ 1, 2, 3 }));
+        EXPECT_FALSE(db->get<uint64_t>("removed").has_value());
+        EXPECT_FALSE(db->get<uint64_t>("missing").has_value());
+        EXPECT_THROW(db->get<uint32_t>("counter"), std::invalid_argument);
+        EXPECT_THROW(db->get<std::u8string>("name"), std::invalid_argument);
+
+        std::string out = "previous longer content";
+        EXPECT_TRUE(db->getInto("name", out));
+        EXPECT_EQ(out, "value");
+        EXPECT_FALSE(db->getInto("missing", out));
+        EXPECT_EQ(out, "value");
+        db->flush();
+    }
+}
+
+TEST_F(SimpleStorageTest, TypedGet_EmptyValuesMatchGet) {
+    auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+    db->put("string", std::string());
+    db->put("blob", std::vector<uint8_t>());
+    for (int pass = 0; pass < 2; ++pass) {
+        SCOPED_TRACE(pass == 0 ? "MemTable" : "SST");
+        EXPECT_EQ(db->get<std::string>("string"), std::string());
+        EXPECT_EQ(std::get<std::string>(db->get("string")->value), std::string());
+        EXPECT_EQ(db->get<std::vector<uint8_t>>("blob"), std::vector<uint8_t>());
+        std::string out = "previous content";
+        EXPECT_TRUE(db->getInto("string", out));
+        EXPECT_TRUE(out.empty());
+        db->flush();
+    }
+}
+
+TEST_F(SimpleStorageTest, RowCache_InvalidatedByWrites) {
+    config.row_cache_size_bytes = 1024 * 1024;
+    auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+    db->put("hot", uint64_t(1));
+    EXPECT_EQ(db->get<uint64_t>("hot"), 1u);
+    EXPECT_EQ(db->get<uint64_t>("hot"), 1u);
+    EXPECT_FALSE(db->get("cold").has_value());
+    EXPECT_FALSE(db->get("cold").has_value()); // missing keys are cached too
+    auto stats = db->rowCacheStats();
+    EXPECT_EQ(stats.hits, 2u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_GT(stats.usage_bytes, 0u);
+
+    db->put("hot", uint64_t(2));
+    db->put("cold", std::string("now here"));
+    EXPECT_EQ(db->get<uint64_t>("hot"), 2u);
+    EXPECT_EQ(std::get<std::string>(db->get("cold")->value), "now here");
+
+    // Rows read from SST files stay valid after merges, removals drop them
+    db->flush();
+    db->waitAllAsync();
+    EXPECT_EQ(db->get<uint64_t>("hot"), 2u);
+    db->remove("hot");
+    EXPECT_FALSE(db->get<uint64_t>("hot").has_value());
+    WriteBatch batch;
+    batch.put("hot", uint64_t(3));
+    batch.remove("cold");
+    db->write(batch);
+    EXPECT_EQ(db->get<uint64_t>("hot"), 3u);
+    EXPECT_FALSE(db->get("cold").has_value());
+    EXPECT_GT(db->rowCacheStats().hitRatio(), 0.0);
+}
+
+TEST_F(SimpleStorageTest, EmptyValues_SameWithAndWithoutRowCache) {
+    for (size_t row_cache_size : { size_t(0), size_t(1024 * 1024) }) {
+        SCOPED_TRACE(row_cache_size == 0 ? "no row cache" : "row cache");
+        std::filesystem::remove_all(temp_dir);
+        config.row_cache_size_bytes = row_cache_size;
+        auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+        db->put("string", std::string());
+        db->put("u8string", std::u8string());
+        db->put("blob", std::vector<uint8_t>());
+        for (int pass = 0; pass < 2; ++pass) {
+            SCOPED_TRACE(pass == 0 ? "MemTable" : "SST");
+            auto value = db->get("string");
+            ASSERT_TRUE(value.has_value());
+            EXPECT_EQ(std::get<std::string>(value->value), "");
+            value = db->get("u8string");
+            ASSERT_TRUE(value.has_value());
+            EXPECT_EQ(std::get<std::u8string>(value->value), u8"");
+            value = db->get("blob");
+            ASSERT_TRUE(value.has_value());
+            EXPECT_TRUE(std::get<std::vector<uint8_t>>(value->value).empty());
+            db->flush();
+            db->clearCache();
+        }
+    }
+}
+
 TEST_F(SimpleStorageTest, PrefixSearch) {
     auto db = std::make_shared<SimpleStorage>(temp_dir, config);
 
@@ -189,3 +293,332 @@ TEST_F(SimpleStorageTest, ForEachKeyWithPrefix_Basic) {
     ASSERT_EQ(stop.size(), 1u);
     EXPECT_EQ(stop[0], "foo:1");
 }
+
+TEST_F(SimpleStorageTest, ReopenWithoutFlush_RestoresFromWal) {
+    config.wal_sync_mode = WalSyncMode::PER_WRITE;
+    {
+        auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+        db->put("wal:1", uint32_t(1));
+        db->put("wal:2", std::string("two"));
+        db->put("wal:3", uint64_t(3));
+        db->remove("wal:3");
+        db->put("wal:1", uint32_t(11));
+    }
+    // Nothing was flushed, everything must come from the log
+    EXPECT_TRUE(filesystem::is_empty(temp_dir / "level0"));
+    {
+        auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+        auto v = db->get("wal:1");
+        ASSERT_TRUE(v.has_value());
+        EXPECT_EQ(std::get<uint32_t>(v->value), 11u);
+        v = db->get("wal:2");
+        ASSERT_TRUE(v.has_value());
+        EXPECT_EQ(std::get<std::string>(v->value), "two");
+        EXPECT_FALSE(db->exists("wal:3"));
+
+        db->flush();
+        // Segment of the flushed MemTable is dropped, only the new empty one is left
+        EXPECT_FALSE(filesystem::exists(temp_dir / "wal_1.log"));
+        EXPECT_EQ(filesystem::file_size(temp_dir / "wal_2.log"), 0u);
+    }
+    {
+        auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+        auto v = db->get("wal:1");
+        ASSERT_TRUE(v.has_value());
+        EXPECT_EQ(std::get<uint32_t>(v->value), 11u);
+        EXPECT_FALSE(db->exists("wal:3"));
+    }
+}
+
+TEST_F(SimpleStorageTest, ReadsDuringBackgroundFlush) {
+    config.memtable_size_bytes = 8 * 1024 * 1024;
+    auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+    const std::string value(4000, 'v');
+    int count = 0;
+    // Fill a few MemTables, puts switch them to immutable without waiting for the flush
+    for (; count < 6000; ++count) {
+        db->put("bg:" + std::to_string(count), value);
+    }
+    for (int i = 0; i < count; i += 97) {
+        auto v = db->get("bg:" + std::to_string(i));
+        ASSERT_TRUE(v.has_value()) << i;
+        EXPECT_EQ(std::get<std::string>(v->value), value);
+    }
+    db->flush();
+    db->waitAllAsync();
+    for (int i = 0; i < count; i += 97) {
+        EXPECT_TRUE(db->exists("bg:" + std::to_string(i))) << i;
+    }
+}
+
+TEST_F(SimpleStorageTest, BlockCache_CountsHits) {
+    auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+    for (int i = 0; i < 1000; ++i) {
+        db->put("bc:" + std::to_string(i), std::string(100, 'x'));
+    }
+    db->flush();
+    db->waitAllAsync();
+    db->clearCache();
+    auto before = db->blockCacheStats();
+    ASSERT_TRUE(db->get("bc:1").has_value());
+    auto after_miss = db->blockCacheStats();
+    EXPECT_GT(after_miss.misses, before.misses);
+    ASSERT_TRUE(db->get("bc:1").has_value());
+    auto after_hit = db->blockCacheStats();
+    EXPECT_GT(after_hit.hits, after_miss.hits);
+    EXPECT_EQ(after_hit.misses, after_miss.misses);
+    EXPECT_GT(after_hit.usage_bytes, 0u);
+}
+
+TEST_F(SimpleStorageTest, CacheCapacitiesSetByFirstOpenStorage) {
+    auto other_dir = temp_dir.string() + "_other";
+    std::filesystem::remove_all(other_dir);
+    config.block_cache_size_bytes = 1024 * 1024;
+    config.max_open_files = 10;
+    {
+        auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+        EXPECT_EQ(db->blockCacheStats().capacity_bytes, 1024u * 1024);
+        EXPECT_EQ(db->tableCacheStats().capacity, 10u);
+        Config other_config;
+        other_config.block_cache_size_bytes = 0;
+        other_config.max_open_files = 1;
+        auto other = std::make_shared<SimpleStorage>(other_dir, other_config);
+        EXPECT_EQ(db->blockCacheStats().capacity_bytes, 1024u * 1024);
+        EXPECT_EQ(db->tableCacheStats().capacity, 10u);
+    }
+    // No storage is open, the next one sets the capacity again
+    config.block_cache_size_bytes = sst::cache::DEFAULT_BLOCK_CACHE_SIZE;
+    config.max_open_files = sst::cache::DEFAULT_MAX_OPEN_FILES;
+    auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+    EXPECT_EQ(db->blockCacheStats().capacity_bytes, sst::cache::DEFAULT_BLOCK_CACHE_SIZE);
+    EXPECT_EQ(db->tableCacheStats().capacity, sst::cache::DEFAULT_MAX_OPEN_FILES);
+    std::filesystem::remove_all(other_dir);
+}
+
+TEST_F(SimpleStorageTest, MmapReads) {
+    config.use_mmap = true;
+    config.memtable_size_bytes = 4 * 1024 * 1024;
+    {
+        auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+        const std::string value(1000, 'm');
+        for (int i = 0; i < 20000; ++i) {
+            db->put("mm:" + std::to_string(i), value);
+        }
+        db->flush();
+        db->waitAllAsync();
+        db->remove("mm:7");
+        db->removeAsync("mm:8");
+        db->waitAllAsync();
+        EXPECT_FALSE(db->exists("mm:7"));
+        EXPECT_FALSE(db->exists("mm:8"));
+        for (int i = 10; i < 20000; i += 101) {
+            auto v = db->get("mm:" + std::to_string(i));
+            ASSERT_TRUE(v.has_value()) << i;
+            EXPECT_EQ(std::get<std::string>(v->value), value);
+        }
+    }
+    auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+    EXPECT_FALSE(db->exists("mm:8"));
+    EXPECT_TRUE(db->exists("mm:1999"));
+    EXPECT_TRUE(db->exists("mm:19999"));
+}
+
+TEST_F(SimpleStorageTest, MultiGet_AllLevels) {
+    config.memtable_size_bytes = 4 * 1024 * 1024;
+    auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+    const std::string value(500, 'g');
+    for (int i = 0; i < 20000; ++i) {
+        db->put("mg:" + std::to_string(i), value + std::to_string(i));
+    }
+    db->flush();
+    db->waitAllAsync();
+    db->put("mg:5", std::string("memtable"));
+    db->remove("mg:6");
+    db->removeAsync("mg:7");
+    db->waitAllAsync();
+
+    std::vector<std::string> keys = { "mg:19999", "mg:5", "missing", "mg:6", "mg:7", "mg:100", "mg:5", "mg:1" };
+    for (int i = 0; i < 300; ++i) {
+        keys.push_back("mg:" + std::to_string((i * 7919) % 20000));
+    }
+    auto results = db->multiGet(keys);
+    ASSERT_EQ(results.size(), keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        EXPECT_EQ(results[i].has_value(), db->get(keys[i]).has_value()) << keys[i];
+        if (results[i]) {
+            EXPECT_EQ(results[i]->value, db->get(keys[i])->value) << keys[i];
+        }
+    }
+    EXPECT_EQ(std::get<std::string>(results[1]->value), "memtable");
+    EXPECT_EQ(std::get<std::string>(results[0]->value), value + "19999");
+    EXPECT_FALSE(results[2].has_value());
+    EXPECT_FALSE(results[3].has_value());
+    EXPECT_FALSE(results[4].has_value());
+    EXPECT_TRUE(db->multiGet({}).empty());
+}
+
+TEST_F(SimpleStorageTest, WriteBatch_AppliedAsWhole) {
+    {
+        auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+        db->put("batch:old", uint32_t(1));
+        WriteBatch batch;
+        batch.put("batch:u32", uint32_t(7));
+        batch.put("batch:str", std::string("text"), 3600);
+        batch.put("batch:blob", std::vector<uint8_t>{ 1, 2 });
+        batch.put("batch:u32", uint32_t(8)); // later operation wins
+        batch.remove("batch:old");
+        EXPECT_EQ(batch.count(), 5u);
+        db->write(batch);
+
+        EXPECT_EQ(std::get<uint32_t>(db->get("batch:u32")->value), 8u);
+        EXPECT_EQ(std::get<std::string>(db->get("batch:str")->value), "text");
+        EXPECT_FALSE(db->exists("batch:old"));
+
+        // Oversized entry rejects the whole batch
+        WriteBatch bad;
+        bad.put("batch:ok", uint8_t(1));
+        bad.put("batch:big", std::string(config.block_size, 'x'));
+        EXPECT_THROW(db->write(bad), std::invalid_argument);
+        EXPECT_FALSE(db->exists("batch:ok"));
+        EXPECT_THROW(bad.put("", uint8_t(1)), std::invalid_argument);
+    }
+    // Restored from the WAL
+    auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+    EXPECT_EQ(std::get<uint32_t>(db->get("batch:u32")->value), 8u);
+    EXPECT_EQ(std::get<std::vector<uint8_t>>(db->get("batch:blob")->value), std::vector<uint8_t>({ 1, 2 }));
+    EXPECT_FALSE(db->exists("batch:old"));
+}
+
+TEST_F(SimpleStorageTest, WriteBatch_ReadersSeeAllOrNothing) {
+    auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+    constexpr int batch_size = 50;
+    std::atomic<bool> done{ false };
+    std::thread writer([&]() {
+        for (uint32_t round = 1; round <= 200; ++round) {
+            WriteBatch batch;
+            for (int i = 0; i < batch_size; ++i) {
+                batch.put("atomic:" + std::to_string(i), round);
+            }
+            db->write(batch);
+        }
+        done = true;
+        });
+    while (!done) {
+        // Last key of the batch is never older than the first one
+        auto first = db->get("atomic:0");
+        auto last = db->get("atomic:" + std::to_string(batch_size - 1));
+        if (first.has_value()) {
+            ASSERT_TRUE(last.has_value());
+            EXPECT_GE(std::get<uint32_t>(last->value), std::get<uint32_t>(first->value));
+        }
+    }
+    writer.join();
+}
+
+TEST_F(SimpleStorageTest, HashIndex_LargestEntryFlushes) {
+    config.block_size = sst::MIN_BLOCK_SIZE;
+    config.datablock_hash_index = true;
+    auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+    for (size_t key_size : { size_t(10), size_t(1000) }) {
+        SCOPED_TRACE(key_size);
+        std::string key(key_size, 'k');
+        // Largest blob put() accepts
+        std::vector<uint8_t> value(config.block_size, 1);
+        while (true) {
+            try {
+                db->put(key, value, 3600);
+                break;
+            }
+            catch (const std::invalid_argument&) {
+                value.pop_back();
+            }
+        }
+        ASSERT_FALSE(value.empty());
+        EXPECT_NO_THROW(db->flush());
+        EXPECT_EQ(db->get<std::vector<uint8_t>>(key), value);
+    }
+}
+
+TEST_F(SimpleStorageTest, WriteBatch_MultiGetSeesAllOrNothing) {
+    auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+    constexpr int batch_size = 200;
+    std::vector<std::string> keys;
+    for (int i = 0; i < batch_size; ++i) {
+        keys.push_back("atomic:" + std::to_string(i));
+    }
+    std::atomic<bool> done{ false };
+    std::thread writer([&]() {
+        for (uint32_t round = 1; round <= 500; ++round) {
+            WriteBatch batch;
+            for (const auto& key : keys) {
+                batch.put(key, round);
+            }
+            db->write(batch);
+        }
+        done = true;
+        });
+    while (!done) {
+        // All keys of one read come from the same batch
+        auto results = db->multiGet(keys);
+        if (!results[0].has_value()) {
+            for (const auto& result : results) {
+                ASSERT_FALSE(result.has_value());
+            }
+            continue;
+        }
+        auto round = std::get<uint32_t>(results[0]->value);
+        for (const auto& result : results) {
+            ASSERT_TRUE(result.has_value());
+            ASSERT_EQ(std::get<uint32_t>(result->value), round);
+        }
+    }
+    writer.join();
+}
+
+TEST_F(SimpleStorageTest, RemoveAsync_ConcurrentReadersDontRestoreKeys) {
+    config.l0_max_files = 2;
+    config.row_cache_size_bytes = 1024 * 1024;
+    auto db = std::make_shared<SimpleStorage>(temp_dir, config);
+    constexpr int count = 2000;
+    for (int i = 0; i < count; ++i) {
+        db->put("rm:" + std::to_string(i), std::string(100, 'x'));
+    }
+    db->flush();
+    db->waitAllAsync();
+
+    // Readers keep missing the caches while the removals patch the file
+    std::atomic<bool> done{ false };
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&, t]() {
+            for (int i = t; !done; i = (i + 7) % count) {
+                db->get("rm:" + std::to_string(i));
+                if (i % 64 == 0) {
+                    db->clearCache();
+                }
+            }
+            });
+    }
+    for (int i = 0; i < count; i += 2) {
+        db->removeAsync("rm:" + std::to_string(i)); // queued, the key is in the SST file only
+    }
+    db->waitAllAsync();
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    for (int i = 0; i < count; i += 2) {
+        EXPECT_FALSE(db->get("rm:" + std::to_string(i)).has_value()) << i;
+    }
+
+    // The merge copies the blocks, removed keys must not come back
+    for (int file = 0; file < 2; ++file) {
+        db->put("other:" + std::to_string(file), uint8_t(1));
+        db->flush();
+    }
+    db->waitAllAsync();
+    db->clearCache();
+    for (int i = 0; i < count; ++i) {
+        EXPECT_EQ(db->get("rm:" + std::to_string(i)).has_value(), i % 2 == 1) << i;
+    }
+}
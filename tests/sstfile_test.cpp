@@ -2,6 +2,8 @@
 #include <filesystem>
 #include <fstream>
 #include <random>
+#include <thread>
+#include <atomic>
 #include "../src/sstfile.h"
 #include "../src/types.h"
 #include "../src/utils.h"
@@ -322,6 +324,374 @@ TEST_F(SSTFileTest, Shrink_RemovesDeletedEntries) {
 }
 
 
+TEST_F(SSTFileTest, BloomFilter_NoFalseNegatives) {
+    constexpr int NUM_KEYS = 5000;
+    std::vector<std::pair<std::string, TestEntry>> items;
+    for (int i = 0; i < NUM_KEYS; ++i) {
+        items.push_back({ "key_" + std::to_string(i), TestEntry{Entry{ValueType::INT32, int32_t(i)}} });
+    }
+    std::sort(items.begin(), items.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    auto file = SSTFile::writeAndCreate(TMP_SST_PATH, BLOCK_SIZE, 0, true, items.begin(), items.end());
+    file.reset();
+    file = SSTFile::readAndCreate(TMP_SST_PATH);
+    for (const auto& [key, entry] : items) {
+        ASSERT_TRUE(file->get(key).has_value()) << key;
+        EXPECT_EQ(file->status(key), EntryStatus::EXISTS);
+    }
+    for (int i = NUM_KEYS; i < 2 * NUM_KEYS; ++i) {
+        EXPECT_FALSE(file->get("key_" + std::to_string(i)).has_value());
+        EXPECT_EQ(file->status("key_" + std::to_string(i)), EntryStatus::NOT_FOUND);
+    }
+}
+
+TEST_F(SSTFileTest, BloomFilter_FalsePositiveRate) {
+    constexpr int NUM_KEYS = 10000;
+    BloomFilterBuilder builder(sst::filter::DEFAULT_BITS_PER_KEY);
+    for (int i = 0; i < NUM_KEYS; ++i) {
+        builder.addKey("key_" + std::to_string(i));
+    }
+    BloomFilter filter(builder.build());
+    int false_positives = 0;
+    for (int i = NUM_KEYS; i < 2 * NUM_KEYS; ++i) {
+        false_positives += filter.mayContain("key_" + std::to_string(i)) ? 1 : 0;
+    }
+    EXPECT_LT(false_positives, NUM_KEYS * 3 / 100); // ~1% expected for 10 bits per key
+}
+
+TEST_F(SSTFileTest, BloomFilter_Disabled) {
+    std::vector<std::pair<std::string, TestEntry>> items = {
+        {"a", TestEntry{Entry{ValueType::STRING, std::string("one")}}},
+        {"b", TestEntry{Entry{ValueType::STRING, std::string("two")}}}
+    };
+    SSTOptions options;
+    options.bloom_bits_per_key = 0;
+    SSTFile::writeAndCreate(TMP_SST_PATH, BLOCK_SIZE, 0, true, items.begin(), items.end(), options);
+    auto file = SSTFile::readAndCreate(TMP_SST_PATH);
+    ASSERT_TRUE(file->get("a").has_value());
+    ASSERT_TRUE(file->get("b").has_value());
+    EXPECT_FALSE(file->get("c").has_value());
+}
+
+TEST_F(SSTFileTest, ReadsVersion1File) {
+    std::vector<std::pair<std::string, TestEntry>> items = {
+        {"a", TestEntry{Entry{ValueType::STRING, std::string("one")}}},
+        {"b", TestEntry{Entry{ValueType::STRING, std::string("two")}}}
+    };
+    SSTOptions options;
+    options.bloom_bits_per_key = 0;
+    options.format_version = sst::header::SST_VERSION_FILTER;
+    SSTFile::writeAndCreate(TMP_SST_PATH, BLOCK_SIZE, 7, true, items.begin(), items.end(), options);
+    // Version 1 is version 2 without the (empty) filter block
+    fs::resize_file(TMP_SST_PATH, fs::file_size(TMP_SST_PATH) - sst::filter::FILTER_SIZE_SIZE);
+    {
+        std::fstream f(TMP_SST_PATH, std::ios::binary | std::ios::in | std::ios::out);
+        f.seekp(sst::header::SST_SIGNATURE_SIZE);
+        f.put(static_cast<char>(sst::header::SST_VERSION_V1));
+    }
+    auto file = SSTFile::readAndCreate(TMP_SST_PATH);
+    EXPECT_EQ(file->seqNum(), 7u);
+    auto v = file->get("b");
+    ASSERT_TRUE(v.has_value());
+    EXPECT_EQ(std::get<std::string>(v->value), "two");
+    EXPECT_FALSE(file->get("c").has_value());
+}
+
+TEST_F(SSTFileTest, MergeReencodesOlderVersion) {
+    std::vector<std::pair<std::string, TestEntry>> old_items, new_items;
+    for (int i = 0; i < 300; ++i) {
+        old_items.push_back({ "a/" + getStringFromIndex(i), TestEntry{Entry{ValueType::UINT32, uint32_t(i)}} });
+        new_items.push_back({ "b/" + getStringFromIndex(i), TestEntry{Entry{ValueType::UINT32, uint32_t(i + 1000)}} });
+    }
+    SSTOptions old_options;
+    old_options.format_version = sst::header::SST_VERSION_FILTER;
+    auto old_path = temp_dir / "old.vsst";
+    auto new_path = temp_dir / "new.vsst";
+    auto old_file = SSTFile::writeAndCreate(old_path, 2048, 1, true, old_items.begin(), old_items.end(), old_options);
+    auto new_file = SSTFile::writeAndCreate(new_path, 2048, 2, true, new_items.begin(), new_items.end());
+    EXPECT_EQ(old_file->version(), sst::header::SST_VERSION_FILTER);
+    EXPECT_EQ(new_file->version(), sst::header::SST_VERSION);
+    EXPECT_LT(fs::file_size(new_path), fs::file_size(old_path));
+
+    // Ranges don't overlap, blocks are copied: raw for the new file, re-encoded for the old one
+    auto merged = SSTFile::merge(old_path, { new_path }, temp_dir2, 1024 * 1024, 2048, true);
+    ASSERT_EQ(merged.size(), 1u);
+    auto file = SSTFile::readAndCreate(merged.front()->path());
+    EXPECT_EQ(file->version(), sst::header::SST_VERSION);
+    EXPECT_EQ(file->minKey(), old_items.front().first);
+    EXPECT_EQ(file->maxKey(), new_items.back().first);
+    for (int i = 0; i < 300; i += 7) {
+        auto v = file->get(old_items[i].first);
+        ASSERT_TRUE(v.has_value()) << old_items[i].first;
+        EXPECT_EQ(std::get<uint32_t>(v->value), uint32_t(i));
+        v = file->get(new_items[i].first);
+        ASSERT_TRUE(v.has_value()) << new_items[i].first;
+        EXPECT_EQ(std::get<uint32_t>(v->value), uint32_t(i + 1000));
+    }
+    size_t count = 0;
+    for (auto it = file->begin(); it != file->end(); ++it) {
+        ++count;
+    }
+    EXPECT_EQ(count, 600u);
+}
+
+TEST_F(SSTFileTest, PartitionedIndex_LoadsPartitionsOnDemand) {
+    std::vector<std::pair<std::string, TestEntry>> items;
+    for (int i = 0; i < 20000; ++i) {
+        items.push_back({ "key/" + getStringFromIndex(i), TestEntry{Entry{ValueType::UINT32, uint32_t(i)}} });
+    }
+    std::sort(items.begin(), items.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    SSTOptions single_level_options;
+    single_level_options.format_version = sst::header::SST_VERSION_COMPACT;
+    auto single_level = SSTFile::writeAndCreate(temp_dir / "single.vsst", 2048, 1, true, items.begin(), items.end(), single_level_options);
+    SSTFile::writeAndCreate(TMP_SST_PATH, 2048, 1, true, items.begin(), items.end());
+
+    for (bool use_mmap : { false, true }) {
+        SSTOptions options;
+        options.use_mmap = use_mmap;
+        auto file = SSTFile::readAndCreate(TMP_SST_PATH, options);
+        ASSERT_EQ(file->version(), sst::header::SST_VERSION);
+        // Only the top-level index stays in memory
+        EXPECT_LT(file->indexMemoryUsage() * 20, single_level->indexMemoryUsage());
+        EXPECT_EQ(file->minKey(), items.front().first);
+        EXPECT_EQ(file->maxKey(), items.back().first);
+
+        for (size_t i = 0; i < items.size(); i += 13) {
+            auto v = file->get(items[i].first);
+            ASSERT_TRUE(v.has_value()) << items[i].first;
+            EXPECT_EQ(v->value, items[i].second.entry.value);
+        }
+        EXPECT_FALSE(file->get("a").has_value());
+        EXPECT_FALSE(file->get("zzz").has_value());
+        EXPECT_EQ(file->status(items[100].first + "_missing"), EntryStatus::NOT_FOUND);
+
+        std::vector<std::string> keys;
+        for (size_t i = 0; i < items.size(); i += 97) {
+            keys.push_back(items[i].first);
+        }
+        keys.push_back("zzz");
+        std::vector<const std::string*> key_ptrs;
+        for (const auto& key : keys) {
+            key_ptrs.push_back(&key);
+        }
+        std::vector<std::optional<Entry>> results(keys.size());
+        file->multiGet(key_ptrs, results);
+        for (size_t i = 0; i + 1 < keys.size(); ++i) {
+            ASSERT_TRUE(results[i].has_value()) << keys[i];
+            EXPECT_EQ(results[i]->value, items[i * 97].second.entry.value);
+        }
+        EXPECT_FALSE(results.back().has_value());
+
+        size_t count = 0;
+        for (auto it = file->begin(); it != file->end(); ++it, ++count) {
+            ASSERT_EQ((*it).first, items[count].first);
+        }
+        EXPECT_EQ(count, items.size());
+        // Prefix scans cross partition boundaries
+        EXPECT_EQ(file->keysWithPrefix("key/", 100000).size(), items.size());
+    }
+
+    auto file = SSTFile::readAndCreate(TMP_SST_PATH);
+    EXPECT_TRUE(file->remove(items[5000].first));
+    EXPECT_EQ(file->status(items[5000].first), EntryStatus::REMOVED);
+    EXPECT_EQ(SSTFile::readAndCreate(TMP_SST_PATH)->status(items[5000].first), EntryStatus::REMOVED);
+}
+
+TEST_F(SSTFileTest, UnsupportedVersion_Throws) {
+    std::vector<std::pair<std::string, TestEntry>> items = {
+        {"a", TestEntry{Entry{ValueType::STRING, std::string("one")}}}
+    };
+    SSTFile::writeAndCreate(TMP_SST_PATH, BLOCK_SIZE, 0, true, items.begin(), items.end());
+    {
+        std::fstream f(TMP_SST_PATH, std::ios::binary | std::ios::in | std::ios::out);
+        f.seekp(sst::header::SST_SIGNATURE_SIZE);
+        f.put(static_cast<char>(sst::header::SST_VERSION + 1));
+    }
+    EXPECT_THROW(SSTFile::readAndCreate(TMP_SST_PATH), std::runtime_error);
+}
+
+
+TEST_F(SSTFileTest, Iterator_UsesCachedBlocks) {
+    std::vector<std::pair<std::string, TestEntry>> items;
+    for (int i = 0; i < 2000; ++i) {
+        items.push_back({ getStringFromIndex(i), TestEntry{Entry{ValueType::UINT32, uint32_t(i)}} });
+    }
+    auto file = SSTFile::writeAndCreate(TMP_SST_PATH, 2048, 0, true, items.begin(), items.end());
+    auto count_entries = [&] {
+        size_t n = 0;
+        for (auto it = file->begin(); it != file->end(); ++it) {
+            ++n;
+        }
+        return n;
+    };
+    EXPECT_EQ(count_entries(), items.size());
+    auto before = BlockCache::instance().stats();
+    EXPECT_EQ(count_entries(), items.size());
+    ASSERT_TRUE(file->get(items[1000].first).has_value());
+    auto after = BlockCache::instance().stats();
+    EXPECT_EQ(after.misses, before.misses);
+    EXPECT_GT(after.hits, before.hits);
+}
+
+TEST_F(SSTFileTest, ConcurrentReads_WithoutCache) {
+    std::vector<std::pair<std::string, TestEntry>> items;
+    for (int i = 0; i < 5000; ++i) {
+        items.push_back({ getStringFromIndex(i), TestEntry{Entry{ValueType::UINT32, uint32_t(i)}} });
+    }
+    auto file = SSTFile::writeAndCreate(TMP_SST_PATH, 2048, 0, true, items.begin(), items.end());
+    auto capacity = BlockCache::instance().stats().capacity_bytes;
+    BlockCache::instance().setCapacity(0); // every get reads the file
+    std::vector<std::thread> threads;
+    std::atomic<int> errors = 0;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t i = t; i < items.size(); i += 3) {
+                auto v = file->get(items[i].first);
+                if (!v || std::get<uint32_t>(v->value) != i) {
+                    ++errors;
+                }
+            }
+            });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    BlockCache::instance().setCapacity(capacity);
+    EXPECT_EQ(errors, 0);
+}
+
+TEST_F(SSTFileTest, Mmap_SurvivesRenameAndRemoval) {
+    std::vector<std::pair<std::string, TestEntry>> items;
+    for (int i = 0; i < 3000; ++i) {
+        items.push_back({ getStringFromIndex(i), TestEntry{Entry{ValueType::UINT32, uint32_t(i)}} });
+    }
+    SSTOptions options;
+    options.use_mmap = true;
+    auto file = SSTFile::writeAndCreate(temp_dir / "mmap.vsst", 2048, 0, true, items.begin(), items.end(), options);
+    auto before = BlockCache::instance().stats();
+    auto v = file->get(items[10].first);
+    ASSERT_TRUE(v.has_value());
+    EXPECT_EQ(std::get<uint32_t>(v->value), 10u);
+    EXPECT_EQ(BlockCache::instance().stats().misses, before.misses); // block cache is bypassed
+
+    // Removal is written to the file and seen through the mapping
+    ASSERT_TRUE(file->remove(items[20].first));
+    EXPECT_EQ(file->status(items[20].first), EntryStatus::REMOVED);
+
+    auto it = file->begin();
+    file->rename(temp_dir / "mmap_renamed.vsst");
+    v = file->get(items[2000].first);
+    ASSERT_TRUE(v.has_value());
+    EXPECT_EQ(std::get<uint32_t>(v->value), 2000u);
+
+    // Iterator started before the rename keeps reading the old mapping
+    for (size_t n = 0; n < 5; ++n) {
+        ++it;
+    }
+    EXPECT_EQ((*it).first, items[5].first);
+
+    // Mapped file stays readable after it is removed from the disk
+    fs::remove(temp_dir / "mmap_renamed.vsst");
+    v = file->get(items[2500].first);
+    ASSERT_TRUE(v.has_value());
+    EXPECT_EQ(std::get<uint32_t>(v->value), 2500u);
+    size_t count = 0;
+    for (auto it2 = file->begin(); it2 != file->end(); ++it2) {
+        ++count;
+    }
+    EXPECT_EQ(count, items.size());
+}
+
+TEST_F(SSTFileTest, MultiGet_ReadsEachBlockOnce) {
+    std::vector<std::pair<std::string, TestEntry>> items;
+    for (int i = 0; i < 2000; ++i) {
+        items.push_back({ getStringFromIndex(i), TestEntry{Entry{ValueType::UINT32, uint32_t(i)}} });
+    }
+    auto file = SSTFile::writeAndCreate(TMP_SST_PATH, 2048, 0, true, items.begin(), items.end());
+    file->clearCache();
+    std::vector<std::string> keys;
+    for (int i = 500; i < 600; ++i) {
+        keys.push_back(items[i].first);
+    }
+    keys.push_back("zzzzzz");
+    std::vector<const std::string*> key_ptrs;
+    for (const auto& key : keys) {
+        key_ptrs.push_back(&key);
+    }
+    std::vector<std::optional<Entry>> results(keys.size());
+    results[0] = Entry{ ValueType::UINT32, uint32_t(42) }; // resolved by an upper level
+
+    auto before = BlockCache::instance().stats();
+    file->multiGet(key_ptrs, results);
+    auto after = BlockCache::instance().stats();
+    EXPECT_EQ(after.hits, before.hits);
+    EXPECT_LT(after.misses - before.misses, 10u); // 100 neighbouring keys in a few blocks
+
+    EXPECT_EQ(std::get<uint32_t>(results[0]->value), 42u);
+    for (size_t i = 1; i < 100; ++i) {
+        ASSERT_TRUE(results[i].has_value());
+        EXPECT_EQ(std::get<uint32_t>(results[i]->value), 500 + i);
+    }
+    EXPECT_FALSE(results[100].has_value());
+}
+
+TEST_F(SSTFileTest, BatchedReads_IoUringAndPreadAgree) {
+    std::vector<std::pair<std::string, TestEntry>> items;
+    for (int i = 0; i < 5000; ++i) {
+        items.push_back({ getStringFromIndex(i), TestEntry{Entry{ValueType::UINT32, uint32_t(i)}} });
+    }
+    SSTFile::writeAndCreate(TMP_SST_PATH, 2048, 0, true, items.begin(), items.end());
+    std::vector<std::string> keys;
+    for (int i = 0; i < 5000; i += 37) {
+        keys.push_back(items[i].first); // one key per block, more blocks than the io_uring queue depth
+    }
+    std::vector<const std::string*> key_ptrs;
+    for (const auto& key : keys) {
+        key_ptrs.push_back(&key);
+    }
+
+    for (bool use_io_uring : { true, false }) {
+        SSTOptions options;
+        options.use_io_uring = use_io_uring;
+        auto file = SSTFile::readAndCreate(TMP_SST_PATH, options);
+        std::vector<std::optional<Entry>> results(keys.size());
+        file->multiGet(key_ptrs, results);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            ASSERT_TRUE(results[i].has_value()) << keys[i];
+            EXPECT_EQ(std::get<uint32_t>(results[i]->value), i * 37);
+        }
+        // "aab" spans several hundred keys, scanned in growing batches of blocks
+        auto prefix_keys = file->keysWithPrefix("aab", 10000);
+        ASSERT_EQ(prefix_keys.size(), 676u);
+        EXPECT_EQ(prefix_keys.front(), getStringFromIndex(676));
+        EXPECT_EQ(prefix_keys.back(), getStringFromIndex(1351));
+        EXPECT_EQ(file->keysWithPrefix("aab", 3).size(), 3u);
+    }
+}
+
+TEST_F(SSTFileTest, ReadBatch_StopsAtEndOfFile) {
+    std::vector<uint8_t> content(1000);
+    for (size_t i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<uint8_t>(i);
+    }
+    {
+        std::ofstream ofs(TMP_SST_PATH, std::ios::binary);
+        ofs.write(reinterpret_cast<const char*>(content.data()), content.size());
+    }
+    RandomAccessFile file(TMP_SST_PATH);
+    for (bool use_io_uring : { true, false }) {
+        std::vector<std::vector<uint8_t>> buffers(100, std::vector<uint8_t>(10));
+        std::vector<ReadRequest> requests;
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            requests.push_back(ReadRequest{ &file, i * 10 + 5, buffers[i].data(), buffers[i].size() });
+        }
+        FileIO::readBatch(requests, use_io_uring);
+        for (size_t i = 0; i + 1 < buffers.size(); ++i) {
+            ASSERT_EQ(requests[i].bytes_read, 10u);
+            EXPECT_EQ(buffers[i][0], static_cast<uint8_t>(i * 10 + 5));
+        }
+        EXPECT_EQ(requests.back().bytes_read, 5u);
+    }
+}
 
 TEST_F(SSTFileTest, RemoveEntry_WorksAsExpected) {
     std::vector<std::pair<std::string, TestEntry>> items = {
@@ -604,7 +974,7 @@ TEST_F(SSTFileTest, Merge_WithDuplicatesAndRemoved) {
         EXPECT_EQ(readed_files[0]->maxKey(), "eee_123");
     }
     {   //merge in two files
-        auto merged = SSTFile::merge(sst1_path, dst_files, temp_dir2, 397, block_size, false);
+        auto merged = SSTFile::merge(sst1_path, dst_files, temp_dir2, 212, block_size, false);
         ASSERT_TRUE(merged.size() == 2);
         test_f(merged);
         EXPECT_EQ(merged[0]->minKey(), "a");
@@ -755,7 +1125,7 @@ TEST_F(SSTFileTest, Merge_WithMultiple) {
         EXPECT_EQ(merged.back()->maxKey(), "xdup");
     }
     {   //merge in three files
-        auto merged = SSTFile::merge(sst1_path, dst_files, temp_dir2, 397, block_size, false);
+        auto merged = SSTFile::merge(sst1_path, dst_files, temp_dir2, 250, block_size, false);
         ASSERT_TRUE(merged.size() == 2);
         test_f(merged);
         EXPECT_EQ(merged.front()->minKey(), "a");
@@ -832,3 +1202,146 @@ TEST_F(SSTFileTest, ForEachKeyWithPrefix_Basic) {
     ASSERT_EQ(stop.size(), 1u);
     EXPECT_EQ(stop[0], "a1");
 }
+
+TEST_F(SSTFileTest, IndexKeys_ShortestSeparators) {
+    EXPECT_EQ(Utils::shortestSeparator("abcdef", "abzzzz"), "abz");
+    EXPECT_EQ(Utils::shortestSeparator("abc", "abcdef"), "abcd");
+    EXPECT_EQ(Utils::shortestSeparator("", "b"), "b");
+
+    // Distinct heads, long shared tails: the index keeps only the heads
+    const std::string tail(200, 't');
+    std::vector<std::pair<std::string, TestEntry>> first_items, second_items;
+    for (int i = 0; i < 2000; ++i) {
+        first_items.push_back({ "a" + getStringFromIndex(i * 7) + tail, TestEntry{Entry{ValueType::UINT32, uint32_t(i)}} });
+        second_items.push_back({ "b" + getStringFromIndex(i * 7) + tail, TestEntry{Entry{ValueType::UINT32, uint32_t(i + 2000)}} });
+    }
+    auto first_path = temp_dir / "first.vsst";
+    auto second_path = temp_dir / "second.vsst";
+    auto file = SSTFile::writeAndCreate(first_path, 2048, 1, true, first_items.begin(), first_items.end());
+    SSTFile::writeAndCreate(second_path, 2048, 2, true, second_items.begin(), second_items.end());
+    // Whole keys would take over 200 bytes for each of the blocks
+    auto min_blocks = fs::file_size(first_path) / 2048;
+    EXPECT_LT(file->indexMemoryUsage(), min_blocks * 40);
+    EXPECT_EQ(file->minKey(), first_items.front().first);
+    EXPECT_EQ(file->maxKey(), first_items.back().first);
+
+    // Keys between the last key of a block and the separator of the next one
+    for (int i = 0; i + 1 < 2000; i += 11) {
+        auto v = file->get(first_items[i].first);
+        ASSERT_TRUE(v.has_value()) << first_items[i].first;
+        EXPECT_EQ(std::get<uint32_t>(v->value), uint32_t(i));
+        EXPECT_FALSE(file->get(first_items[i].first + "x").has_value());
+        EXPECT_FALSE(file->get("a" + getStringFromIndex(i * 7 + 1)).has_value());
+    }
+    auto prefix = "a" + getStringFromIndex(7 * 100).substr(0, 3);
+    auto with_prefix = std::count_if(first_items.begin(), first_items.end(),
+        [&](const auto& item) { return item.first.starts_with(prefix); });
+    EXPECT_EQ(file->keysWithPrefix(prefix, 100000).size(), static_cast<size_t>(with_prefix));
+
+    // Copied blocks are separated from the blocks of the other file
+    auto merged = SSTFile::merge(second_path, { first_path }, temp_dir2, 1024 * 1024 * 1024, 2048, true);
+    ASSERT_EQ(merged.size(), 1u);
+    EXPECT_EQ(merged.front()->minKey(), first_items.front().first);
+    EXPECT_EQ(merged.front()->maxKey(), second_items.back().first);
+    EXPECT_EQ(merged.front()->keysWithPrefix("a", 100000).size(), first_items.size());
+    EXPECT_EQ(merged.front()->keysWithPrefix("b", 100000).size(), second_items.size());
+    for (int i = 0; i < 2000; i += 17) {
+        ASSERT_TRUE(merged.front()->get(second_items[i].first).has_value()) << second_items[i].first;
+        EXPECT_FALSE(merged.front()->get(second_items[i].first.substr(0, 6)).has_value());
+    }
+}
+
+TEST_F(SSTFileTest, OpensLazilyWithBoundedDescriptors) {
+    std::vector<std::vector<std::pair<std::string, TestEntry>>> files_items(8);
+    for (int f = 0; f < 8; ++f) {
+        for (int i = 0; i < 500; ++i) {
+            files_items[f].push_back({ std::to_string(f) + "/" + getStringFromIndex(i), TestEntry{Entry{ValueType::UINT32, uint32_t(f * 1000 + i)}} });
+        }
+        SSTFile::writeAndCreate(temp_dir / (std::to_string(f) + ".vsst"), 2048, f, true,
+            files_items[f].begin(), files_items[f].end());
+    }
+    auto& table_cache = TableCache::instance();
+    table_cache.setCapacity(3);
+    std::vector<std::unique_ptr<SSTFile>> files;
+    for (int f = 0; f < 8; ++f) {
+        files.push_back(SSTFile::readAndCreate(temp_dir / (std::to_string(f) + ".vsst")));
+        EXPECT_EQ(files.back()->seqNum(), uint64_t(f));
+        EXPECT_EQ(files.back()->indexMemoryUsage(), 0u); // only the header is read
+    }
+    for (int round = 0; round < 3; ++round) {
+        for (int f = 0; f < 8; ++f) {
+            for (int i = round; i < 500; i += 37) {
+                auto v = files[f]->get(files_items[f][i].first);
+                ASSERT_TRUE(v.has_value()) << files_items[f][i].first;
+                EXPECT_EQ(std::get<uint32_t>(v->value), uint32_t(f * 1000 + i));
+            }
+            EXPECT_LE(table_cache.stats().open_files, 3u);
+        }
+    }
+    EXPECT_GT(files.front()->indexMemoryUsage(), 0u);
+    EXPECT_EQ(files.back()->maxKey(), files_items.back().back().first);
+    size_t count = 0;
+    for (auto it = files[3]->begin(); it != files[3]->end(); ++it) {
+        ++count;
+    }
+    EXPECT_EQ(count, 500u);
+    files.clear();
+    EXPECT_EQ(table_cache.stats().open_files, 0u);
+    table_cache.setCapacity(sst::cache::DEFAULT_MAX_OPEN_FILES);
+}
+
+TEST_F(SSTFileTest, Footer_StoresPropertiesAndMaxKey) {
+    std::vector<std::pair<std::string, TestEntry>> items;
+    for (int i = 0; i < 1000; ++i) {
+        items.push_back({ "key/" + getStringFromIndex(i), TestEntry{Entry{ValueType::UINT32, uint32_t(i)}} });
+    }
+    items[10].second.entry = Entry{ ValueType::REMOVED, uint8_t(0) };
+    SSTFile::writeAndCreate(TMP_SST_PATH, 2048, 1, true, items.begin(), items.end());
+    auto file = SSTFile::readAndCreate(TMP_SST_PATH);
+    ASSERT_EQ(file->version(), sst::header::SST_VERSION);
+    EXPECT_EQ(file->minKey(), items.front().first);
+    EXPECT_EQ(file->maxKey(), items.back().first);
+    EXPECT_EQ(file->indexMemoryUsage(), 0u); // the key range is read with the footer, the index is not loaded
+    auto properties = file->properties();
+    ASSERT_TRUE(properties.has_value());
+    EXPECT_EQ(properties->num_entries, items.size());
+    EXPECT_GT(properties->num_datablocks, 1u);
+    EXPECT_EQ(file->maxKey(), items.back().first);
+    EXPECT_EQ(file->minKey(), items.front().first);
+    EXPECT_EQ(std::get<uint32_t>(file->get(items[500].first)->value), 500u);
+    EXPECT_EQ(file->status(items[10].first), EntryStatus::REMOVED);
+
+    // Removed entries are dropped when they are not kept
+    auto compacted_path = temp_dir / "compacted.vsst";
+    auto compacted = SSTFile::writeAndCreate(compacted_path, 2048, 1, false, items.begin(), items.end());
+    EXPECT_EQ(compacted->properties()->num_entries, items.size() - 1);
+    EXPECT_EQ(SSTFile::readAndCreate(compacted_path)->properties()->num_datablocks, compacted->properties()->num_datablocks);
+
+    // Older files have no properties block, their max key is read from the last block
+    SSTOptions old_options;
+    old_options.format_version = sst::header::SST_VERSION_PARTITIONED;
+    auto old_path = temp_dir / "old.vsst";
+    SSTFile::writeAndCreate(old_path, 2048, 1, true, items.begin(), items.end(), old_options);
+    auto old_file = SSTFile::readAndCreate(old_path);
+    EXPECT_FALSE(old_file->properties().has_value());
+    EXPECT_EQ(old_file->maxKey(), items.back().first);
+    EXPECT_EQ(old_file->minKey(), items.front().first);
+
+    // Files of version 6 store the max key only, the min key comes from the index
+    old_options.format_version = sst::header::SST_VERSION_FOOTER;
+    SSTFile::writeAndCreate(old_path, 2048, 1, true, items.begin(), items.end(), old_options);
+    old_file = SSTFile::readAndCreate(old_path);
+    EXPECT_EQ(old_file->indexMemoryUsage(), 0u);
+    EXPECT_EQ(old_file->minKey(), items.front().first);
+    EXPECT_GT(old_file->indexMemoryUsage(), 0u);
+    EXPECT_EQ(old_file->maxKey(), items.back().first);
+    EXPECT_EQ(old_file->properties()->num_entries, items.size());
+
+    // A damaged footer is reported when the file is opened
+    {
+        std::fstream f(TMP_SST_PATH, std::ios::binary | std::ios::in | std::ios::out);
+        f.seekp(-1, std::ios::end);
+        f.put('X');
+    }
+    EXPECT_THROW(SSTFile::readAndCreate(TMP_SST_PATH), std::runtime_error); // the footer is read on open
+}
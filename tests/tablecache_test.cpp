@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include "../src/tablecache.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    const fs::path temp_dir = fs::temp_directory_path() / "tablecache_test_dir";
+}
+
+class TableCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::error_code ec;
+        fs::remove_all(temp_dir, ec);
+        fs::create_directories(temp_dir);
+        for (int i = 0; i < 4; ++i) {
+            std::ofstream(path(i), std::ios::binary) << "file" << i;
+        }
+    }
+    void TearDown() override {
+        std::error_code ec;
+        fs::remove_all(temp_dir, ec);
+    }
+    static fs::path path(int i) {
+        return temp_dir / ("f" + std::to_string(i));
+    }
+};
+
+TEST_F(TableCacheTest, ReusesOpenFiles) {
+    TableCache cache(10);
+    auto file = cache.open(1, path(1));
+    ASSERT_NE(file, nullptr);
+    EXPECT_EQ(cache.open(1, path(1)), file);
+    EXPECT_NE(cache.open(2, path(2)), file);
+    EXPECT_EQ(cache.open(3, temp_dir / "missing"), nullptr);
+
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.opens, 2u);
+    EXPECT_EQ(stats.open_files, 2u);
+    EXPECT_EQ(stats.capacity, 10u);
+
+    uint8_t data[5] = {};
+    ASSERT_EQ(file->read(0, data, sizeof(data)), sizeof(data));
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(data), sizeof(data)), "file1");
+}
+
+TEST_F(TableCacheTest, ClosesLeastRecentlyUsed) {
+    TableCache cache(2);
+    auto first = cache.open(0, path(0));
+    cache.open(1, path(1));
+    cache.open(0, path(0)); // file 0 becomes most recently used
+    cache.open(2, path(2));
+    EXPECT_EQ(cache.stats().open_files, 2u);
+    EXPECT_EQ(cache.open(0, path(0)), first);
+    EXPECT_EQ(cache.stats().opens, 3u);
+    cache.open(1, path(1)); // reopened
+    EXPECT_EQ(cache.stats().opens, 4u);
+
+    // An evicted descriptor stays valid for its reader
+    cache.setCapacity(1);
+    EXPECT_EQ(cache.stats().open_files, 1u);
+    uint8_t data[5] = {};
+    EXPECT_EQ(first->read(0, data, sizeof(data)), sizeof(data));
+    EXPECT_NE(cache.open(0, path(0)), first);
+
+    cache.erase(0);
+    EXPECT_EQ(cache.stats().open_files, 0u);
+    cache.resetStats();
+    EXPECT_EQ(cache.stats().opens, 0u);
+}
@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+#include "../src/wal.h"
+#include "../src/types.h"
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+class WriteAheadLogTest : public ::testing::Test {
+protected:
+    fs::path dir;
+    fs::path wal_path;  // first segment
+    void SetUp() override {
+        dir = fs::temp_directory_path() / "wal_test_dir";
+        std::error_code ec;
+        fs::remove_all(dir, ec);
+        fs::create_directories(dir);
+        wal_path = dir / "wal_1.log";
+    }
+    void TearDown() override {
+        std::error_code ec;
+        fs::remove_all(dir, ec);
+    }
+
+    struct Replayed {
+        std::string key;
+        Entry entry;
+        uint64_t expiration_ms;
+    };
+
+    std::vector<Replayed> replayAll(WalSyncMode mode = WalSyncMode::NONE) {
+        std::vector<Replayed> res;
+        WriteAheadLog wal(dir, mode, 10);
+        wal.replay([&](uint64_t, const std::string& key, const Entry& entry, uint64_t expiration_ms) {
+            res.push_back({ key, entry, expiration_ms });
+            });
+        return res;
+    }
+};
+
+TEST_F(WriteAheadLogTest, AppendAndReplay_MixedTypes) {
+    {
+        WriteAheadLog wal(dir, WalSyncMode::PER_WRITE, 10);
+        wal.sync(wal.append("a", Entry{ ValueType::UINT32, uint32_t(42) }, 0));
+        wal.sync(wal.append("b", Entry{ ValueType::STRING, std::string("value") }, 12345));
+        wal.sync(wal.append("c", Entry{ ValueType::BLOB, std::vector<uint8_t>{1, 2, 3} }, 0));
+        wal.sync(wal.append("a", Entry{ ValueType::REMOVED, {} }, sst::datablock::EXPIRATION_DELETED));
+    }
+    auto res = replayAll();
+    ASSERT_EQ(res.size(), 4u);
+    EXPECT_EQ(res[0].key, "a");
+    EXPECT_EQ(std::get<uint32_t>(res[0].entry.value), 42u);
+    EXPECT_EQ(res[1].key, "b");
+    EXPECT_EQ(res[1].entry.type, ValueType::STRING);
+    EXPECT_EQ(std::get<std::string>(res[1].entry.value), "value");
+    EXPECT_EQ(res[1].expiration_ms, 12345u);
+    EXPECT_EQ(std::get<std::vector<uint8_t>>(res[2].entry.value), std::vector<uint8_t>({ 1, 2, 3 }));
+    EXPECT_EQ(res[3].key, "a");
+    EXPECT_EQ(res[3].entry.type, ValueType::REMOVED);
+    EXPECT_EQ(res[3].expiration_ms, sst::datablock::EXPIRATION_DELETED);
+}
+
+TEST_F(WriteAheadLogTest, RotateAndRemoveSegments) {
+    {
+        WriteAheadLog wal(dir, WalSyncMode::BATCHED, 10);
+        wal.append("a", Entry{ ValueType::UINT8, uint8_t(1) }, 0);
+        EXPECT_EQ(wal.rotate(), 1u);
+        wal.append("b", Entry{ ValueType::UINT8, uint8_t(2) }, 0);
+        EXPECT_EQ(wal.rotate(), 2u);
+        wal.append("c", Entry{ ValueType::UINT8, uint8_t(3) }, 0);
+    }
+    // All segments are replayed in order
+    auto res = replayAll();
+    ASSERT_EQ(res.size(), 3u);
+    EXPECT_EQ(res[0].key, "a");
+    EXPECT_EQ(res[1].key, "b");
+    EXPECT_EQ(res[2].key, "c");
+    {
+        WriteAheadLog wal(dir, WalSyncMode::BATCHED, 10);
+        wal.removeSegments(1);
+        wal.append("d", Entry{ ValueType::UINT8, uint8_t(4) }, 0);
+    }
+    EXPECT_FALSE(fs::exists(wal_path));
+    res = replayAll();
+    ASSERT_EQ(res.size(), 3u);
+    EXPECT_EQ(res[0].key, "b");
+    EXPECT_EQ(res[2].key, "d");
+}
+
+TEST_F(WriteAheadLogTest, CorruptedSegmentDropsLaterSegments) {
+    {
+        WriteAheadLog wal(dir, WalSyncMode::NONE, 10);
+        wal.append("a", Entry{ ValueType::UINT64, uint64_t(1) }, 0);
+        wal.append("b", Entry{ ValueType::UINT64, uint64_t(2) }, 0);
+        wal.rotate();
+        wal.append("c", Entry{ ValueType::UINT64, uint64_t(3) }, 0);
+    }
+    fs::resize_file(wal_path, fs::file_size(wal_path) - 3);
+    auto res = replayAll();
+    ASSERT_EQ(res.size(), 1u);
+    EXPECT_EQ(res[0].key, "a");
+    EXPECT_FALSE(fs::exists(dir / "wal_2.log"));
+}
+
+TEST_F(WriteAheadLogTest, TornTailIsTruncated) {
+    {
+        WriteAheadLog wal(dir, WalSyncMode::NONE, 10);
+        wal.append("a", Entry{ ValueType::UINT64, uint64_t(1) }, 0);
+        wal.append("b", Entry{ ValueType::UINT64, uint64_t(2) }, 0);
+    }
+    // Simulate crash in the middle of the last record
+    auto full_size = fs::file_size(wal_path);
+    fs::resize_file(wal_path, full_size - 3);
+    auto res = replayAll();
+    ASSERT_EQ(res.size(), 1u);
+    EXPECT_EQ(res[0].key, "a");
+
+    // New records appended after the cut tail must be reachable
+    {
+        WriteAheadLog wal(dir, WalSyncMode::NONE, 10);
+        wal.replay([](uint64_t, const std::string&, const Entry&, uint64_t) {});
+        wal.append("c", Entry{ ValueType::UINT64, uint64_t(3) }, 0);
+    }
+    res = replayAll();
+    ASSERT_EQ(res.size(), 2u);
+    EXPECT_EQ(res[1].key, "c");
+}
+
+TEST_F(WriteAheadLogTest, CorruptedRecordStopsReplay) {
+    {
+        WriteAheadLog wal(dir, WalSyncMode::NONE, 10);
+        wal.append("a", Entry{ ValueType::UINT64, uint64_t(1) }, 0);
+        wal.append("b", Entry{ ValueType::UINT64, uint64_t(2) }, 0);
+    }
+    {
+        std::fstream f(wal_path, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(-2, std::ios::end);
+        f.put('\x7f');
+    }
+    auto res = replayAll();
+    ASSERT_EQ(res.size(), 1u);
+    EXPECT_EQ(res[0].key, "a");
+}
+
+TEST_F(WriteAheadLogTest, GroupCommitConcurrentWriters) {
+    constexpr int num_threads = 8;
+    constexpr int per_thread = 200;
+    {
+        WriteAheadLog wal(dir, WalSyncMode::PER_WRITE, 10);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; ++t) {
+            threads.emplace_back([&wal, t]() {
+                for (int i = 0; i < per_thread; ++i) {
+                    auto lsn = wal.append("k_" + std::to_string(t) + "_" + std::to_string(i),
+                        Entry{ ValueType::INT32, int32_t(i) }, 0);
+                    wal.sync(lsn);
+                }
+                });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+    }
+    auto res = replayAll();
+    EXPECT_EQ(res.size(), static_cast<size_t>(num_threads * per_thread));
+}
+
+TEST_F(WriteAheadLogTest, BatchIsReplayedAsWhole) {
+    {
+        WriteAheadLog wal(dir, WalSyncMode::NONE, 10);
+        wal.append("a", Entry{ ValueType::UINT8, uint8_t(1) }, 0);
+        std::string b = "b", a = "a";
+        Entry value{ ValueType::UINT8, uint8_t(2) }, removed{ ValueType::REMOVED, {} };
+        std::vector<WriteAheadLog::Operation> batch{ { &b, &value, 0 }, { &a, &removed, 0 } };
+        EXPECT_EQ(wal.append(batch), 2u);
+    }
+    auto res = replayAll();
+    ASSERT_EQ(res.size(), 3u);
+    EXPECT_EQ(res[1].key, "b");
+    EXPECT_EQ(res[2].entry.type, ValueType::REMOVED);
+
+    // Torn batch record is dropped completely
+    fs::resize_file(wal_path, fs::file_size(wal_path) - 1);
+    res = replayAll();
+    ASSERT_EQ(res.size(), 1u);
+    EXPECT_EQ(res[0].key, "a");
+}
@@ -116,6 +116,93 @@ TEST_F(LevelZeroTest, FilelistToMergeAndRemove) {
     ASSERT_EQ(to_merge.size(), 2u);
 }
 
+TEST_F(LevelZeroTest, LookupsUseFileKeyRanges) {
+    LevelZero lz(dir, 10);
+    auto entry = [](uint32_t v) { return TestEntry{ Entry{ValueType::UINT32, v}, 0 }; };
+    std::vector<std::pair<std::string, TestEntry>> v1 = { {"a", entry(1)}, {"m", entry(1)}, {"pa", entry(1)} };
+    std::vector<std::pair<std::string, TestEntry>> v2 = { {"x", entry(2)}, {"z", entry(2)} };
+    std::vector<std::pair<std::string, TestEntry>> v3 = { {"c", entry(3)}, {"e", entry(3)} };
+    std::vector<std::unique_ptr<SSTFile>> vec;
+    vec.push_back(createSST(1, v1));
+    vec.push_back(createSST(2, v2));
+    vec.push_back(createSST(3, v3));
+    lz.addSST(std::move(vec));
+
+    EXPECT_EQ(std::get<uint32_t>(lz.get("a")->value), 1u);
+    EXPECT_EQ(std::get<uint32_t>(lz.get("m")->value), 1u); // covered by the long range of the oldest file only
+    EXPECT_EQ(std::get<uint32_t>(lz.get("e")->value), 3u);
+    EXPECT_EQ(std::get<uint32_t>(lz.get("z")->value), 2u);
+    EXPECT_FALSE(lz.get("0").has_value());
+    EXPECT_FALSE(lz.get("q").has_value());
+    EXPECT_FALSE(lz.get("zz").has_value());
+    EXPECT_EQ(lz.status("x"), EntryStatus::EXISTS);
+    EXPECT_EQ(lz.status("y"), EntryStatus::NOT_FOUND);
+
+    std::vector<std::string> keys = { "0", "a", "d", "e", "m", "x", "zz" };
+    std::vector<const std::string*> key_ptrs;
+    for (const auto& key : keys) {
+        key_ptrs.push_back(&key);
+    }
+    std::vector<std::optional<Entry>> results(keys.size());
+    lz.multiGet(key_ptrs, results);
+    EXPECT_FALSE(results[0].has_value());
+    EXPECT_EQ(std::get<uint32_t>(results[1]->value), 1u);
+    EXPECT_FALSE(results[2].has_value());
+    EXPECT_EQ(std::get<uint32_t>(results[3]->value), 3u);
+    EXPECT_EQ(std::get<uint32_t>(results[4]->value), 1u);
+    EXPECT_EQ(std::get<uint32_t>(results[5]->value), 2u);
+    EXPECT_FALSE(results[6].has_value());
+
+    EXPECT_EQ(lz.keysWithPrefix("p", 10), std::vector<std::string>{ "pa" });
+    EXPECT_TRUE(lz.remove("m", 3));
+    EXPECT_EQ(lz.status("m"), EntryStatus::REMOVED);
+
+    // Ranges follow the removal of files
+    lz.removeSSTs({ dir / "L0_1.vsst" });
+    EXPECT_FALSE(lz.get("a").has_value());
+    EXPECT_EQ(std::get<uint32_t>(lz.get("c")->value), 3u);
+}
+
+TEST_F(LevelZeroTest, OpeningLoadsNoIndexes) {
+    auto entry = [](uint32_t v) { return TestEntry{ Entry{ValueType::UINT32, v}, 0 }; };
+    for (uint32_t f = 1; f <= 3; ++f) {
+        std::vector<std::pair<std::string, TestEntry>> v = {
+            {"f" + std::to_string(f) + ":a", entry(f)}, {"f" + std::to_string(f) + ":z", entry(f)} };
+        createSST(f, v);
+    }
+    auto opens = TableCache::instance().stats().opens;
+    LevelZero lz(dir, 10);
+    auto copy = lz.clone();
+    EXPECT_EQ(TableCache::instance().stats().opens, opens); // key ranges come from the footers
+
+    EXPECT_EQ(std::get<uint32_t>(copy->get("f2:z")->value), 2u);
+    EXPECT_FALSE(copy->get("f0").has_value());
+    EXPECT_EQ(TableCache::instance().stats().opens, opens + 1); // only the covering file
+}
+
+TEST_F(LevelZeroTest, RemovedFileLivesUntilLastCopyReleased) {
+    LevelZero lz(dir, 10);
+    std::vector<std::pair<std::string, TestEntry>> v = {
+        {"k", TestEntry{Entry{ValueType::UINT32, uint32_t(1)}, 0}} };
+    std::vector<std::unique_ptr<SSTFile>> vec;
+    vec.push_back(createSST(1, v));
+    lz.addSST(std::move(vec));
+    fs::path path = dir / "L0_1.vsst";
+    ASSERT_TRUE(fs::exists(path));
+
+    // Copy stands for a version still used by a reader
+    auto old_version = lz.clone();
+    lz.removeSSTs({ path });
+    EXPECT_FALSE(lz.get("k").has_value());
+    EXPECT_TRUE(fs::exists(path));
+    auto val = old_version->get("k");
+    ASSERT_TRUE(val.has_value());
+    EXPECT_EQ(std::get<uint32_t>(val->value), 1u);
+
+    old_version.reset();
+    EXPECT_FALSE(fs::exists(path));
+}
+
 TEST_F(LevelZeroTest, RemoveDoesNotAffectHigherSeq) {
     LevelZero lz(dir, 10);
     std::vector<std::pair<std::string, TestEntry>> v1 = {